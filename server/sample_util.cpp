@@ -500,88 +500,176 @@ int SampleUtil_PrintEvent(Upnp_EventType EventType, void *Event)
 	return 0;
 }
 
-int SampleUtil_FindAndParseService(IXML_Document *DescDoc, const char *location,
-	const char *serviceType, char **serviceId, char **eventURL, char **controlURL)
+/*!
+ * \brief Returns the text of an element, "" if it has none.
+ */
+static const char *SampleUtil_GetNodeText(IXML_Node *node)
 {
-	unsigned int i;
-	unsigned long length;
-	int found = 0;
-	int ret;
-#ifdef OLD_FIND_SERVICE_CODE
-#else /* OLD_FIND_SERVICE_CODE */
-	unsigned int sindex = 0;
-#endif /* OLD_FIND_SERVICE_CODE */
-	char *tempServiceType = NULL;
-	char *baseURL = NULL;
-	const char *base = NULL;
-	char *relcontrolURL = NULL;
-	char *releventURL = NULL;
-	IXML_NodeList *serviceList = NULL;
-	IXML_Element *service = NULL;
-
-	baseURL = SampleUtil_GetFirstDocumentItem(DescDoc, "URLBase");
-	if (baseURL)
-		base = baseURL;
-	else
-		base = location;
-#ifdef OLD_FIND_SERVICE_CODE
-	serviceList = SampleUtil_GetFirstServiceList(DescDoc);
-#else /* OLD_FIND_SERVICE_CODE */
-	for (sindex = 0;
-	     (serviceList = SampleUtil_GetNthServiceList(DescDoc , sindex)) != NULL;
-	     sindex++) {
-		tempServiceType = NULL;
-		relcontrolURL = NULL;
-		releventURL = NULL;
-		service = NULL;
-#endif /* OLD_FIND_SERVICE_CODE */
-		length = ixmlNodeList_length(serviceList);
-		for (i = 0; i < length; i++) {
-			service = (IXML_Element *)ixmlNodeList_item(serviceList, i);
-			tempServiceType = SampleUtil_GetFirstElementItem(
-				(IXML_Element *)service, "serviceType");
-			if (tempServiceType && strcmp(tempServiceType, serviceType) == 0) {
-				SampleUtil_Print("Found service: %s\n", serviceType);
-				*serviceId = SampleUtil_GetFirstElementItem(service, "serviceId");
-				SampleUtil_Print("serviceId: %s\n", *serviceId);
-				relcontrolURL = SampleUtil_GetFirstElementItem(service, "controlURL");
-				releventURL = SampleUtil_GetFirstElementItem(service, "eventSubURL");
-				*controlURL = (char *)malloc(strlen(base) + strlen(relcontrolURL) + 1);
-				if (*controlURL) {
-					ret = UpnpResolveURL(base, relcontrolURL, *controlURL);
-					if (ret != UPNP_E_SUCCESS)
-						SampleUtil_Print("Error generating controlURL from %s + %s\n",
-							base, relcontrolURL);
-				}
-				*eventURL = (char *)malloc(strlen(base) + strlen(releventURL) + 1);
-				if (*eventURL) {
-					ret = UpnpResolveURL(base, releventURL, *eventURL);
-					if (ret != UPNP_E_SUCCESS)
-						SampleUtil_Print("Error generating eventURL from %s + %s\n",
-							base, releventURL);
+	IXML_Node *child = ixmlNode_getFirstChild(node);
+	const char *value = NULL;
+
+	if (child && ixmlNode_getNodeType(child) == eTEXT_NODE)
+		value = ixmlNode_getNodeValue(child);
+
+	return value ? value : "";
+}
+
+/*!
+ * \brief Stores the text of an element in *field, unless an earlier element
+ * already did.
+ */
+static void SampleUtil_SetField(const char **field, IXML_Node *node)
+{
+	if (!*field)
+		*field = SampleUtil_GetNodeText(node);
+}
+
+int SampleUtil_ParseDescription(IXML_Document *doc,
+	struct SampleUtil_Description *desc)
+{
+	struct SampleUtil_Service *service = NULL;
+	IXML_Node *serviceNode = NULL;
+	IXML_Node *serviceList = NULL;
+	int serviceListDone = 0;
+	IXML_Node *node, *next;
+	const char *name;
+
+	memset(desc, 0, sizeof(*desc));
+	if (!doc)
+		return UPNP_E_INVALID_PARAM;
+
+	/* Preorder walk, the order of ixmlDocument_getElementsByTagName */
+	node = ixmlNode_getFirstChild((IXML_Node *)doc);
+	while (node) {
+		if (ixmlNode_getNodeType(node) == eELEMENT_NODE) {
+			name = ixmlNode_getNodeName(node);
+			if (!name)
+				name = "";
+			if (serviceList && !serviceListDone &&
+			    strcmp(name, "service") == 0) {
+				if (desc->serviceCount < SAMPLE_UTIL_MAX_SERVICES) {
+					service = &desc->service[desc->serviceCount++];
+					serviceNode = node;
 				}
-				free(relcontrolURL);
-				free(releventURL);
-				relcontrolURL = NULL;
-				releventURL = NULL;
-				found = 1;
-				break;
+			} else if (service && strcmp(name, "serviceType") == 0) {
+				SampleUtil_SetField(&service->serviceType, node);
+			} else if (service && strcmp(name, "serviceId") == 0) {
+				SampleUtil_SetField(&service->serviceId, node);
+			} else if (service && strcmp(name, "SCPDURL") == 0) {
+				SampleUtil_SetField(&service->SCPDURL, node);
+			} else if (service && strcmp(name, "controlURL") == 0) {
+				SampleUtil_SetField(&service->controlURL, node);
+			} else if (service && strcmp(name, "eventSubURL") == 0) {
+				SampleUtil_SetField(&service->eventSubURL, node);
+			} else if (strcmp(name, "serviceList") == 0) {
+				if (!serviceList)
+					serviceList = node;
+			} else if (strcmp(name, "URLBase") == 0) {
+				SampleUtil_SetField(&desc->URLBase, node);
+			} else if (strcmp(name, "deviceType") == 0) {
+				SampleUtil_SetField(&desc->deviceType, node);
+			} else if (strcmp(name, "friendlyName") == 0) {
+				SampleUtil_SetField(&desc->friendlyName, node);
+			} else if (strcmp(name, "modelName") == 0) {
+				SampleUtil_SetField(&desc->modelName, node);
+			} else if (strcmp(name, "UDN") == 0) {
+				SampleUtil_SetField(&desc->UDN, node);
+			} else if (strcmp(name, "presentationURL") == 0) {
+				SampleUtil_SetField(&desc->presentationURL, node);
+			}
+			next = ixmlNode_getFirstChild(node);
+			if (next) {
+				node = next;
+				continue;
 			}
-			free(tempServiceType);
-			tempServiceType = NULL;
 		}
-		free(tempServiceType);
-		tempServiceType = NULL;
-		if (serviceList)
-			ixmlNodeList_free(serviceList);
-		serviceList = NULL;
-#ifdef OLD_FIND_SERVICE_CODE
-#else /* OLD_FIND_SERVICE_CODE */
+		/* Leave the subtrees that are finished */
+		for (;;) {
+			if (node == serviceNode) {
+				service = NULL;
+				serviceNode = NULL;
+			}
+			if (node == serviceList)
+				serviceListDone = 1;
+			next = ixmlNode_getNextSibling(node);
+			if (next)
+				break;
+			node = ixmlNode_getParentNode(node);
+			if (!node || node == (IXML_Node *)doc)
+				break;
+		}
+		node = next;
 	}
-#endif /* OLD_FIND_SERVICE_CODE */
-	free(baseURL);
 
-	return found;
+	return UPNP_E_SUCCESS;
+}
+
+/*!
+ * \brief Resolves a possibly relative URL against base.
+ *
+ * \return The URL, to be freed by the caller, or NULL if out of memory.
+ */
+static char *SampleUtil_ResolveURL(const char *base, const char *rel,
+	const char *what)
+{
+	char *url;
+	int ret;
+
+	url = (char *)malloc(strlen(base) + strlen(rel) + 1);
+	if (url) {
+		ret = UpnpResolveURL(base, rel, url);
+		if (ret != UPNP_E_SUCCESS)
+			SampleUtil_Print("Error generating %s from %s + %s\n",
+				what, base, rel);
+	}
+
+	return url;
+}
+
+int SampleUtil_FindService(const struct SampleUtil_Description *desc,
+	const char *location, const char *serviceType, char **serviceId,
+	char **eventURL, char **controlURL, char **scpdURL)
+{
+	const struct SampleUtil_Service *service;
+	const char *base;
+	int i;
+
+	base = desc->URLBase ? desc->URLBase : location;
+	for (i = 0; i < desc->serviceCount; i++) {
+		service = &desc->service[i];
+		if (!service->serviceType ||
+		    strcmp(service->serviceType, serviceType) != 0)
+			continue;
+		SampleUtil_Print("Found service: %s\n", serviceType);
+		*serviceId = strdup(service->serviceId ?
+				    service->serviceId : "");
+		SampleUtil_Print("serviceId: %s\n", *serviceId);
+		*controlURL = SampleUtil_ResolveURL(base,
+			service->controlURL ? service->controlURL : "",
+			"controlURL");
+		*eventURL = SampleUtil_ResolveURL(base,
+			service->eventSubURL ? service->eventSubURL : "",
+			"eventURL");
+		if (scpdURL)
+			*scpdURL = SampleUtil_ResolveURL(base,
+				service->SCPDURL ? service->SCPDURL : "",
+				"SCPDURL");
+		return 1;
+	}
+
+	return 0;
+}
+
+int SampleUtil_FindAndParseService(IXML_Document *DescDoc, const char *location,
+	const char *serviceType, char **serviceId, char **eventURL, char **controlURL)
+{
+	struct SampleUtil_Description desc;
+
+	if (SampleUtil_ParseDescription(DescDoc, &desc) != UPNP_E_SUCCESS)
+		return 0;
+
+	return SampleUtil_FindService(&desc, location, serviceType,
+		serviceId, eventURL, controlURL, NULL);
 }
 
 int SampleUtil_Print(const char *fmt, ...)
@@ -119,6 +119,77 @@ char *SampleUtil_GetFirstElementItem(
 	/*! [in] The item to search for. */
 	const char *item); 
 
+/*! Most services of a service list kept by SampleUtil_ParseDescription(). */
+#define SAMPLE_UTIL_MAX_SERVICES	16
+
+/*!
+ * \brief One service of a description, as found by
+ * SampleUtil_ParseDescription(). The URLs are the raw, possibly relative,
+ * values. A field is NULL if its element is missing.
+ */
+struct SampleUtil_Service {
+	const char *serviceType;
+	const char *serviceId;
+	const char *SCPDURL;
+	const char *controlURL;
+	const char *eventSubURL;
+};
+
+/*!
+ * \brief The fields of a device description document the samples use. The
+ * strings point into the document and are valid as long as it is. A field
+ * is NULL if its element is missing, "" if the element is empty.
+ *
+ * Every device field is the first such element of the document, and the
+ * services are those of the first service list (the root device), as with
+ * SampleUtil_GetFirstDocumentItem() and SampleUtil_GetFirstServiceList().
+ */
+struct SampleUtil_Description {
+	const char *URLBase;
+	const char *deviceType;
+	const char *friendlyName;
+	const char *modelName;
+	const char *UDN;
+	const char *presentationURL;
+	/*! Number of entries of service. */
+	int serviceCount;
+	struct SampleUtil_Service service[SAMPLE_UTIL_MAX_SERVICES];
+};
+
+/*!
+ * \brief Extracts every field of struct SampleUtil_Description in a single
+ * walk of the document, without allocating.
+ *
+ * \return UPNP_E_SUCCESS, or UPNP_E_INVALID_PARAM if doc is NULL.
+ */
+int SampleUtil_ParseDescription(
+	/*! [in] The DOM description document. */
+	IXML_Document *doc,
+	/*! [out] The extracted fields. */
+	struct SampleUtil_Description *desc);
+
+/*!
+ * \brief Same as SampleUtil_FindAndParseService(), on a description already
+ * extracted by SampleUtil_ParseDescription().
+ *
+ * \return 1 if the service was found, 0 otherwise.
+ */
+int SampleUtil_FindService(
+	/*! [in] The extracted description. */
+	const struct SampleUtil_Description *desc,
+	/*! [in] The location of the description document. */
+	const char *location,
+	/*! [in] The type of service to search for. */
+	const char *serviceType,
+	/*! [out] The service ID. */
+	char **serviceId,
+	/*! [out] The event URL for the service. */
+	char **eventURL,
+	/*! [out] The control URL for the service. */
+	char **controlURL,
+	/*! [out] The SCPD URL for the service, may be NULL if not needed. */
+	char **scpdURL);
+
 /*!
  * \brief Prints a callback event type as a string.
  */
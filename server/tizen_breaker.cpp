@@ -0,0 +1,317 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Circuit Breaker
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_breaker.h"
+#include "tizen_http.h"
+#include "tizen_registry.h"
+#include "tizen_timer.h"
+#include "sample_util.h"
+
+#include "ithread.h"
+
+#include <string.h>
+
+/*! The health of one host. */
+struct tizen_breaker_host {
+	int used;
+	/*! TizenHash_String(key). */
+	unsigned int hash;
+	int circuit;
+	unsigned int requests;
+	unsigned int failures;
+	unsigned int rejected;
+	unsigned int consecutive;
+	/*! Seconds the circuit was last opened for, and the TizenTimer_Now()
+	 * from which it may be probed. */
+	int cooldown;
+	unsigned int reopen;
+	/*! TizenTimer_Now() by which the probe should have been reported,
+	 * after which another one is let through. */
+	unsigned int probe;
+	/*! TizenBreakerUses at the last request, to pick a host to evict. */
+	unsigned int last;
+	/*! The last round trips, in milliseconds, as a ring. */
+	unsigned int samples[TIZEN_BREAKER_SAMPLES];
+	int nsamples;
+	int next;
+	unsigned int p50;
+	unsigned int p95;
+	/*! Adaptive timeout in seconds, 0 while there are too few samples. */
+	int timeout;
+	/*! "host port", see TizenHttp_HostKey(). */
+	char key[280];
+};
+
+/*! Protects the hosts. */
+static ithread_mutex_t TizenBreakerMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tizen_breaker_host TizenBreakerHosts[TIZEN_BREAKER_HOSTS];
+/*! Requests asked for so far, orders the hosts by use. */
+static unsigned int TizenBreakerUses = 0;
+
+/********************************************************************************
+ * TizenBreaker_Find
+ *
+ * Description:
+ *       Finds the host of a URL, and adds it in place of the least recently
+ *       used one if asked to. Called with TizenBreakerMutex held.
+ *
+ * Returns:
+ *   The host, NULL if it is not tracked (or the URL is not http://).
+ *
+ ********************************************************************************/
+static struct tizen_breaker_host *TizenBreaker_Find(const char *url,
+	int add)
+{
+	struct tizen_breaker_host *host, *victim = NULL;
+	char key[sizeof(TizenBreakerHosts[0].key)];
+	unsigned int hash;
+	int i;
+
+	if (TizenHttp_HostKey(url, key, sizeof(key)) != 0)
+		return NULL;
+	hash = TizenHash_String(key);
+	for (i = 0; i < TIZEN_BREAKER_HOSTS; i++) {
+		host = &TizenBreakerHosts[i];
+		if (!host->used) {
+			if (!victim || victim->used)
+				victim = host;
+			continue;
+		}
+		if (host->hash == hash && strcmp(host->key, key) == 0)
+			return host;
+		if (!victim || (victim->used &&
+		    (int)(host->last - victim->last) < 0))
+			victim = host;
+	}
+	if (!add)
+		return NULL;
+	memset(victim, 0, sizeof(*victim));
+	victim->used = 1;
+	victim->hash = hash;
+	victim->circuit = TIZEN_BREAKER_CLOSED;
+	strcpy(victim->key, key);
+
+	return victim;
+}
+
+/********************************************************************************
+ * TizenBreaker_Sample
+ *
+ * Description:
+ *       Records a round trip and derives the percentiles and the adaptive
+ *       timeout from the samples. Called with TizenBreakerMutex held.
+ *
+ ********************************************************************************/
+static void TizenBreaker_Sample(struct tizen_breaker_host *host,
+	unsigned int rtt)
+{
+	unsigned int sorted[TIZEN_BREAKER_SAMPLES] = { 0 };
+	unsigned int v;
+	int i, j;
+
+	host->samples[host->next] = rtt;
+	host->next = (host->next + 1) % TIZEN_BREAKER_SAMPLES;
+	if (host->nsamples < TIZEN_BREAKER_SAMPLES)
+		host->nsamples++;
+	/* Few enough samples for an insertion sort */
+	for (i = 0; i < host->nsamples; i++) {
+		v = host->samples[i];
+		for (j = i; j > 0 && sorted[j - 1] > v; j--)
+			sorted[j] = sorted[j - 1];
+		sorted[j] = v;
+	}
+	host->p50 = sorted[(host->nsamples - 1) / 2];
+	host->p95 = sorted[(host->nsamples - 1) * 95 / 100];
+	if (host->nsamples < TIZEN_BREAKER_MIN_SAMPLES) {
+		host->timeout = 0;
+		return;
+	}
+	/* Four times the 95th percentile, in whole seconds */
+	host->timeout = (int)((host->p95 * 4 + 999) / 1000);
+	if (host->timeout < TIZEN_BREAKER_MIN_TIMEOUT)
+		host->timeout = TIZEN_BREAKER_MIN_TIMEOUT;
+}
+
+int TizenBreaker_Allow(const char *url, int fallback, int *timeout)
+{
+	struct tizen_breaker_host *host;
+	unsigned int now = TizenTimer_Now();
+	int allowed = 1;
+
+	if (timeout)
+		*timeout = fallback;
+	ithread_mutex_lock(&TizenBreakerMutex);
+	host = TizenBreaker_Find(url, 1);
+	if (!host)
+		goto __finish_allow;
+	host->last = ++TizenBreakerUses;
+	if (TIZEN_BREAKER_OPEN == host->circuit) {
+		if ((int)(now - host->reopen) < 0) {
+			allowed = 0;
+		} else {
+			host->circuit = TIZEN_BREAKER_HALF_OPEN;
+			host->probe = now + (unsigned int)fallback + 1;
+			SampleUtil_Print("Circuit to %s half open: probing\n",
+					 host->key);
+		}
+	} else if (TIZEN_BREAKER_HALF_OPEN == host->circuit) {
+		/* A probe that was never reported does not block forever */
+		if ((int)(now - host->probe) < 0)
+			allowed = 0;
+		else
+			host->probe = now + (unsigned int)fallback + 1;
+	}
+	if (!allowed) {
+		host->rejected++;
+		goto __finish_allow;
+	}
+	host->requests++;
+	if (timeout && host->timeout && host->timeout < fallback)
+		*timeout = host->timeout;
+
+__finish_allow :
+	ithread_mutex_unlock(&TizenBreakerMutex);
+
+	return allowed;
+}
+
+void TizenBreaker_Report(const char *url, int answered, unsigned int rtt)
+{
+	struct tizen_breaker_host *host;
+	unsigned int now = TizenTimer_Now();
+
+	ithread_mutex_lock(&TizenBreakerMutex);
+	host = TizenBreaker_Find(url, 0);
+	if (!host) {
+		ithread_mutex_unlock(&TizenBreakerMutex);
+		return;
+	}
+	if (answered) {
+		host->consecutive = 0;
+		TizenBreaker_Sample(host, rtt);
+		if (host->circuit != TIZEN_BREAKER_CLOSED) {
+			host->circuit = TIZEN_BREAKER_CLOSED;
+			host->cooldown = 0;
+			SampleUtil_Print("Circuit to %s closed\n", host->key);
+		}
+	} else {
+		host->failures++;
+		host->consecutive++;
+		if (TIZEN_BREAKER_HALF_OPEN == host->circuit) {
+			host->cooldown *= 2;
+			if (host->cooldown > TIZEN_BREAKER_MAX_COOLDOWN)
+				host->cooldown = TIZEN_BREAKER_MAX_COOLDOWN;
+		} else if (TIZEN_BREAKER_CLOSED == host->circuit &&
+			   host->consecutive >= TIZEN_BREAKER_FAILURES) {
+			host->cooldown = TIZEN_BREAKER_COOLDOWN;
+		} else {
+			/* Closed and still below the threshold, or a request
+			 * sent before the circuit opened */
+			ithread_mutex_unlock(&TizenBreakerMutex);
+			return;
+		}
+		host->circuit = TIZEN_BREAKER_OPEN;
+		host->reopen = now + (unsigned int)host->cooldown;
+		SampleUtil_Print("Circuit to %s open for %d s after %u failures\n",
+				 host->key, host->cooldown, host->consecutive);
+	}
+	ithread_mutex_unlock(&TizenBreakerMutex);
+}
+
+int TizenBreaker_IsOpen(const char *url)
+{
+	struct tizen_breaker_host *host;
+	unsigned int now = TizenTimer_Now();
+	int open = 0;
+
+	ithread_mutex_lock(&TizenBreakerMutex);
+	host = TizenBreaker_Find(url, 0);
+	if (host) {
+		if (TIZEN_BREAKER_OPEN == host->circuit)
+			open = (int)(now - host->reopen) < 0;
+		else
+			open = TIZEN_BREAKER_HALF_OPEN == host->circuit;
+		if (open)
+			host->rejected++;
+	}
+	ithread_mutex_unlock(&TizenBreakerMutex);
+
+	return open;
+}
+
+int TizenBreaker_GetState(const char *url, struct tizen_breaker_state *state)
+{
+	struct tizen_breaker_host *host;
+	unsigned int now = TizenTimer_Now();
+
+	ithread_mutex_lock(&TizenBreakerMutex);
+	host = TizenBreaker_Find(url, 0);
+	if (host) {
+		state->circuit = host->circuit;
+		state->requests = host->requests;
+		state->failures = host->failures;
+		state->rejected = host->rejected;
+		state->consecutive = host->consecutive;
+		state->p50 = host->p50;
+		state->p95 = host->p95;
+		state->timeout = host->timeout;
+		state->retry = TIZEN_BREAKER_OPEN == host->circuit &&
+			(int)(host->reopen - now) > 0 ?
+			(int)(host->reopen - now) : 0;
+	}
+	ithread_mutex_unlock(&TizenBreakerMutex);
+
+	return host ? 0 : -1;
+}
+
+const char *TizenBreaker_CircuitName(int circuit)
+{
+	switch (circuit) {
+	case TIZEN_BREAKER_CLOSED:
+		return "closed";
+	case TIZEN_BREAKER_OPEN:
+		return "open";
+	case TIZEN_BREAKER_HALF_OPEN:
+		return "half open";
+	}
+
+	return "unknown";
+}
+
+void TizenBreaker_Clear(void)
+{
+	ithread_mutex_lock(&TizenBreakerMutex);
+	memset(TizenBreakerHosts, 0, sizeof(TizenBreakerHosts));
+	ithread_mutex_unlock(&TizenBreakerMutex);
+}
+
+/*! @} Circuit Breaker */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,174 @@
+#ifndef UPNP_TIZEN_BREAKER_H
+#define UPNP_TIZEN_BREAKER_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Circuit Breaker
+ *
+ * Keeps the health of every device host (the host and port of its URLs)
+ * so that a TV that dropped off the network does not hold a sender thread
+ * for a whole timeout on every request.
+ *
+ * Every request made to a host is bracketed by TizenBreaker_Allow() and
+ * TizenBreaker_Report(). The round trips of the answered requests give the
+ * timeout of the next ones: a few times their 95th percentile, within
+ * bounds. After TIZEN_BREAKER_FAILURES failures in a row the circuit opens
+ * and requests fail at once. Once the cool-down has passed, a single probe
+ * request is let through (half open): its success closes the circuit, its
+ * failure opens it again for twice as long.
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Failures in a row that open the circuit. */
+#define TIZEN_BREAKER_FAILURES	3
+
+/*! Seconds the circuit first stays open, doubled by every failed probe up
+ * to TIZEN_BREAKER_MAX_COOLDOWN. */
+#define TIZEN_BREAKER_COOLDOWN	5
+#define TIZEN_BREAKER_MAX_COOLDOWN	120
+
+/*! Round trips kept per host. */
+#define TIZEN_BREAKER_SAMPLES	32
+
+/*! Round trips needed before the timeout adapts. */
+#define TIZEN_BREAKER_MIN_SAMPLES	8
+
+/*! Shortest adaptive timeout, in seconds. */
+#define TIZEN_BREAKER_MIN_TIMEOUT	2
+
+/*! Hosts tracked; the least recently used one makes room for a new one. */
+#define TIZEN_BREAKER_HOSTS	64
+
+/*! Circuit states. */
+enum tizen_breaker_circuit {
+	/*! Requests go through. */
+	TIZEN_BREAKER_CLOSED,
+	/*! Requests fail at once. */
+	TIZEN_BREAKER_OPEN,
+	/*! A probe request is on the wire, the others fail at once. */
+	TIZEN_BREAKER_HALF_OPEN
+};
+
+/*! The health of a host, see TizenBreaker_GetState(). */
+struct tizen_breaker_state {
+	/*! One of tizen_breaker_circuit. */
+	int circuit;
+	/*! Requests let through, and those of them that failed. */
+	unsigned int requests;
+	unsigned int failures;
+	/*! Requests failed at once by the open circuit. */
+	unsigned int rejected;
+	/*! Failures since the last success. */
+	unsigned int consecutive;
+	/*! Median and 95th percentile round trip, in milliseconds. 0 without
+	 * samples. */
+	unsigned int p50;
+	unsigned int p95;
+	/*! Timeout of the next request, in seconds. */
+	int timeout;
+	/*! Seconds until the next probe while the circuit is open. */
+	int retry;
+};
+
+/*!
+ * \brief Asks whether a request may be sent to the host of a URL.
+ *
+ * Every request let through must be followed by TizenBreaker_Report().
+ *
+ * \return 1 if the request may go, 0 if it must fail at once.
+ */
+int TizenBreaker_Allow(
+	/*! [in] A URL of the device. */
+	const char *url,
+	/*! [in] The timeout to use while the host is unknown or has too few
+	 * samples, in seconds. Also the longest adaptive timeout. */
+	int fallback,
+	/*! [out] The timeout of the request, in seconds. May be NULL. */
+	int *timeout);
+
+/*!
+ * \brief Records the outcome of a request let through by
+ * TizenBreaker_Allow().
+ */
+void TizenBreaker_Report(
+	/*! [in] The URL given to TizenBreaker_Allow(). */
+	const char *url,
+	/*! [in] Non-zero if the host answered, whatever the answer. */
+	int answered,
+	/*! [in] The round trip, in milliseconds. */
+	unsigned int rtt);
+
+/*!
+ * \brief Tells whether the circuit of a host is not closed, without
+ * asking for a request. For requests whose outcome cannot be reported.
+ *
+ * \return 1 if requests to the host should fail at once, 0 otherwise.
+ */
+int TizenBreaker_IsOpen(
+	/*! [in] A URL of the device. */
+	const char *url);
+
+/*!
+ * \brief Returns the health of the host of a URL.
+ *
+ * \return 0 on success, -1 if the host is not tracked.
+ */
+int TizenBreaker_GetState(
+	/*! [in] A URL of the device. */
+	const char *url,
+	/*! [out] Its health. */
+	struct tizen_breaker_state *state);
+
+/*!
+ * \brief Returns the name of a circuit state, e.g. "closed".
+ */
+const char *TizenBreaker_CircuitName(
+	/*! [in] One of tizen_breaker_circuit. */
+	int circuit);
+
+/*!
+ * \brief Forgets every host.
+ */
+void TizenBreaker_Clear(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Circuit Breaker */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_BREAKER_H */
@@ -0,0 +1,438 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Device Cache
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_cache.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TIZEN_CACHE_MAGIC	"TZDC"
+#define TIZEN_CACHE_VERSION	1
+
+/*! Size of one copy of a record, header included. */
+#define TIZEN_CACHE_COPY_SIZE	1024
+
+/*! Slots of a new cache file; the file doubles when it is full. */
+#define TIZEN_CACHE_MIN_SLOTS	32
+
+/*! Size of the file header, one cache line. */
+#define TIZEN_CACHE_HEADER_SIZE	64
+
+/*! Number of strings of a record. */
+#define TIZEN_CACHE_STRINGS \
+	(4 + 3 * TIZEN_SERVICE_SERVCOUNT + \
+	 TIZEN_SERVICE_SERVCOUNT * TIZEN_MAXVARS)
+
+struct tizen_cache_header {
+	char magic[4];
+	unsigned int version;
+	unsigned int copysize;
+	unsigned int slots;
+};
+
+/*! Header of one copy of a record. The payload follows. */
+struct tizen_cache_copy {
+	/*! Generation, 0 if the copy is not valid. Written last. */
+	unsigned int gen;
+	/*! Payload length. */
+	unsigned int len;
+	/*! FNV-1a of gen, len and the payload. */
+	unsigned int sum;
+	unsigned int reserved;
+};
+
+#define TIZEN_CACHE_PAYLOAD_MAX \
+	(TIZEN_CACHE_COPY_SIZE - sizeof(struct tizen_cache_copy))
+
+/*! Protects the mapping and TizenCacheUsed. Static, so that a late store
+ * racing with TizenCache_Close() never sees a destroyed mutex. */
+static ithread_mutex_t TizenCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+static int TizenCacheFd = -1;
+static char *TizenCacheMap = NULL;
+static size_t TizenCacheMapSize = 0;
+static unsigned int TizenCacheSlots = 0;
+/*! Per slot: non-zero if owned by a device. */
+static unsigned char *TizenCacheUsed = NULL;
+
+/********************************************************************************
+ * TizenCache_Copy
+ *
+ * Description:
+ *       Returns one of the two copies of a slot.
+ *
+ ********************************************************************************/
+static struct tizen_cache_copy *TizenCache_Copy(unsigned int slot, int which)
+{
+	return (struct tizen_cache_copy *)(TizenCacheMap +
+		TIZEN_CACHE_HEADER_SIZE +
+		((size_t)slot * 2 + which) * TIZEN_CACHE_COPY_SIZE);
+}
+
+static unsigned int TizenCache_Sum(unsigned int gen, unsigned int len,
+	const char *data)
+{
+	unsigned int hash = 2166136261u;
+	unsigned int i;
+
+	hash = (hash ^ gen) * 16777619u;
+	hash = (hash ^ len) * 16777619u;
+	for (i = 0; i < len; i++)
+		hash = (hash ^ (unsigned char)data[i]) * 16777619u;
+
+	return hash;
+}
+
+/********************************************************************************
+ * TizenCache_Valid
+ *
+ * Description:
+ *       Tells whether a copy holds a complete record.
+ *
+ ********************************************************************************/
+static int TizenCache_Valid(const struct tizen_cache_copy *copy)
+{
+	unsigned int gen = __atomic_load_n(&copy->gen, __ATOMIC_ACQUIRE);
+
+	return gen != 0 && copy->len <= TIZEN_CACHE_PAYLOAD_MAX &&
+		copy->sum == TizenCache_Sum(gen, copy->len,
+			(const char *)(copy + 1));
+}
+
+/********************************************************************************
+ * TizenCache_Map
+ *
+ * Description:
+ *       Sizes the file for the given number of slots and maps it. Called with
+ *       TizenCacheMutex held (or before the cache is shared).
+ *
+ ********************************************************************************/
+static int TizenCache_Map(unsigned int slots)
+{
+	size_t size = TIZEN_CACHE_HEADER_SIZE +
+		(size_t)slots * 2 * TIZEN_CACHE_COPY_SIZE;
+	unsigned char *used;
+	void *map;
+
+	used = (unsigned char *)realloc(TizenCacheUsed, slots);
+	if (!used)
+		return -1;
+	TizenCacheUsed = used;
+	if (ftruncate(TizenCacheFd, (off_t)size) != 0)
+		return -1;
+	map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		TizenCacheFd, 0);
+	if (map == MAP_FAILED)
+		return -1;
+	if (TizenCacheMap)
+		munmap(TizenCacheMap, TizenCacheMapSize);
+	if (slots > TizenCacheSlots)
+		memset(TizenCacheUsed + TizenCacheSlots, 0,
+			slots - TizenCacheSlots);
+	TizenCacheMap = (char *)map;
+	TizenCacheMapSize = size;
+	TizenCacheSlots = slots;
+	((struct tizen_cache_header *)TizenCacheMap)->slots = slots;
+
+	return 0;
+}
+
+int TizenCache_Open(const char *path)
+{
+	struct tizen_cache_header header;
+	struct stat st;
+	unsigned int slots = TIZEN_CACHE_MIN_SLOTS;
+	int valid = 0;
+
+	TizenCacheFd = open(path, O_RDWR | O_CREAT, 0600);
+	if (TizenCacheFd < 0) {
+		SampleUtil_Print("Error opening device cache %s\n", path);
+		return -1;
+	}
+	if (fstat(TizenCacheFd, &st) == 0 &&
+	    (size_t)st.st_size >= TIZEN_CACHE_HEADER_SIZE &&
+	    pread(TizenCacheFd, &header, sizeof(header), 0) ==
+	    (ssize_t)sizeof(header) &&
+	    memcmp(header.magic, TIZEN_CACHE_MAGIC, 4) == 0 &&
+	    header.version == TIZEN_CACHE_VERSION &&
+	    header.copysize == TIZEN_CACHE_COPY_SIZE &&
+	    header.slots > 0 &&
+	    (size_t)st.st_size >= TIZEN_CACHE_HEADER_SIZE +
+	    (size_t)header.slots * 2 * TIZEN_CACHE_COPY_SIZE) {
+		valid = 1;
+		slots = header.slots;
+	}
+	if (!valid && ftruncate(TizenCacheFd, 0) != 0)
+		goto __open_error;
+	if (TizenCache_Map(slots) != 0)
+		goto __open_error;
+	if (!valid) {
+		memcpy(header.magic, TIZEN_CACHE_MAGIC, 4);
+		header.version = TIZEN_CACHE_VERSION;
+		header.copysize = TIZEN_CACHE_COPY_SIZE;
+		header.slots = slots;
+		memcpy(TizenCacheMap, &header, sizeof(header));
+	}
+
+	return 0;
+
+__open_error :
+	SampleUtil_Print("Error mapping device cache %s\n", path);
+	close(TizenCacheFd);
+	TizenCacheFd = -1;
+
+	return -1;
+}
+
+void TizenCache_Close(void)
+{
+	if (TizenCacheFd < 0)
+		return;
+	ithread_mutex_lock(&TizenCacheMutex);
+	munmap(TizenCacheMap, TizenCacheMapSize);
+	close(TizenCacheFd);
+	TizenCacheMap = NULL;
+	TizenCacheMapSize = 0;
+	TizenCacheSlots = 0;
+	TizenCacheFd = -1;
+	free(TizenCacheUsed);
+	TizenCacheUsed = NULL;
+	ithread_mutex_unlock(&TizenCacheMutex);
+}
+
+/********************************************************************************
+ * TizenCache_Strings
+ *
+ * Description:
+ *       Lists the string fields of an entry in payload order.
+ *
+ ********************************************************************************/
+static void TizenCache_Strings(struct tizen_cache_entry *entry,
+	const char ***fields)
+{
+	int n = 0, service, var;
+
+	fields[n++] = &entry->info.UDN;
+	fields[n++] = &entry->info.DescDocURL;
+	fields[n++] = &entry->info.FriendlyName;
+	fields[n++] = &entry->info.PresURL;
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		fields[n++] = &entry->info.ServiceId[service];
+		fields[n++] = &entry->info.EventURL[service];
+		fields[n++] = &entry->info.ControlURL[service];
+	}
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++)
+		for (var = 0; var < TIZEN_MAXVARS; var++)
+			fields[n++] = &entry->State[service][var];
+}
+
+/********************************************************************************
+ * TizenCache_Encode
+ *
+ * Description:
+ *       Serializes an entry: the deadline, then every string as a two byte
+ *       length, the bytes and a NUL.
+ *
+ * Returns:
+ *   The payload length, or 0 if it does not fit in buf.
+ *
+ ********************************************************************************/
+static unsigned int TizenCache_Encode(const struct tizen_cache_entry *entry,
+	char *buf, unsigned int size)
+{
+	const char **fields[TIZEN_CACHE_STRINGS];
+	unsigned int pos, len;
+	int i;
+
+	TizenCache_Strings((struct tizen_cache_entry *)entry, fields);
+	memcpy(buf, &entry->Deadline, sizeof(entry->Deadline));
+	pos = sizeof(entry->Deadline);
+	for (i = 0; i < TIZEN_CACHE_STRINGS; i++) {
+		len = *fields[i] ? (unsigned int)strlen(*fields[i]) : 0;
+		if (len > 0xffff || pos + len + 3 > size)
+			return 0;
+		buf[pos] = (char)(len >> 8);
+		buf[pos + 1] = (char)(len & 0xff);
+		memcpy(buf + pos + 2, *fields[i] ? *fields[i] : "", len);
+		buf[pos + 2 + len] = '\0';
+		pos += len + 3;
+	}
+
+	return pos;
+}
+
+/********************************************************************************
+ * TizenCache_Decode
+ *
+ * Description:
+ *       Points the fields of entry into a payload written by
+ *       TizenCache_Encode.
+ *
+ * Returns:
+ *   0 on success, -1 if the payload is malformed.
+ *
+ ********************************************************************************/
+static int TizenCache_Decode(const char *buf, unsigned int size,
+	struct tizen_cache_entry *entry)
+{
+	const char **fields[TIZEN_CACHE_STRINGS];
+	unsigned int pos, len;
+	int i;
+
+	if (size < sizeof(entry->Deadline))
+		return -1;
+	TizenCache_Strings(entry, fields);
+	memcpy(&entry->Deadline, buf, sizeof(entry->Deadline));
+	pos = sizeof(entry->Deadline);
+	for (i = 0; i < TIZEN_CACHE_STRINGS; i++) {
+		if (pos + 3 > size)
+			return -1;
+		len = ((unsigned int)(unsigned char)buf[pos] << 8) |
+			(unsigned char)buf[pos + 1];
+		if (pos + len + 3 > size || buf[pos + 2 + len] != '\0')
+			return -1;
+		*fields[i] = buf + pos + 2;
+		pos += len + 3;
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenCache_Erase
+ *
+ * Description:
+ *       Invalidates both copies of a slot and frees it. Called with
+ *       TizenCacheMutex held.
+ *
+ ********************************************************************************/
+static void TizenCache_Erase(unsigned int slot)
+{
+	__atomic_store_n(&TizenCache_Copy(slot, 0)->gen, 0u, __ATOMIC_RELEASE);
+	__atomic_store_n(&TizenCache_Copy(slot, 1)->gen, 0u, __ATOMIC_RELEASE);
+	TizenCacheUsed[slot] = 0;
+}
+
+int TizenCache_Load(tizen_cache_visit visit, void *cookie)
+{
+	struct tizen_cache_entry entry;
+	struct tizen_cache_copy *copy, *c0, *c1;
+	unsigned int slot;
+	int kept = 0;
+
+	if (TizenCacheFd < 0)
+		return 0;
+	for (slot = 0; slot < TizenCacheSlots; slot++) {
+		c0 = TizenCache_Copy(slot, 0);
+		c1 = TizenCache_Copy(slot, 1);
+		if (!TizenCache_Valid(c0))
+			copy = TizenCache_Valid(c1) ? c1 : NULL;
+		else if (!TizenCache_Valid(c1))
+			copy = c0;
+		else
+			copy = (int)(c1->gen - c0->gen) > 0 ? c1 : c0;
+		memset(&entry, 0, sizeof(entry));
+		if (copy && TizenCache_Decode((const char *)(copy + 1),
+		    copy->len, &entry) == 0 &&
+		    visit(&entry, (int)slot, cookie)) {
+			TizenCacheUsed[slot] = 1;
+			kept++;
+		} else {
+			TizenCache_Erase(slot);
+		}
+	}
+
+	return kept;
+}
+
+int TizenCache_Store(int *slot, const struct tizen_cache_entry *entry)
+{
+	char payload[TIZEN_CACHE_PAYLOAD_MAX];
+	struct tizen_cache_copy *copy, *other;
+	unsigned int len, gen, i;
+	int ret = -1;
+
+	len = TizenCache_Encode(entry, payload, sizeof(payload));
+	if (!len)
+		return -1;
+	ithread_mutex_lock(&TizenCacheMutex);
+	if (*slot == TIZEN_CACHE_DEAD || !TizenCacheMap)
+		goto __finish_store;
+	if (*slot < 0) {
+		for (i = 0; i < TizenCacheSlots && TizenCacheUsed[i]; i++)
+			;
+		if (i == TizenCacheSlots && TizenCache_Map(i * 2) != 0)
+			goto __finish_store;
+		TizenCacheUsed[i] = 1;
+		*slot = (int)i;
+		__atomic_store_n(&TizenCache_Copy(i, 0)->gen, 0u,
+			__ATOMIC_RELEASE);
+		__atomic_store_n(&TizenCache_Copy(i, 1)->gen, 0u,
+			__ATOMIC_RELEASE);
+	}
+	/* Overwrite the older (or invalid) copy, keep the other one intact */
+	copy = TizenCache_Copy((unsigned int)*slot, 0);
+	other = TizenCache_Copy((unsigned int)*slot, 1);
+	if (TizenCache_Valid(copy) &&
+	    (!TizenCache_Valid(other) || (int)(copy->gen - other->gen) > 0)) {
+		copy = other;
+		other = TizenCache_Copy((unsigned int)*slot, 0);
+	}
+	gen = TizenCache_Valid(other) ? other->gen + 1 : 1;
+	if (gen == 0)
+		gen = 1;
+	__atomic_store_n(&copy->gen, 0u, __ATOMIC_RELEASE);
+	memcpy(copy + 1, payload, len);
+	copy->len = len;
+	copy->sum = TizenCache_Sum(gen, len, payload);
+	__atomic_store_n(&copy->gen, gen, __ATOMIC_RELEASE);
+	ret = 0;
+
+__finish_store :
+	ithread_mutex_unlock(&TizenCacheMutex);
+
+	return ret;
+}
+
+void TizenCache_Drop(int *slot)
+{
+	ithread_mutex_lock(&TizenCacheMutex);
+	if (*slot >= 0 && TizenCacheMap)
+		TizenCache_Erase((unsigned int)*slot);
+	*slot = TIZEN_CACHE_DEAD;
+	ithread_mutex_unlock(&TizenCacheMutex);
+}
+
+/*! @} Device Cache */
+
+/*! @} UpnpSamples */
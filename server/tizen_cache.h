@@ -0,0 +1,131 @@
+#ifndef UPNP_TIZEN_CACHE_H
+#define UPNP_TIZEN_CACHE_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Device Cache
+ *
+ * Persistent copy of the device registry, so that a restarted control point
+ * can use the devices it knew right away instead of waiting for a search.
+ *
+ * The cache is a memory-mapped file of fixed size slots, one per device.
+ * Every slot holds two copies of its record. An update rewrites the older
+ * copy and publishes it by bumping its generation last; a checksum covers
+ * the rest. A process killed in the middle of an update therefore leaves the
+ * previous copy intact, and a torn copy is simply ignored on load.
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_ctrl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Slot value of a device that is not cached yet. */
+#define TIZEN_CACHE_NONE	(-1)
+/*! Slot value of a device that is gone: TizenCache_Store() ignores it. */
+#define TIZEN_CACHE_DEAD	(-2)
+
+/*! One cached device. Strings may be NULL when storing. */
+struct tizen_cache_entry {
+	struct tizen_device_info info;
+	/*! Last known value of every state variable. */
+	const char *State[TIZEN_SERVICE_SERVCOUNT][TIZEN_MAXVARS];
+	/*! Wall clock time (time()) at which the advertisement expires. */
+	long long Deadline;
+};
+
+/*!
+ * \brief Called by TizenCache_Load() for every valid record. The strings of
+ * the entry are only valid during the call.
+ *
+ * \return Non-zero to keep the record (its slot is then owned by the caller
+ * and must be passed to TizenCache_Store()/TizenCache_Drop()), 0 to drop it.
+ */
+typedef int (*tizen_cache_visit)(
+	const struct tizen_cache_entry *entry,
+	int slot,
+	void *cookie);
+
+/*!
+ * \brief Maps the cache file, creating or resetting it if it is missing or
+ * not a cache of this version.
+ *
+ * \return 0 on success, -1 on error (the cache then stays disabled).
+ */
+int TizenCache_Open(
+	/*! [in] Path of the cache file. */
+	const char *path);
+
+/*!
+ * \brief Unmaps the cache file. The records stay on disk.
+ */
+void TizenCache_Close(void);
+
+/*!
+ * \brief Walks every valid record of the cache. Must be called right after
+ * TizenCache_Open(), before any store.
+ *
+ * \return The number of records kept.
+ */
+int TizenCache_Load(
+	/*! [in] Called for every record. */
+	tizen_cache_visit visit,
+	/*! [in] Passed to visit. */
+	void *cookie);
+
+/*!
+ * \brief Writes the record of a device.
+ *
+ * \return 0 on success, -1 if the cache is disabled, full or the record too
+ * large.
+ */
+int TizenCache_Store(
+	/*! [in,out] The slot of the device, TIZEN_CACHE_NONE to allocate one. */
+	int *slot,
+	/*! [in] The record. */
+	const struct tizen_cache_entry *entry);
+
+/*!
+ * \brief Erases the record of a device and sets *slot to TIZEN_CACHE_DEAD.
+ */
+void TizenCache_Drop(
+	/*! [in,out] The slot of the device. */
+	int *slot);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Device Cache */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_CACHE_H */
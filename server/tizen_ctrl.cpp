@@ -42,16 +42,41 @@
  */
 
 #include "tizen_ctrl.h"
+#include "tizen_breaker.h"
+#include "tizen_cache.h"
+#include "tizen_desc.h"
+#include "tizen_fetch.h"
+#include "tizen_http.h"
+#include "tizen_schema.h"
+#include "tizen_soap.h"
+#include "tizen_xml.h"
 
 #include "upnp.h"
 
+#include <errno.h>
+#include <stddef.h>
+#include <time.h>
+
 /*!
  * Mutex for protecting the global device list in a multi-threaded,
- * asynchronous environment. All functions should lock this mutex before
- * reading or writing the device list. 
+ * asynchronous environment. All functions must lock this mutex before
+ * modifying the device list. Readers only need an RCU read section
+ * (TizenRcu_ReadLock), see tizen_registry.h. No network I/O is done while it
+ * is held: subscriptions run unlocked and removed nodes are unsubscribed by
+ * the reaper thread.
  */
 ithread_mutex_t DeviceListMutex;
 
+/*! Devices come and go in bursts, so grab nodes a page or so at a time. */
+#define TIZEN_NODE_POOL_SLAB	16
+
+struct tizen_pool TizenNodePool;
+struct tizen_pool TizenFreshPool;
+
+/* A node with its state table has to fit in eight cache lines. */
+typedef char TizenDeviceNodeSizeCheck[
+	sizeof(struct TizenDeviceNode) <= 512 ? 1 : -1];
+
 UpnpClient_Handle ctrlpt_handle = -1;
 
 /*! Device type for tizen device. */
@@ -66,85 +91,615 @@ const char *TizenWebRoot = "../web";
 const char *TizenWebRoot = "/usr/share/web";
 #endif
 const char *TizenUrlFile = "/tmp/my_url.txt";
+const char *TizenCacheFile = "/tmp/tizen_devices.cache";
 const char *TizenFilename = "/tmp/my_filename.txt";
 unsigned short port = 0;
 char *ip_address = NULL;
 /*!
-   Global arrays for storing variable names and counts for 
-   TizenControl and TizenPicture services 
+   Timeout to request during subscriptions 
+ */
+int default_timeout = 1801;
+
+int TizenCtrlPointVarTTL = 60;
+
+int TizenCtrlPointActionWindow = TIZEN_ACTION_WINDOW;
+
+/*!
+ * GetVar queries on the wire, one per device, service and variable. A
+ * GetVar for a variable already in the list joins that query instead of
+ * sending another one. An entry is the cookie of its query and is removed
+ * when the query completes.
  */
-const char *TizenVarName[TIZEN_SERVICE_SERVCOUNT][TIZEN_MAXVARS] = {
-    {"Power", "Channel", "Volume", "", ""},
-    {"Color", "Tint", "Contrast", "Brightness", "Text"}
+struct tizen_getvar {
+	TizenDeviceHandle Handle;
+	int Service;
+	struct tizen_getvar *Next;
+	char VarName[1];
+};
+static ithread_mutex_t GetVarMutex;
+static struct tizen_getvar *GetVarInFlight = NULL;
+/* GetVars answered locally, sent, and joined to a query in flight */
+static unsigned int GetVarLocal = 0;
+static unsigned int GetVarQueries = 0;
+static unsigned int GetVarJoined = 0;
+
+/*! Coalescing counters of an action, see TizenCtrlPointSendActionNumericArg. */
+struct tizen_coalesce_stats {
+	/* Values given, requests sent, and values replaced by a newer one
+	 * before they could be sent */
+	unsigned int Requested;
+	unsigned int Sent;
+	unsigned int Replaced;
+	struct tizen_coalesce_stats *Next;
+	char Action[1];
 };
-char TizenVarCount[TIZEN_SERVICE_SERVCOUNT] =
-    { TIZEN_CONTROL_VARCOUNT, TIZEN_PICTURE_VARCOUNT };
 
 /*!
-   Timeout to request during subscriptions 
+ * Single-value actions on the wire, one per device, service and action. A
+ * value given for an action in the list waits in Pending, replacing the
+ * one waiting already. An entry is the cookie of its request and is
+ * removed once its request completes with nothing pending.
  */
-int default_timeout = 1801;
+struct tizen_coalesce {
+	TizenDeviceHandle Handle;
+	int Service;
+	int Pending;
+	int HasPending;
+	struct tizen_coalesce_stats *Stats;
+	struct tizen_coalesce *Next;
+	char *Action;
+	char *ParamName;
+};
+/* Protects CoalesceInFlight, the entries and CoalesceStats */
+static ithread_mutex_t CoalesceMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tizen_coalesce *CoalesceInFlight = NULL;
+static struct tizen_coalesce_stats *CoalesceStats = NULL;
+
+/*!
+ * Reaper queue: removed nodes waiting for their unsubscribes, see
+ * TizenCtrlPointReaperLoop.
+ */
+static ithread_mutex_t ReaperMutex;
+static ithread_cond_t ReaperCond;
+static struct TizenDeviceNode *ReaperQueue = NULL;
+static int ReaperRun = 0;
+static int ReaperBusy = 0;
+
+/*!
+ * Number of subscriptions whose SID is not indexed yet. GENA may deliver
+ * the initial event before UpnpSubscribe returns the SID to us, so while
+ * there are some an event with an unknown SID is parked (see
+ * TizenCtrlPointParkEvent).
+ */
+static ithread_mutex_t SubscribeMutex;
+static int SubscribeInFlight = 0;
+
+/*!
+ * Events with an unknown SID, oldest first, delivered once their SID is
+ * indexed (TizenCtrlPointReplayEvents) or dropped after TIZEN_EVENT_SID_WAIT.
+ */
+struct tizen_parked_event {
+	Upnp_SID SID;
+	int EventKey;
+	/* TizenTimer_Now() when it was parked */
+	unsigned int Parked;
+	IXML_Document *Changes;
+	struct tizen_parked_event *Next;
+};
+/* Protects ParkedEvents and ParkedCount */
+static ithread_mutex_t ParkMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tizen_parked_event *ParkedEvents = NULL;
+static int ParkedCount = 0;
+
+/*! Most events parked at once: the oldest one makes room for a new one. */
+#define TIZEN_EVENT_PARK_MAX	16
+
+/*!
+ * Advertisement timers of every registered device, protected by
+ * DeviceListMutex.
+ */
+static struct tizen_wheel AdvrWheel;
+
+/*!
+ * A subscription being made. It is sent with UpnpSubscribeAsync, the entry
+ * being the cookie of the request, and retried from SubscribeWheel with a
+ * growing delay until the device accepts it or goes away.
+ */
+struct tizen_subscription {
+	struct tizen_timer Timer;
+	TizenDeviceHandle Handle;
+	int Service;
+	/* Seconds before the next retry, doubled by every failure */
+	int Backoff;
+	/* TizenTimer_NowMs() when the request was sent */
+	unsigned int Start;
+	/* TIZEN_REVALIDATE_* for a device restored from the device cache */
+	int Revalidate;
+	struct tizen_subscription *Next;
+	char EventURL[1];
+};
+/*! The subscriptions of a restored device are not retried until all of
+ * them have been answered: if every one was refused the device is gone. */
+#define TIZEN_REVALIDATE_PENDING	1
+#define TIZEN_REVALIDATE_REFUSED	2
+/* Protects Subscriptions, SubscribeWheel and the counters below */
+static ithread_mutex_t SubscriptionMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tizen_subscription *Subscriptions = NULL;
+static struct tizen_wheel SubscribeWheel;
+/* Subscriptions asked for, accepted, and retried */
+static unsigned int SubscribeAsked = 0;
+static unsigned int SubscribeAccepted = 0;
+static unsigned int SubscribeRetried = 0;
+
+/*! Subscriptions ask for up to this percentage less than default_timeout,
+ * at random, so that devices found together do not all renew (10 seconds
+ * before their timeout, see libupnp) in the same second. */
+#define TIZEN_SUBSCRIBE_JITTER	10
+
+/*! Seconds before the first retry of a failed subscription, and the
+ * longest delay between retries. */
+#define TIZEN_SUBSCRIBE_RETRY	5
+#define TIZEN_SUBSCRIBE_MAX_RETRY	300
+
+/*! A device is searched for again this many seconds before its
+ * advertisement runs out. */
+#define TIZEN_ADVR_RESEARCH_LEAD	60
+
+/*! MX of the re-search, in seconds. */
+#define TIZEN_ADVR_RESEARCH_MX	30
+
+/*!
+ * Devices whose cache record is out of date. They are written in batches by
+ * the timer thread (TizenCtrlPointFlushCache), so that an event does not
+ * wait for the cache lock. A device is queued once until it is written.
+ */
+#define TIZEN_CACHE_DIRTY_DEADLINE	1
+#define TIZEN_CACHE_DIRTY_STATE		2
+static ithread_mutex_t CacheDirtyMutex = PTHREAD_MUTEX_INITIALIZER;
+static TizenDeviceHandle *CacheDirty = NULL;
+static int CacheDirtyCount = 0;
+static int CacheDirtySize = 0;
+
+/*! Set while the control point shuts down: the devices removed then stay
+ * in the device cache for the next start. */
+static int TizenCtrlPointStopping = 0;
+
+/*! Description downloads run on their own threads, see tizen_fetch.h, so
+ * that a discovery burst cannot starve the libupnp pool that also delivers
+ * events and action completions. */
+#define TIZEN_FETCH_WORKERS	2
+
+/*! Maximum number of descriptions waiting for a fetch thread. */
+#define TIZEN_FETCH_QUEUE	32
+
+/*! Timeout of a description download, in seconds. */
+#define TIZEN_DESC_FETCH_TIMEOUT	30
+
+/*! Actions sent from their templates are POSTed by their own threads, see
+ * tizen_soap.h. As many as the default multicast window, so that a
+ * multicast reaches its devices concurrently. */
+#define TIZEN_SOAP_WORKERS	TIZEN_MCAST_WINDOW
+
+/*! Timeout of an action request, in seconds. */
+#define TIZEN_SOAP_TIMEOUT	30
+
+/*! Most in arguments an action may take. */
+#define TIZEN_ACTION_MAXARGS	16
+
+/*! Completion of an action sent from a DOM, see
+ * TizenCtrlPointSendActionTracked. */
+struct tizen_action_relay {
+	tizen_soap_callback Callback;
+	void *Cookie;
+	/* TizenTimer_NowMs() when the request was sent */
+	unsigned int Start;
+};
+
+/*!
+ * An action submitted with TizenCtrlPointSubmitAction. Its arguments are
+ * copied after the structure.
+ */
+struct tizen_action {
+	/* Held by the submitter and, until completion, by the queue */
+	int Refs;
+	int Done;
+	int Service;
+	TizenDeviceHandle Handle;
+	unsigned int Submitted;
+	unsigned int Dispatched;
+	struct tizen_action_result Result;
+	TizenActionCallback Callback;
+	void *Cookie;
+	/* Protects Refs and Done */
+	ithread_mutex_t Mutex;
+	/* Signalled once Done is set */
+	ithread_cond_t Cond;
+	/* Link in the queue of the device */
+	struct tizen_action *Next;
+	char *ActionName;
+	int ParamCount;
+	const char *ParamName[TIZEN_ACTION_MAXARGS];
+	char *ParamVal[TIZEN_ACTION_MAXARGS];
+};
 
 /*!
-   The first node in the global device list, or NULL if empty 
+ * The submitted actions of a device, in order. They leave Head for the
+ * wire while fewer than TizenCtrlPointActionWindow are in flight. A queue
+ * is removed once it is empty with nothing in flight.
  */
-struct TizenDeviceNode *GlobalDeviceList = NULL;
+struct tizen_action_queue {
+	TizenDeviceHandle Handle;
+	int InFlight;
+	struct tizen_action *Head;
+	struct tizen_action *Tail;
+	struct tizen_action_queue *Next;
+};
+
+/* Hash buckets of the action queues, by device handle */
+#define TIZEN_ACTION_BUCKETS	32
+struct tizen_action_bucket {
+	/* Protects the queues of the bucket */
+	ithread_mutex_t Mutex;
+	struct tizen_action_queue *Queues;
+};
+static struct tizen_action_bucket ActionBuckets[TIZEN_ACTION_BUCKETS];
+/* Actions submitted, completed successfully and failed */
+static unsigned int ActionSubmitted = 0;
+static unsigned int ActionSucceeded = 0;
+static unsigned int ActionFailed = 0;
+
+/*! How long an event with an unknown SID stays parked, in seconds. */
+#define TIZEN_EVENT_SID_WAIT	5
 
 /********************************************************************************
- * TizenCtrlPointDeleteNode
+ * TizenCtrlPointFreeNode
+ *
+ * Description: 
+ *       Give a device node back to TizenNodePool. Called through
+ *       TizenRcu_Retire once no reader can hold a reference to the node any
+ *       more. The state table lives inside the node, its freshness in
+ *       TizenFreshPool; the strings only need their references and arena
+ *       dropped.
+ *
+ * Parameters:
+ *   ptr -- The device node
+ *
+ ********************************************************************************/
+static void TizenCtrlPointFreeNode(void *ptr)
+{
+	struct TizenDeviceNode *node = (struct TizenDeviceNode *)ptr;
+	int service;
+	int var;
+
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		TizenIntern_Put(node->device.TizenService[service].ServiceId);
+		TizenIntern_Put(node->device.TizenService[service].ServiceType);
+		for (var = 0; var < TIZEN_MAXVARS; var++)
+			TizenValue_Clear(
+				&node->device.TizenService[service].State[var]);
+	}
+	TizenArena_Release(&node->Arena);
+	ithread_mutex_destroy(&node->StateMutex);
+	TizenPool_Free(&TizenFreshPool, node->device.TizenService[0].Fresh);
+	TizenPool_Free(&TizenNodePool, node);
+}
+
+/********************************************************************************
+ * TizenCtrlPointCacheNode
  *
  * Description: 
- *       Delete a device node from the global device list.  Note that this
- *       function is NOT thread safe, and should be called from another
- *       function that has already locked the global device list.
+ *       Write a device, its last known state and its advertisement deadline
+ *       to the device cache. Called by TizenCtrlPointFlushCache.
  *
  * Parameters:
  *   node -- The device node
+ *   force -- 0 to skip the write if only the deadline changed, and by
+ *            less than TIZEN_ADVR_RESEARCH_LEAD
  *
  ********************************************************************************/
-int
-TizenCtrlPointDeleteNode( struct TizenDeviceNode *node )
+static void TizenCtrlPointCacheNode(struct TizenDeviceNode *node, int force)
+{
+	struct tizen_cache_entry entry;
+	unsigned int deadline;
+	int service, var, moved;
+
+	memset(&entry, 0, sizeof(entry));
+	entry.info.UDN = node->device.UDN;
+	entry.info.DescDocURL = node->device.DescDocURL;
+	entry.info.FriendlyName = node->device.FriendlyName;
+	entry.info.PresURL = node->device.PresURL;
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		entry.info.ServiceId[service] =
+		    node->device.TizenService[service].ServiceId;
+		entry.info.EventURL[service] =
+		    node->device.TizenService[service].EventURL;
+		entry.info.ControlURL[service] =
+		    node->device.TizenService[service].ControlURL;
+	}
+
+	ithread_mutex_lock(&node->StateMutex);
+	deadline = __atomic_load_n(&node->device.AdvrDeadline,
+				   __ATOMIC_RELAXED);
+	moved = (int)(deadline - node->CacheDeadline);
+	if (force || node->CacheSlot == TIZEN_CACHE_NONE ||
+	    moved >= TIZEN_ADVR_RESEARCH_LEAD ||
+	    moved <= -TIZEN_ADVR_RESEARCH_LEAD) {
+		/* Only short values, so that a record stays small. The others
+		 * come back with the initial event of the subscription */
+		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++)
+			for (var = 0; var < TIZEN_MAXVARS; var++)
+				entry.State[service][var] =
+				    node->device.TizenService[service].State[var].Spilled ?
+				    "" : TizenValue_Text(
+				    &node->device.TizenService[service].State[var]);
+		entry.Deadline = (long long)time(NULL) +
+			(int)(deadline - TizenTimer_Now());
+		if (TizenCache_Store(&node->CacheSlot, &entry) == 0)
+			node->CacheDeadline = deadline;
+	}
+	ithread_mutex_unlock(&node->StateMutex);
+}
+
+/********************************************************************************
+ * TizenCtrlPointMarkDirty
+ *
+ * Description: 
+ *       Queue a registered device for TizenCtrlPointFlushCache. Lock-free
+ *       when it is queued already.
+ *
+ * Parameters:
+ *   node -- The device node
+ *   what -- TIZEN_CACHE_DIRTY_STATE if its state changed,
+ *           TIZEN_CACHE_DIRTY_DEADLINE if only its deadline did
+ *
+ ********************************************************************************/
+static void TizenCtrlPointMarkDirty(struct TizenDeviceNode *node, int what)
 {
-	int rc, service, var;
+	TizenDeviceHandle *handles;
+	int size;
+
+	if (__atomic_fetch_or(&node->CacheDirty, what, __ATOMIC_ACQ_REL))
+		return;
+	ithread_mutex_lock(&CacheDirtyMutex);
+	if (CacheDirtyCount == CacheDirtySize) {
+		size = CacheDirtySize ? CacheDirtySize * 2 : 64;
+		handles = (TizenDeviceHandle *)realloc(CacheDirty,
+			(size_t)size * sizeof(*handles));
+		if (!handles) {
+			ithread_mutex_unlock(&CacheDirtyMutex);
+			/* Written with its next change */
+			__atomic_store_n(&node->CacheDirty, 0, __ATOMIC_RELEASE);
+			SampleUtil_Print("Out of memory queueing %s for the cache\n",
+					 node->device.UDN);
+			return;
+		}
+		CacheDirty = handles;
+		CacheDirtySize = size;
+	}
+	CacheDirty[CacheDirtyCount++] = node->Handle;
+	ithread_mutex_unlock(&CacheDirtyMutex);
+}
 
-	if (NULL == node) {
-		SampleUtil_Print
-		    ("ERROR: TizenCtrlPointDeleteNode: Node is empty\n");
-		return TIZEN_ERROR;
+/********************************************************************************
+ * TizenCtrlPointFlushCache
+ *
+ * Description: 
+ *       Write the devices queued by TizenCtrlPointMarkDirty to the device
+ *       cache. Runs on the timer thread, and once more at shutdown. The
+ *       devices removed since they were queued are skipped.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointFlushCache(void)
+{
+	struct TizenDeviceNode *node;
+	TizenDeviceHandle *handles;
+	int count, i, what, rcu;
+
+	ithread_mutex_lock(&CacheDirtyMutex);
+	handles = CacheDirty;
+	count = CacheDirtyCount;
+	CacheDirty = NULL;
+	CacheDirtyCount = 0;
+	CacheDirtySize = 0;
+	ithread_mutex_unlock(&CacheDirtyMutex);
+
+	rcu = TizenRcu_ReadLock();
+	for (i = 0; i < count; i++) {
+		node = TizenRegistry_FindByHandle(handles[i]);
+		if (!node)
+			continue;
+		/* A change from now on queues the device again */
+		what = __atomic_exchange_n(&node->CacheDirty, 0,
+					   __ATOMIC_ACQ_REL);
+		if (what)
+			TizenCtrlPointCacheNode(node,
+				what & TIZEN_CACHE_DIRTY_STATE);
 	}
+	TizenRcu_ReadUnlock(rcu);
+	free(handles);
+}
+
+/********************************************************************************
+ * TizenCtrlPointArmAdvr
+ *
+ * Description: 
+ *       (Re)start the advertisement timer of a device. O(1). Must be called
+ *       with DeviceListMutex held.
+ *
+ * Parameters:
+ *   node -- The device node
+ *   expires -- The advertised max-age, in seconds
+ *
+ ********************************************************************************/
+static void TizenCtrlPointArmAdvr(struct TizenDeviceNode *node, int expires)
+{
+	unsigned int now = TizenTimer_Now();
+	unsigned int deadline;
+	unsigned int fire;
+
+	if (expires < 0)
+		expires = 0;
+	deadline = now + (unsigned int)expires;
+	/* Read without DeviceListMutex by TizenCtrlPointCacheNode */
+	__atomic_store_n(&node->device.AdvrDeadline, deadline,
+			 __ATOMIC_RELAXED);
+	fire = deadline;
+	if (expires > TIZEN_ADVR_RESEARCH_LEAD)
+		fire -= TIZEN_ADVR_RESEARCH_LEAD;
+	TizenWheel_Arm(&AdvrWheel, &node->AdvrTimer, fire);
+	/* The cache may grow its file: written later, without the lock */
+	TizenCtrlPointMarkDirty(node, TIZEN_CACHE_DIRTY_DEADLINE);
+}
+
+/********************************************************************************
+ * TizenCtrlPointReapNode
+ *
+ * Description: 
+ *       Cancel the subscriptions of a removed device node, notify its
+ *       removal and retire it. Runs on the reaper thread with no lock held.
+ *       The unsubscribes are asynchronous, so an unreachable device does
+ *       not hold up the nodes queued behind it.
+ *
+ * Parameters:
+ *   node -- The device node
+ *
+ ********************************************************************************/
+static void TizenCtrlPointReapNode(struct TizenDeviceNode *node)
+{
+	Upnp_SID sid;
+	int rc, service;
 
 	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		ithread_mutex_lock(&node->StateMutex);
+		strncpy(sid, node->device.TizenService[service].SID,
+			sizeof(sid) - 1);
+		sid[sizeof(sid) - 1] = '\0';
+		ithread_mutex_unlock(&node->StateMutex);
 		/*
 		   If we have a valid control SID, then unsubscribe 
 		 */
-		if (strcmp(node->device.TizenService[service].SID, "") != 0) {
-			rc = UpnpUnSubscribe(ctrlpt_handle,
-					     node->device.TizenService[service].
-					     SID);
+		if (strcmp(sid, "") != 0) {
+			rc = UpnpUnSubscribeAsync(ctrlpt_handle, sid,
+				TizenCtrlPointCallbackEventHandler, NULL);
 			if (UPNP_E_SUCCESS == rc) {
 				SampleUtil_Print
-				    ("Unsubscribed from Tizen %s EventURL with SID=%s\n",
-				     TizenServiceName[service],
-				     node->device.TizenService[service].SID);
+				    ("Unsubscribing from Tizen %s EventURL with SID=%s\n",
+				     TizenServiceName[service], sid);
 			} else {
 				SampleUtil_Print
 				    ("Error unsubscribing to Tizen %s EventURL -- %d\n",
 				     TizenServiceName[service], rc);
 			}
 		}
+	}
 
-		for (var = 0; var < TizenVarCount[service]; var++) {
-			if (node->device.TizenService[service].VariableStrVal[var]) {
-				free(node->device.
-				     TizenService[service].VariableStrVal[var]);
-			}
+	/* A device that is gone for good leaves the cache too */
+	if (!TizenCtrlPointStopping) {
+		ithread_mutex_lock(&node->StateMutex);
+		TizenCache_Drop(&node->CacheSlot);
+		ithread_mutex_unlock(&node->StateMutex);
+	}
+
+	/* Only devices that were announced as added are announced as removed */
+	if (node->Handle != TIZEN_INVALID_HANDLE)
+		SampleUtil_StateUpdate(NULL, NULL, node->device.UDN,
+				       DEVICE_REMOVED);
+	TizenRcu_Retire(node, TizenCtrlPointFreeNode);
+}
+
+/*!
+ * \brief Background thread that unsubscribes and releases the nodes handed
+ * over by TizenCtrlPointDeleteNode, so that the network round trips never
+ * run under DeviceListMutex.
+ */
+static void *TizenCtrlPointReaperLoop(void *args)
+{
+	struct TizenDeviceNode *list, *node, *next;
+
+	ithread_mutex_lock(&ReaperMutex);
+	for (;;) {
+		while (!ReaperQueue && ReaperRun)
+			ithread_cond_wait(&ReaperCond, &ReaperMutex);
+		if (!ReaperQueue)
+			break;
+		/* The queue is LIFO, reverse it to reap in removal order */
+		list = NULL;
+		for (node = ReaperQueue; node; node = next) {
+			next = node->ReapNext;
+			node->ReapNext = list;
+			list = node;
 		}
+		ReaperQueue = NULL;
+		ReaperBusy = 1;
+		ithread_mutex_unlock(&ReaperMutex);
+
+		for (node = list; node; node = next) {
+			next = node->ReapNext;
+			TizenCtrlPointReapNode(node);
+		}
+
+		ithread_mutex_lock(&ReaperMutex);
+		ReaperBusy = 0;
+		ithread_cond_broadcast(&ReaperCond);
 	}
+	ReaperBusy = 0;
+	ithread_cond_broadcast(&ReaperCond);
+	ithread_mutex_unlock(&ReaperMutex);
 
-	/*Notify New Device Added */
-	SampleUtil_StateUpdate(NULL, NULL, node->device.UDN, DEVICE_REMOVED);
-	free(node);
-	node = NULL;
+	return NULL;
+	args = args;
+}
+
+/********************************************************************************
+ * TizenCtrlPointStopReaper
+ *
+ * Description: 
+ *       Let the reaper drain its queue, then stop it.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointStopReaper(void)
+{
+	ithread_mutex_lock(&ReaperMutex);
+	ReaperRun = 0;
+	ithread_cond_broadcast(&ReaperCond);
+	while (ReaperQueue || ReaperBusy)
+		ithread_cond_wait(&ReaperCond, &ReaperMutex);
+	ithread_mutex_unlock(&ReaperMutex);
+}
+
+/********************************************************************************
+ * TizenCtrlPointDeleteNode
+ *
+ * Description: 
+ *       Delete a device node that has been unlinked from the global device
+ *       list.  The node is handed to the reaper thread, which cancels its
+ *       subscriptions and retires it, so this never blocks on the network
+ *       and may be called with DeviceListMutex held.
+ *
+ * Parameters:
+ *   node -- The device node
+ *
+ ********************************************************************************/
+int
+TizenCtrlPointDeleteNode( struct TizenDeviceNode *node )
+{
+	if (NULL == node) {
+		SampleUtil_Print
+		    ("ERROR: TizenCtrlPointDeleteNode: Node is empty\n");
+		return TIZEN_ERROR;
+	}
+
+	ithread_mutex_lock(&ReaperMutex);
+	if (!ReaperRun && !ReaperBusy) {
+		/* Reaper stopped (or never started): reap inline */
+		ithread_mutex_unlock(&ReaperMutex);
+		TizenCtrlPointReapNode(node);
+		return TIZEN_SUCCESS;
+	}
+	node->ReapNext = ReaperQueue;
+	ReaperQueue = node;
+	ithread_cond_signal(&ReaperCond);
+	ithread_mutex_unlock(&ReaperMutex);
 
 	return TIZEN_SUCCESS;
 }
@@ -162,30 +717,18 @@ TizenCtrlPointDeleteNode( struct TizenDeviceNode *node )
 int TizenCtrlPointRemoveDevice(const char *UDN)
 {
 	struct TizenDeviceNode *curdevnode;
-	struct TizenDeviceNode *prevdevnode;
 
 	ithread_mutex_lock(&DeviceListMutex);
 
-	curdevnode = GlobalDeviceList;
-	if (!curdevnode) {
+	if (!TizenRegistry_Count()) {
 		SampleUtil_Print(
 			"WARNING: TizenCtrlPointRemoveDevice: Device list empty\n");
 	} else {
-		if (0 == strcmp(curdevnode->device.UDN, UDN)) {
-			GlobalDeviceList = curdevnode->next;
+		curdevnode = TizenRegistry_Find(UDN);
+		if (curdevnode) {
+			TizenWheel_Cancel(&curdevnode->AdvrTimer);
+			TizenRegistry_Remove(curdevnode);
 			TizenCtrlPointDeleteNode(curdevnode);
-		} else {
-			prevdevnode = curdevnode;
-			curdevnode = curdevnode->next;
-			while (curdevnode) {
-				if (strcmp(curdevnode->device.UDN, UDN) == 0) {
-					prevdevnode->next = curdevnode->next;
-					TizenCtrlPointDeleteNode(curdevnode);
-					break;
-				}
-				prevdevnode = curdevnode;
-				curdevnode = curdevnode->next;
-			}
 		}
 	}
 
@@ -206,18 +749,17 @@ int TizenCtrlPointRemoveDevice(const char *UDN)
  ********************************************************************************/
 int TizenCtrlPointRemoveAll(void)
 {
-	struct TizenDeviceNode *curdevnode, *next;
+	struct TizenDeviceNode **nodes;
+	int count, i;
 
 	ithread_mutex_lock(&DeviceListMutex);
 
-	curdevnode = GlobalDeviceList;
-	GlobalDeviceList = NULL;
-
-	while (curdevnode) {
-		next = curdevnode->next;
-		TizenCtrlPointDeleteNode(curdevnode);
-		curdevnode = next;
+	count = TizenRegistry_TakeAll(&nodes);
+	for (i = 0; i < count; i++) {
+		TizenWheel_Cancel(&nodes[i]->AdvrTimer);
+		TizenCtrlPointDeleteNode(nodes[i]);
 	}
+	free(nodes);
 
 	ithread_mutex_unlock(&DeviceListMutex);
 
@@ -225,21 +767,16 @@ int TizenCtrlPointRemoveAll(void)
 }
 
 /********************************************************************************
- * TizenCtrlPointRefresh
+ * TizenCtrlPointSearch
  *
  * Description: 
- *       Clear the current global device list and issue new search
- *	 requests to build it up again from scratch.
- *
- * Parameters:
- *   None
+ *       Issue a search request for every Tizen device.
  *
  ********************************************************************************/
-int TizenCtrlPointRefresh(void)
+static int TizenCtrlPointSearch(void)
 {
 	int rc;
 
-	TizenCtrlPointRemoveAll();
 	/* Search for all devices of type tizendevice version 1,
 	 * waiting for up to 5 seconds for the response */
 	rc = UpnpSearchAsync(ctrlpt_handle, 5, TizenDeviceType, NULL);
@@ -253,159 +790,1378 @@ int TizenCtrlPointRefresh(void)
 }
 
 /********************************************************************************
- * TizenCtrlPointGetVar
+ * TizenCtrlPointRefresh
  *
  * Description: 
- *       Send a GetVar request to the specified service of a device.
+ *       Clear the current global device list and issue new search
+ *	 requests to build it up again from scratch.
  *
  * Parameters:
- *   service -- The service
- *   devnum -- The number of the device (order in the list,
- *             starting with 1)
- *   varname -- The name of the variable to request.
+ *   None
  *
  ********************************************************************************/
-int TizenCtrlPointGetVar(int service, int devnum, const char *varname)
-{
-	struct TizenDeviceNode *devnode;
-	int rc;
-
-	ithread_mutex_lock(&DeviceListMutex);
-
-	rc = TizenCtrlPointGetDevice(devnum, &devnode);
-
-	if (TIZEN_SUCCESS == rc) {
-		rc = UpnpGetServiceVarStatusAsync(
-			ctrlpt_handle,
-			devnode->device.TizenService[service].ControlURL,
-			varname,
-			TizenCtrlPointCallbackEventHandler,
-			NULL);
-		if (rc != UPNP_E_SUCCESS) {
-			SampleUtil_Print(
-				"Error in UpnpGetServiceVarStatusAsync -- %d\n",
-				rc);
-			rc = TIZEN_ERROR;
-		}
-	}
-
-	ithread_mutex_unlock(&DeviceListMutex);
-
-	return rc;
-}
-
-int TizenCtrlPointGetPower(int devnum)
-{
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_CONTROL, devnum, "Power");
-}
-
-int TizenCtrlPointGetChannel(int devnum)
+int TizenCtrlPointRefresh(void)
 {
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_CONTROL, devnum, "Channel");
-}
+	TizenCtrlPointRemoveAll();
 
-int TizenCtrlPointGetVolume(int devnum)
-{
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_CONTROL, devnum, "Volume");
+	return TizenCtrlPointSearch();
 }
 
-int TizenCtrlPointGetColor(int devnum)
+/********************************************************************************
+ * TizenCtrlPointVarCount
+ *
+ * Description: 
+ *       Number of variables of a service tracked in the state tables: all
+ *       of them.
+ *
+ * Parameters:
+ *   schema -- The schema of the service, may be NULL
+ *
+ ********************************************************************************/
+static int TizenCtrlPointVarCount(const struct tizen_schema *schema)
 {
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Color");
+	/* TizenCtrlPointLoadSchemas rejects the SCPDs with more */
+	return schema ? schema->VarCount : 0;
 }
 
-int TizenCtrlPointGetTint(int devnum)
+/********************************************************************************
+ * TizenCtrlPointBeginGetVar
+ *
+ * Description: 
+ *       Register a GetVar query, unless the same query is already in flight.
+ *
+ * Parameters:
+ *   handle -- The handle of the device
+ *   service -- The service
+ *   varname -- The name of the variable
+ *   query -- Where to return the entry of a new query, the cookie to pass
+ *            to UpnpGetServiceVarStatusAsync. NULL if out of memory: the
+ *            query must then not be sent.
+ *
+ * Returns:
+ *   1 if the query is already in flight, 0 if it has to be sent.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointBeginGetVar(TizenDeviceHandle handle, int service,
+	const char *varname, struct tizen_getvar **query)
 {
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Tint");
-}
+	struct tizen_getvar *entry;
 
-int TizenCtrlPointGetContrast(int devnum)
-{
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Contrast");
-}
+	*query = NULL;
+	ithread_mutex_lock(&GetVarMutex);
+	for (entry = GetVarInFlight; entry; entry = entry->Next)
+		if (entry->Handle == handle && entry->Service == service &&
+		    strcmp(entry->VarName, varname) == 0)
+			break;
+	if (!entry) {
+		*query = (struct tizen_getvar *)malloc(sizeof(**query) +
+						       strlen(varname));
+		if (*query) {
+			(*query)->Handle = handle;
+			(*query)->Service = service;
+			strcpy((*query)->VarName, varname);
+			(*query)->Next = GetVarInFlight;
+			GetVarInFlight = *query;
+		}
+	}
+	ithread_mutex_unlock(&GetVarMutex);
+	__atomic_add_fetch(entry ? &GetVarJoined : &GetVarQueries, 1,
+			   __ATOMIC_RELAXED);
 
-int TizenCtrlPointGetBrightness(int devnum)
-{
-	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Brightness");
+	return entry != NULL;
 }
 
 /********************************************************************************
- * TizenCtrlPointSendAction
+ * TizenCtrlPointEndGetVar
  *
  * Description: 
- *       Send an Action request to the specified service of a device.
+ *       Remove a completed GetVar query from the queries in flight.
+ *
+ * Parameters:
+ *   query -- The entry from TizenCtrlPointBeginGetVar, may be NULL
+ *
+ ********************************************************************************/
+static void TizenCtrlPointEndGetVar(struct tizen_getvar *query)
+{
+	struct tizen_getvar **link;
+
+	if (!query)
+		return;
+	ithread_mutex_lock(&GetVarMutex);
+	for (link = &GetVarInFlight; *link; link = &(*link)->Next)
+		if (*link == query) {
+			*link = query->Next;
+			break;
+		}
+	ithread_mutex_unlock(&GetVarMutex);
+	free(query);
+}
+
+/********************************************************************************
+ * TizenCtrlPointReadVar
+ *
+ * Description: 
+ *       Read the locally known value of a state variable, without any
+ *       network I/O.
+ *
+ * Parameters:
+ *   service -- The service
+ *   handle -- The handle of the device
+ *   varname -- The name of the variable
+ *   reading -- The value, its age and where it comes from
+ *
+ * Returns:
+ *   TIZEN_SUCCESS, or TIZEN_ERROR if the device or the variable is unknown.
+ *
+ ********************************************************************************/
+int TizenCtrlPointReadVar(int service, TizenDeviceHandle handle,
+	const char *varname, struct tizen_var_reading *reading)
+{
+	const struct tizen_schema *schema;
+	const struct tizen_value *value;
+	struct TizenDeviceNode *devnode;
+	struct tizen_service *svc;
+	int var;
+	int rc;
+	int rcu;
+
+	schema = TizenSchema_Find(TizenServiceType[service]);
+	var = TizenSchema_VarIndex(schema, varname);
+	if (var < 0 || var >= TIZEN_MAXVARS)
+		return TIZEN_ERROR;
+
+	rcu = TizenRcu_ReadLock();
+	rc = TizenCtrlPointGetDeviceByHandle(handle, &devnode);
+	if (TIZEN_SUCCESS == rc) {
+		svc = &devnode->device.TizenService[service];
+		ithread_mutex_lock(&devnode->StateMutex);
+		value = &svc->State[var];
+		reading->Type = value->Type;
+		if (value->Type == TIZEN_TYPE_UINT)
+			reading->Num = value->Num.UInt;
+		else
+			reading->Num = value->Num.Int;
+		reading->Source = svc->Fresh->Source[var];
+		reading->Age = svc->Fresh->Source[var] == TIZEN_SOURCE_NONE ? -1 :
+			(int)(TizenTimer_Now() - svc->Fresh->Updated[var]);
+		strncpy(reading->Text, TizenValue_Text(value),
+			sizeof(reading->Text) - 1);
+		reading->Text[sizeof(reading->Text) - 1] = '\0';
+		ithread_mutex_unlock(&devnode->StateMutex);
+	}
+	TizenRcu_ReadUnlock(rcu);
+
+	return rc;
+}
+
+/********************************************************************************
+ * TizenCtrlPointGetVarComplete
+ *
+ * Description: 
+ *       Completion callback of the GetVar queries sent by the SOAP
+ *       threads, the counterpart of UPNP_CONTROL_GET_VAR_COMPLETE.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointGetVarComplete(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie)
+{
+	struct tizen_getvar *query = (struct tizen_getvar *)cookie;
+	const char *value;
+
+	value = 0 == errcode ? TizenSoap_QueryValue(response) : NULL;
+	if (!value)
+		SampleUtil_Print("Error in Get Var Complete Callback -- %d\n",
+				 errcode ? errcode : TIZEN_SOAP_TRANSPORT_ERROR);
+	else
+		TizenCtrlPointHandleGetVar(url, query->VarName, value);
+	TizenCtrlPointEndGetVar(query);
+	tmpl = tmpl;
+}
+
+/********************************************************************************
+ * TizenCtrlPointGetVarByHandle
+ *
+ * Description: 
+ *       Send a GetVar request to the specified service of a device.
+ *
+ * Parameters:
+ *   service -- The service
+ *   handle -- The handle of the device
+ *   varname -- The name of the variable to request.
+ *
+ ********************************************************************************/
+int TizenCtrlPointGetVarByHandle(int service, TizenDeviceHandle handle,
+	const char *varname)
+{
+	const struct tizen_schema *schema;
+	struct TizenDeviceNode *devnode;
+	struct tizen_service *svc;
+	struct tizen_getvar *query = NULL;
+	char *local = NULL;
+	int var = -1;
+	int rc;
+	int rcu;
+
+	rcu = TizenRcu_ReadLock();
+
+	rc = TizenCtrlPointGetDeviceByHandle(handle, &devnode);
+	schema = TizenSchema_Find(TizenServiceType[service]);
+	if (schema)
+		var = TizenSchema_VarIndex(schema, varname);
+	if (TIZEN_SUCCESS == rc && schema && var < 0) {
+		SampleUtil_Print("Error: Tizen %s Service has no variable %s\n",
+				 TizenServiceName[service], varname);
+		rc = TIZEN_ERROR;
+	}
+	/* Events keep an evented value up to date: if the device confirmed
+	 * it recently enough, it is the answer */
+	if (TIZEN_SUCCESS == rc && var >= 0 && var < TIZEN_MAXVARS &&
+	    schema->Vars[var].Evented) {
+		svc = &devnode->device.TizenService[service];
+		ithread_mutex_lock(&devnode->StateMutex);
+		if (svc->Fresh->Source[var] != TIZEN_SOURCE_NONE &&
+		    (int)(TizenTimer_Now() - svc->Fresh->Updated[var]) <=
+		    TizenCtrlPointVarTTL)
+			local = strdup(TizenValue_Text(&svc->State[var]));
+		ithread_mutex_unlock(&devnode->StateMutex);
+	}
+	if (local) {
+		__atomic_add_fetch(&GetVarLocal, 1, __ATOMIC_RELAXED);
+		SampleUtil_StateUpdate(varname, local, devnode->device.UDN,
+				       GET_VAR_COMPLETE);
+		free(local);
+	} else if (TIZEN_SUCCESS == rc &&
+		   !TizenCtrlPointBeginGetVar(handle, service, varname, &query)) {
+		if (!query) {
+			SampleUtil_Print("Out of memory, %s not queried\n",
+					 varname);
+			rc = TIZEN_ERROR;
+			goto __finish_getvar;
+		}
+		/* Over a kept-alive connection when the SOAP threads run */
+		if (TizenSoap_Send(devnode->device.
+				   TizenService[service].ControlURL,
+				   TizenSoap_QueryTemplate(), &varname,
+				   TizenCtrlPointGetVarComplete, query) == 0)
+			goto __finish_getvar;
+		if (TizenBreaker_IsOpen(devnode->device.
+				TizenService[service].ControlURL)) {
+			SampleUtil_Print("Device not answering, %s not queried\n",
+					 varname);
+			TizenCtrlPointEndGetVar(query);
+			rc = TIZEN_ERROR;
+			goto __finish_getvar;
+		}
+		rc = UpnpGetServiceVarStatusAsync(
+			ctrlpt_handle,
+			devnode->device.TizenService[service].ControlURL,
+			varname,
+			TizenCtrlPointCallbackEventHandler,
+			query);
+		if (rc != UPNP_E_SUCCESS) {
+			SampleUtil_Print(
+				"Error in UpnpGetServiceVarStatusAsync -- %d\n",
+				rc);
+			TizenCtrlPointEndGetVar(query);
+			rc = TIZEN_ERROR;
+		}
+	}
+
+__finish_getvar :
+
+	TizenRcu_ReadUnlock(rcu);
+
+	return rc;
+}
+
+/********************************************************************************
+ * TizenCtrlPointGetVar
+ *
+ * Description: 
+ *       Send a GetVar request to the specified service of a device.
+ *
+ * Parameters:
+ *   service -- The service
+ *   devnum -- The number of the device (order in the list,
+ *             starting with 1)
+ *   varname -- The name of the variable to request.
+ *
+ ********************************************************************************/
+int TizenCtrlPointGetVar(int service, int devnum, const char *varname)
+{
+	TizenDeviceHandle handle;
+
+	if (TizenCtrlPointGetHandle(devnum, &handle) != TIZEN_SUCCESS)
+		return TIZEN_ERROR;
+
+	return TizenCtrlPointGetVarByHandle(service, handle, varname);
+}
+
+int TizenCtrlPointGetPower(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_CONTROL, devnum, "Power");
+}
+
+int TizenCtrlPointGetChannel(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_CONTROL, devnum, "Channel");
+}
+
+int TizenCtrlPointGetVolume(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_CONTROL, devnum, "Volume");
+}
+
+int TizenCtrlPointGetColor(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Color");
+}
+
+int TizenCtrlPointGetTint(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Tint");
+}
+
+int TizenCtrlPointGetContrast(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Contrast");
+}
+
+int TizenCtrlPointGetBrightness(int devnum)
+{
+	return TizenCtrlPointGetVar(TIZEN_SERVICE_PICTURE, devnum, "Brightness");
+}
+
+/********************************************************************************
+ * TizenCtrlPointCheckAction
+ *
+ * Description: 
+ *       Check an action request against the schema of the service, and lay
+ *       out its argument values in SCPD order.
+ *
+ * Parameters:
+ *   schema -- The schema of the service
+ *   service -- The service
+ *   actionname -- The name of the action.
+ *   param_name -- An array of parameter names
+ *   param_val -- The corresponding parameter values
+ *   param_count -- The number of parameters
+ *   values -- Where to return the values, TIZEN_ACTION_MAXARGS entries
+ *   action -- Where to return the index of the action in the schema
+ *
+ ********************************************************************************/
+static int TizenCtrlPointCheckAction(
+	const struct tizen_schema *schema,
+	int service,
+	const char *actionname,
+	const char **param_name,
+	char **param_val,
+	int param_count,
+	const char **values,
+	int *action)
+{
+	const struct tizen_schema_action *act;
+	const struct tizen_schema_var *var;
+	long long num;
+	int param;
+	int arg;
+
+	*action = TizenSchema_ActionIndex(schema, actionname);
+	if (*action < 0) {
+		SampleUtil_Print("Error: Tizen %s Service has no action %s\n",
+				 TizenServiceName[service], actionname);
+		return TIZEN_ERROR;
+	}
+	act = &schema->Actions[*action];
+	if (param_count != act->InCount) {
+		SampleUtil_Print("Error: %s takes %d argument(s), not %d\n",
+				 actionname, act->InCount, param_count);
+		return TIZEN_ERROR;
+	}
+	if (act->InCount > TIZEN_ACTION_MAXARGS) {
+		SampleUtil_Print("Error: %s takes too many arguments\n",
+				 actionname);
+		return TIZEN_ERROR;
+	}
+	for (arg = 0; arg < act->InCount; arg++) {
+		for (param = 0; param < param_count; param++)
+			if (strcmp(param_name[param],
+				   act->Args[arg].Name) == 0)
+				break;
+		if (param == param_count) {
+			SampleUtil_Print("Error: %s needs argument %s\n",
+					 actionname, act->Args[arg].Name);
+			return TIZEN_ERROR;
+		}
+		var = act->Args[arg].Var >= 0 ?
+			&schema->Vars[act->Args[arg].Var] : NULL;
+		if (var && var->HasRange &&
+		    TizenValue_Parse(var->Type, param_val[param], &num) == 0 &&
+		    (num < var->Minimum || num > var->Maximum)) {
+			SampleUtil_Print("Error: %s = %s is out of range [%ld, %ld]\n",
+					 act->Args[arg].Name, param_val[param],
+					 var->Minimum, var->Maximum);
+			return TIZEN_ERROR;
+		}
+		values[arg] = param_val[param];
+	}
+
+	return TIZEN_SUCCESS;
+}
+
+/********************************************************************************
+ * TizenCtrlPointMakeAction
+ *
+ * Description: 
+ *       Build an action request as a DOM, for the services whose action
+ *       templates are not available (see tizen_soap.h).
+ *
+ * Parameters:
+ *   service -- The service
+ *   actionname -- The name of the action.
+ *   param_name -- An array of parameter names
+ *   param_val -- The corresponding parameter values
+ *   param_count -- The number of parameters
+ *   actionNode -- Where to return the request, to be freed by the caller
+ *                 even on error
+ *
+ ********************************************************************************/
+static int TizenCtrlPointMakeAction(
+	int service,
+	const char *actionname,
+	const char **param_name,
+	const char **param_val,
+	int param_count,
+	IXML_Document **actionNode)
+{
+	int param;
+
+	*actionNode = UpnpMakeAction(actionname, TizenServiceType[service],
+				     0, NULL);
+	for (param = 0; param < param_count; param++) {
+		if (UpnpAddToAction(actionNode, actionname,
+		    TizenServiceType[service], param_name[param],
+		    param_val[param]) != UPNP_E_SUCCESS) {
+			SampleUtil_Print("ERROR: TizenCtrlPointSendAction: "
+					 "Trying to add action param\n");
+			return TIZEN_ERROR;
+		}
+	}
+
+	return TIZEN_SUCCESS;
+}
+
+/********************************************************************************
+ * TizenCtrlPointActionComplete
+ *
+ * Description: 
+ *       Completion callback of the actions sent from a template. Like the
+ *       UPNP_CONTROL_ACTION_COMPLETE ones, only failures are reported:
+ *       state changes come back as events.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointActionComplete(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie)
+{
+	if (errcode != 0)
+		SampleUtil_Print("Error in  Action Complete Callback -- %d (%s)\n",
+				 errcode, url);
+	tmpl = tmpl;
+	response = response;
+	cookie = cookie;
+}
+
+/********************************************************************************
+ * TizenCtrlPointRelayActionComplete
+ *
+ * Description: 
+ *       UPnP callback of an action sent from a DOM: hands its outcome to
+ *       the tizen_soap_callback in the relay cookie, the way the SOAP
+ *       client would.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointRelayActionComplete(Upnp_EventType EventType,
+	void *Event, void *Cookie)
+{
+	struct tizen_action_relay *relay = (struct tizen_action_relay *)Cookie;
+	struct Upnp_Action_Complete *a_event =
+		(struct Upnp_Action_Complete *)Event;
+	DOMString response = NULL;
+	int errcode;
+
+	if (EventType != UPNP_CONTROL_ACTION_COMPLETE)
+		return 0;
+	/* Faults carry their UPnP error code, other failures are negative */
+	errcode = a_event->ErrCode;
+	TizenBreaker_Report(a_event->CtrlUrl, errcode >= 0,
+			    TizenTimer_NowMs() - relay->Start);
+	if (errcode < 0)
+		errcode = TIZEN_SOAP_TRANSPORT_ERROR;
+	else if (a_event->ActionResult)
+		response = ixmlPrintDocument(a_event->ActionResult);
+	relay->Callback(errcode, a_event->CtrlUrl, NULL, response,
+		relay->Cookie);
+	if (response)
+		ixmlFreeDOMString(response);
+	free(relay);
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenCtrlPointSendActionTracked
+ *
+ * Description: 
+ *       Send an Action request to the specified service of a device.
+ *       Once the SCPD of the service is loaded, the action is checked
+ *       against it and sent from its precompiled template, without
+ *       building a DOM. Either way its completion is reported to
+ *       callback, with a NULL template for a DOM built request.
+ *
+ * Parameters:
+ *   service -- The service
+ *   handle -- The handle of the device
+ *   actionname -- The name of the action.
+ *   param_name -- An array of parameter names
+ *   param_val -- The corresponding parameter values
+ *   param_count -- The number of parameters
+ *   callback -- The completion callback
+ *   cookie -- Passed to the callback
+ *   tracked -- Set to 1 if the callback will be called, 0 otherwise
+ *
+ ********************************************************************************/
+static int TizenCtrlPointSendActionTracked(
+	int service,
+	TizenDeviceHandle handle,
+	const char *actionname,
+	const char **param_name,
+	char **param_val,
+	int param_count,
+	tizen_soap_callback callback,
+	void *cookie,
+	int *tracked)
+{
+	const struct tizen_schema *schema;
+	const struct tizen_soap_template *tmpl = NULL;
+	const char *values[TIZEN_ACTION_MAXARGS];
+	const char *names[TIZEN_ACTION_MAXARGS];
+	struct TizenDeviceNode *devnode;
+	struct tizen_action_relay *relay = NULL;
+	IXML_Document *actionNode = NULL;
+	int rc = TIZEN_SUCCESS;
+	int action, arg;
+	int rcu;
+
+	*tracked = 0;
+	schema = TizenSchema_Find(TizenServiceType[service]);
+	if (schema) {
+		rc = TizenCtrlPointCheckAction(schema, service, actionname,
+			param_name, param_val, param_count, values, &action);
+		if (rc != TIZEN_SUCCESS)
+			return rc;
+		tmpl = TizenSoap_Find(schema, action);
+		for (arg = 0; arg < param_count; arg++)
+			names[arg] = schema->Actions[action].Args[arg].Name;
+	} else {
+		/* Not loaded yet: send what we were given */
+		if (param_count > TIZEN_ACTION_MAXARGS)
+			return TIZEN_ERROR;
+		for (arg = 0; arg < param_count; arg++) {
+			names[arg] = param_name[arg];
+			values[arg] = param_val[arg];
+		}
+	}
+
+	rcu = TizenRcu_ReadLock();
+	rc = TizenCtrlPointGetDeviceByHandle(handle, &devnode);
+	if (TIZEN_SUCCESS == rc && tmpl) {
+		if (TizenSoap_Send(devnode->device.
+				   TizenService[service].ControlURL, tmpl,
+				   values, callback, cookie) != 0) {
+			SampleUtil_Print("Error in TizenSoap_Send\n");
+			rc = TIZEN_ERROR;
+		} else {
+			*tracked = 1;
+		}
+	} else if (TIZEN_SUCCESS == rc) {
+		rc = TizenCtrlPointMakeAction(service, actionname, names,
+			values, param_count, &actionNode);
+	}
+	if (actionNode && TIZEN_SUCCESS == rc) {
+		relay = (struct tizen_action_relay *)malloc(sizeof(*relay));
+		if (relay) {
+			relay->Callback = callback;
+			relay->Cookie = cookie;
+			relay->Start = TizenTimer_NowMs();
+		}
+		/* Only a relay reports the outcome to the breaker */
+		if (relay ? !TizenBreaker_Allow(devnode->device.
+				TizenService[service].ControlURL,
+				TIZEN_SOAP_TIMEOUT, NULL) :
+		    TizenBreaker_IsOpen(devnode->device.
+				TizenService[service].ControlURL)) {
+			SampleUtil_Print("Device not answering, %s not sent\n",
+					 actionname);
+			free(relay);
+			relay = NULL;
+			rc = TIZEN_ERROR;
+		}
+	}
+	if (actionNode && TIZEN_SUCCESS == rc) {
+		rc = UpnpSendActionAsync(ctrlpt_handle,
+					 devnode->device.
+					 TizenService[service].ControlURL,
+					 TizenServiceType[service], NULL,
+					 actionNode, relay ?
+					 TizenCtrlPointRelayActionComplete :
+					 TizenCtrlPointCallbackEventHandler,
+					 relay);
+
+		if (rc != UPNP_E_SUCCESS) {
+			SampleUtil_Print("Error in UpnpSendActionAsync -- %d\n",
+					 rc);
+			free(relay);
+			rc = TIZEN_ERROR;
+		} else if (relay) {
+			*tracked = 1;
+		}
+	}
+
+	TizenRcu_ReadUnlock(rcu);
+
+	if (actionNode)
+		ixmlDocument_free(actionNode);
+	
+
+	return rc;
+}
+
+/********************************************************************************
+ * TizenCtrlPointSendActionByHandle
+ *
+ * Description: 
+ *       Send an Action request to the specified service of a device.
+ *
+ * Parameters:
+ *   service -- The service
+ *   handle -- The handle of the device
+ *   actionname -- The name of the action.
+ *   param_name -- An array of parameter names
+ *   param_val -- The corresponding parameter values
+ *   param_count -- The number of parameters
+ *
+ ********************************************************************************/
+int TizenCtrlPointSendActionByHandle(
+	int service,
+	TizenDeviceHandle handle,
+	const char *actionname,
+	const char **param_name,
+	char **param_val,
+	int param_count)
+{
+	int tracked;
+
+	return TizenCtrlPointSendActionTracked(service, handle, actionname,
+		param_name, param_val, param_count,
+		TizenCtrlPointActionComplete, NULL, &tracked);
+}
+
+/********************************************************************************
+ * TizenCtrlPointSendAction
+ *
+ * Description: 
+ *       Send an Action request to the specified service of a device.
+ *
+ * Parameters:
+ *   service -- The service
+ *   devnum -- The number of the device (order in the list,
+ *             starting with 1)
+ *   actionname -- The name of the action.
+ *   param_name -- An array of parameter names
+ *   param_val -- The corresponding parameter values
+ *   param_count -- The number of parameters
+ *
+ ********************************************************************************/
+int TizenCtrlPointSendAction(
+	int service,
+	int devnum,
+	const char *actionname,
+	const char **param_name,
+	char **param_val,
+	int param_count)
+{
+	TizenDeviceHandle handle;
+
+	if (TizenCtrlPointGetHandle(devnum, &handle) != TIZEN_SUCCESS)
+		return TIZEN_ERROR;
+
+	return TizenCtrlPointSendActionByHandle(service, handle, actionname,
+		param_name, param_val, param_count);
+}
+
+/********************************************************************************
+ * TizenCtrlPointActionBucket
+ *
+ * Description: 
+ *       Returns the hash bucket of the action queue of a device.
+ *
+ ********************************************************************************/
+static struct tizen_action_bucket *TizenCtrlPointActionBucket(
+	TizenDeviceHandle handle)
+{
+	return &ActionBuckets[(unsigned int)handle % TIZEN_ACTION_BUCKETS];
+}
+
+/********************************************************************************
+ * TizenCtrlPointReleaseAction
+ *
+ * Description: 
+ *       Drops a reference to a submitted action, and frees it with its
+ *       response when it was the last one.
+ *
+ * Parameters:
+ *   action -- The action, from TizenCtrlPointSubmitAction
+ *
+ ********************************************************************************/
+void TizenCtrlPointReleaseAction(struct tizen_action *action)
+{
+	int refs;
+
+	if (!action)
+		return;
+	ithread_mutex_lock(&action->Mutex);
+	refs = --action->Refs;
+	ithread_mutex_unlock(&action->Mutex);
+	if (refs > 0)
+		return;
+	ithread_cond_destroy(&action->Cond);
+	ithread_mutex_destroy(&action->Mutex);
+	free((char *)action->Result.Response);
+	free(action);
+}
+
+/********************************************************************************
+ * TizenCtrlPointFinishAction
+ *
+ * Description: 
+ *       Records the outcome of a submitted action, runs its callback, wakes
+ *       its waiters and drops the reference of its queue.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointFinishAction(struct tizen_action *action,
+	int errcode, const char *response)
+{
+	action->Result.ErrCode = errcode;
+	action->Result.Latency = TizenTimer_NowMs() - action->Dispatched;
+	if (response)
+		action->Result.Response = strdup(response);
+	__atomic_add_fetch(errcode ? &ActionFailed : &ActionSucceeded, 1,
+		__ATOMIC_RELAXED);
+	if (action->Callback)
+		action->Callback(action, &action->Result, action->Cookie);
+	ithread_mutex_lock(&action->Mutex);
+	action->Done = 1;
+	ithread_cond_broadcast(&action->Cond);
+	ithread_mutex_unlock(&action->Mutex);
+	TizenCtrlPointReleaseAction(action);
+}
+
+/********************************************************************************
+ * TizenCtrlPointActionLeft
+ *
+ * Description: 
+ *       Takes a completed request off the in flight count of its device.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointActionLeft(TizenDeviceHandle handle)
+{
+	struct tizen_action_bucket *bucket = TizenCtrlPointActionBucket(handle);
+	struct tizen_action_queue *queue;
+
+	ithread_mutex_lock(&bucket->Mutex);
+	for (queue = bucket->Queues; queue; queue = queue->Next)
+		if (queue->Handle == handle) {
+			queue->InFlight--;
+			break;
+		}
+	ithread_mutex_unlock(&bucket->Mutex);
+}
+
+/* Pumping the queue and completing an action call each other */
+static void TizenCtrlPointActionDone(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie);
+
+/********************************************************************************
+ * TizenCtrlPointPumpActions
+ *
+ * Description: 
+ *       Sends the actions at the head of the queue of a device while its
+ *       window allows, and removes the queue once it is idle. A request
+ *       that cannot be sent fails its action here.
+ *
+ * Parameters:
+ *   handle -- The handle of the device
+ *
+ ********************************************************************************/
+static void TizenCtrlPointPumpActions(TizenDeviceHandle handle)
+{
+	struct tizen_action_bucket *bucket = TizenCtrlPointActionBucket(handle);
+	struct tizen_action_queue **link, *queue;
+	struct tizen_action *action;
+	int window;
+	int tracked;
+
+	for (;;) {
+		window = TizenCtrlPointActionWindow > 0 ?
+			TizenCtrlPointActionWindow : 1;
+		ithread_mutex_lock(&bucket->Mutex);
+		for (link = &bucket->Queues; *link; link = &(*link)->Next)
+			if ((*link)->Handle == handle)
+				break;
+		queue = *link;
+		if (!queue || !queue->Head || queue->InFlight >= window) {
+			if (queue && !queue->Head && !queue->InFlight) {
+				*link = queue->Next;
+				free(queue);
+			}
+			ithread_mutex_unlock(&bucket->Mutex);
+			return;
+		}
+		action = queue->Head;
+		queue->Head = action->Next;
+		if (!queue->Head)
+			queue->Tail = NULL;
+		queue->InFlight++;
+		ithread_mutex_unlock(&bucket->Mutex);
+
+		action->Dispatched = TizenTimer_NowMs();
+		action->Result.Queued = action->Dispatched - action->Submitted;
+		TizenCtrlPointSendActionTracked(action->Service, handle,
+			action->ActionName, action->ParamName, action->ParamVal,
+			action->ParamCount, TizenCtrlPointActionDone, action,
+			&tracked);
+		if (!tracked) {
+			TizenCtrlPointFinishAction(action,
+				TIZEN_SOAP_TRANSPORT_ERROR, NULL);
+			TizenCtrlPointActionLeft(handle);
+		}
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointActionDone
+ *
+ * Description: 
+ *       Completion callback of a submitted action: finishes it and lets the
+ *       next action of the device go.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointActionDone(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie)
+{
+	struct tizen_action *action = (struct tizen_action *)cookie;
+	TizenDeviceHandle handle = action->Handle;
+
+	TizenCtrlPointFinishAction(action, errcode, response);
+	TizenCtrlPointActionLeft(handle);
+	TizenCtrlPointPumpActions(handle);
+	url = url;
+	tmpl = tmpl;
+}
+
+/********************************************************************************
+ * TizenCtrlPointSubmitAction
+ *
+ * Description: 
+ *       Queues an action behind the earlier ones of the same device. The
+ *       actions of a device are sent in submission order, at most
+ *       TizenCtrlPointActionWindow of them on the wire at once; other
+ *       devices do not wait for them.
  *
  * Parameters:
  *   service -- The service
- *   devnum -- The number of the device (order in the list,
- *             starting with 1)
+ *   handle -- The handle of the device
  *   actionname -- The name of the action.
  *   param_name -- An array of parameter names
  *   param_val -- The corresponding parameter values
  *   param_count -- The number of parameters
+ *   callback -- Called once the action completes, may be NULL
+ *   cookie -- Passed to the callback
+ *
+ * Returns:
+ *   The action, to be waited for with TizenCtrlPointWaitAction and
+ *   released with TizenCtrlPointReleaseAction, or NULL if the arguments
+ *   do not match the SCPD or the device is unknown.
  *
  ********************************************************************************/
-int TizenCtrlPointSendAction(
+struct tizen_action *TizenCtrlPointSubmitAction(
 	int service,
-	int devnum,
+	TizenDeviceHandle handle,
 	const char *actionname,
 	const char **param_name,
 	char **param_val,
-	int param_count)
+	int param_count,
+	TizenActionCallback callback,
+	void *cookie)
 {
+	struct tizen_action_bucket *bucket = TizenCtrlPointActionBucket(handle);
+	const struct tizen_schema *schema;
+	const char *values[TIZEN_ACTION_MAXARGS];
 	struct TizenDeviceNode *devnode;
-	IXML_Document *actionNode = NULL;
-	int rc = TIZEN_SUCCESS;
-	int param;
+	struct tizen_action_queue *queue;
+	struct tizen_action *action;
+	size_t size;
+	char *p;
+	int index;
+	int arg;
+	int rc;
+	int rcu;
+
+	if (param_count < 0 || param_count > TIZEN_ACTION_MAXARGS)
+		return NULL;
+	schema = TizenSchema_Find(TizenServiceType[service]);
+	if (schema && TizenCtrlPointCheckAction(schema, service, actionname,
+			param_name, param_val, param_count, values, &index) !=
+	    TIZEN_SUCCESS)
+		return NULL;
+	rcu = TizenRcu_ReadLock();
+	rc = TizenCtrlPointGetDeviceByHandle(handle, &devnode);
+	TizenRcu_ReadUnlock(rcu);
+	if (rc != TIZEN_SUCCESS)
+		return NULL;
+
+	size = sizeof(*action) + strlen(actionname) + 1;
+	for (arg = 0; arg < param_count; arg++)
+		size += strlen(param_name[arg]) + strlen(param_val[arg]) + 2;
+	action = (struct tizen_action *)calloc(1, size);
+	if (!action)
+		return NULL;
+	p = (char *)(action + 1);
+	action->ActionName = strcpy(p, actionname);
+	p += strlen(p) + 1;
+	for (arg = 0; arg < param_count; arg++) {
+		action->ParamName[arg] = strcpy(p, param_name[arg]);
+		p += strlen(p) + 1;
+		action->ParamVal[arg] = strcpy(p, param_val[arg]);
+		p += strlen(p) + 1;
+	}
+	action->ParamCount = param_count;
+	action->Refs = 2;
+	action->Service = service;
+	action->Handle = handle;
+	action->Callback = callback;
+	action->Cookie = cookie;
+	action->Result.ErrCode = TIZEN_SOAP_TRANSPORT_ERROR;
+	ithread_mutex_init(&action->Mutex, 0);
+	ithread_cond_init(&action->Cond, NULL);
+	action->Submitted = TizenTimer_NowMs();
+
+	ithread_mutex_lock(&bucket->Mutex);
+	for (queue = bucket->Queues; queue; queue = queue->Next)
+		if (queue->Handle == handle)
+			break;
+	if (!queue) {
+		queue = (struct tizen_action_queue *)calloc(1, sizeof(*queue));
+		if (!queue) {
+			ithread_mutex_unlock(&bucket->Mutex);
+			ithread_cond_destroy(&action->Cond);
+			ithread_mutex_destroy(&action->Mutex);
+			free(action);
+			return NULL;
+		}
+		queue->Handle = handle;
+		queue->Next = bucket->Queues;
+		bucket->Queues = queue;
+	}
+	if (queue->Tail)
+		queue->Tail->Next = action;
+	else
+		queue->Head = action;
+	queue->Tail = action;
+	ithread_mutex_unlock(&bucket->Mutex);
+	__atomic_add_fetch(&ActionSubmitted, 1, __ATOMIC_RELAXED);
 
-	ithread_mutex_lock(&DeviceListMutex);
-	rc = TizenCtrlPointGetDevice(devnum, &devnode);
-	if (TIZEN_SUCCESS == rc) {
-		if (0 == param_count) {
-			actionNode =
-			    UpnpMakeAction(actionname, TizenServiceType[service],
-					   0, NULL);
-		} else {
-			for (param = 0; param < param_count; param++) {
-				if (UpnpAddToAction
-				    (&actionNode, actionname,
-				     TizenServiceType[service], param_name[param],
-				     param_val[param]) != UPNP_E_SUCCESS) {
-					SampleUtil_Print
-					    ("ERROR: TizenCtrlPointSendAction: Trying to add action param\n");
-					/*return -1; // TBD - BAD! leaves mutex locked */
-				}
-			}
+	TizenCtrlPointPumpActions(handle);
+
+	return action;
+}
+
+/********************************************************************************
+ * TizenCtrlPointWaitAction
+ *
+ * Description: 
+ *       Waits for a submitted action to complete.
+ *
+ * Parameters:
+ *   action -- The action, from TizenCtrlPointSubmitAction
+ *   timeout -- Milliseconds to wait at most, -1 to wait as long as it
+ *              takes, 0 to poll
+ *   result -- Receives the outcome once the action completed, may be NULL
+ *
+ * Returns:
+ *   TIZEN_SUCCESS once the action completed, TIZEN_WARNING if it is still
+ *   pending when the timeout expires.
+ *
+ ********************************************************************************/
+int TizenCtrlPointWaitAction(struct tizen_action *action, int timeout,
+	struct tizen_action_result *result)
+{
+	struct timespec deadline;
+	int done;
+
+	if (timeout > 0) {
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_sec += timeout / 1000;
+		deadline.tv_nsec += (long)(timeout % 1000) * 1000000L;
+		if (deadline.tv_nsec >= 1000000000L) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000L;
 		}
-		
+	}
+	ithread_mutex_lock(&action->Mutex);
+	while (!action->Done && timeout != 0) {
+		if (timeout < 0)
+			ithread_cond_wait(&action->Cond, &action->Mutex);
+		else if (ithread_cond_timedwait(&action->Cond, &action->Mutex,
+						&deadline) == ETIMEDOUT)
+			break;
+	}
+	done = action->Done;
+	ithread_mutex_unlock(&action->Mutex);
+	if (!done)
+		return TIZEN_WARNING;
+	if (result)
+		*result = action->Result;
 
-		rc = UpnpSendActionAsync(ctrlpt_handle,
-					 devnode->device.
-					 TizenService[service].ControlURL,
-					 TizenServiceType[service], NULL,
-					 actionNode,
-					 TizenCtrlPointCallbackEventHandler, NULL);
+	return TIZEN_SUCCESS;
+}
 
-		if (rc != UPNP_E_SUCCESS) {
-			SampleUtil_Print("Error in UpnpSendActionAsync -- %d\n",
-					 rc);
-			rc = TIZEN_ERROR;
+/********************************************************************************
+ * TizenCtrlPointFailActions
+ *
+ * Description: 
+ *       Fails every action still waiting in a queue, once nothing can send
+ *       them any more, and drops the queues.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointFailActions(void)
+{
+	struct tizen_action_queue *queue;
+	struct tizen_action *action;
+	int bucket;
+
+	for (bucket = 0; bucket < TIZEN_ACTION_BUCKETS; bucket++) {
+		ithread_mutex_lock(&ActionBuckets[bucket].Mutex);
+		while ((queue = ActionBuckets[bucket].Queues) != NULL) {
+			ActionBuckets[bucket].Queues = queue->Next;
+			/* A callback may submit again: no lock held */
+			ithread_mutex_unlock(&ActionBuckets[bucket].Mutex);
+			while ((action = queue->Head) != NULL) {
+				queue->Head = action->Next;
+				action->Dispatched = TizenTimer_NowMs();
+				action->Result.Queued =
+					action->Dispatched - action->Submitted;
+				TizenCtrlPointFinishAction(action,
+					TIZEN_SOAP_TRANSPORT_ERROR, NULL);
+			}
+			free(queue);
+			ithread_mutex_lock(&ActionBuckets[bucket].Mutex);
 		}
+		ithread_mutex_unlock(&ActionBuckets[bucket].Mutex);
 	}
+}
 
-	ithread_mutex_unlock(&DeviceListMutex);
+/*! A multicast action in progress. */
+struct tizen_mcast {
+	ithread_mutex_t Mutex;
+	/*! Signalled whenever a request completes. */
+	ithread_cond_t Cond;
+	/*! Requests sent and not completed yet. */
+	int Outstanding;
+};
 
-	if (actionNode)
-		ixmlDocument_free(actionNode);
-	
+/*! One request of a multicast action, the cookie of TizenSoap_SendBody. */
+struct tizen_mcast_req {
+	struct tizen_mcast *Mcast;
+	struct tizen_mcast_status *Status;
+	/*! TizenTimer_NowMs() at dispatch. */
+	unsigned int Sent;
+};
+
+/********************************************************************************
+ * TizenCtrlPointMulticastComplete
+ *
+ * Description: 
+ *       Completion callback of the requests of a multicast action. Runs on
+ *       a SOAP sender thread.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointMulticastComplete(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie)
+{
+	struct tizen_mcast_req *req = (struct tizen_mcast_req *)cookie;
+	struct tizen_mcast *mcast = req->Mcast;
+
+	req->Status->ErrCode = errcode;
+	req->Status->Latency = TizenTimer_NowMs() - req->Sent;
+	ithread_mutex_lock(&mcast->Mutex);
+	mcast->Outstanding--;
+	ithread_cond_signal(&mcast->Cond);
+	ithread_mutex_unlock(&mcast->Mutex);
+	url = url;
+	tmpl = tmpl;
+	response = response;
+}
+
+/********************************************************************************
+ * TizenCtrlPointMulticastAction
+ *
+ * Description: 
+ *       Send the same action to a set of devices and wait until every
+ *       device has answered. The action is checked and its request written
+ *       once; the requests then run concurrently on the SOAP sender
+ *       threads, at most window of them at a time, so that the whole
+ *       multicast takes about as long as its slowest device. Must not be
+ *       called from a SOAP sender thread.
+ *
+ * Parameters:
+ *   service -- The service
+ *   actionname -- The name of the action.
+ *   param_name -- An array of parameter names
+ *   param_val -- The corresponding parameter values
+ *   param_count -- The number of parameters
+ *   handles -- The devices, NULL for every device
+ *   count -- The number of handles
+ *   filter -- Further selects the devices, may be NULL
+ *   filterarg -- Passed to the filter
+ *   window -- The most requests outstanding at once, TIZEN_MCAST_WINDOW
+ *             if not positive
+ *   result -- The outcome on every selected device
+ *
+ * Returns:
+ *   TIZEN_SUCCESS if the action was sent (result tells how each device
+ *   answered), TIZEN_ERROR if it was not sent at all, for instance
+ *   because the SCPD of the service is not loaded yet.
+ *
+ ********************************************************************************/
+int TizenCtrlPointMulticastAction(
+	int service,
+	const char *actionname,
+	const char **param_name,
+	char **param_val,
+	int param_count,
+	const TizenDeviceHandle *handles,
+	int count,
+	TizenDeviceFilter filter,
+	void *filterarg,
+	int window,
+	struct tizen_mcast_result *result)
+{
+	const struct tizen_schema *schema;
+	const struct tizen_soap_template *tmpl = NULL;
+	const char *values[TIZEN_ACTION_MAXARGS];
+	struct TizenDeviceNode *devnode;
+	struct tizen_mcast_status *status;
+	struct tizen_mcast_req *reqs = NULL;
+	struct tizen_mcast mcast;
+	TizenDeviceHandle *all = NULL;
+	unsigned int start;
+	char *body = NULL;
+	size_t length = 0;
+	int rc = TIZEN_ERROR;
+	int action, i, sent;
+	int rcu;
+
+	memset(result, 0, sizeof(*result));
+	if (window <= 0)
+		window = TIZEN_MCAST_WINDOW;
+	schema = TizenSchema_Find(TizenServiceType[service]);
+	if (!schema || TizenCtrlPointCheckAction(schema, service, actionname,
+	    param_name, param_val, param_count, values, &action) !=
+	    TIZEN_SUCCESS)
+		return TIZEN_ERROR;
+	tmpl = TizenSoap_Find(schema, action);
+	if (!tmpl)
+		return TIZEN_ERROR;
+	if (!handles) {
+		count = TizenCtrlPointGetHandles(&all);
+		if (count < 0)
+			return TIZEN_ERROR;
+		handles = all;
+	}
+
+	/* One request for every device */
+	length = TizenSoap_Fill(tmpl, values, NULL, 0);
+	body = (char *)malloc(length + 1);
+	if (count > 0) {
+		result->Status = (struct tizen_mcast_status *)calloc(count,
+			sizeof(*result->Status));
+		reqs = (struct tizen_mcast_req *)calloc(count, sizeof(*reqs));
+	}
+	if (!body || (count > 0 && (!result->Status || !reqs))) {
+		free(result->Status);
+		result->Status = NULL;
+		goto __finish_mcast;
+	}
+	TizenSoap_Fill(tmpl, values, body, length + 1);
+
+	ithread_mutex_init(&mcast.Mutex, 0);
+	ithread_cond_init(&mcast.Cond, NULL);
+	mcast.Outstanding = 0;
+	start = TizenTimer_NowMs();
+	for (i = 0; i < count; i++) {
+		ithread_mutex_lock(&mcast.Mutex);
+		while (mcast.Outstanding >= window)
+			ithread_cond_wait(&mcast.Cond, &mcast.Mutex);
+		mcast.Outstanding++;
+		ithread_mutex_unlock(&mcast.Mutex);
+
+		sent = 0;
+		status = &result->Status[result->Count];
+		rcu = TizenRcu_ReadLock();
+		if (TizenCtrlPointGetDeviceByHandle(handles[i], &devnode) ==
+		    TIZEN_SUCCESS && (!filter || filter(devnode, filterarg))) {
+			status->Handle = handles[i];
+			status->ErrCode = TIZEN_SOAP_TRANSPORT_ERROR;
+			reqs[i].Mcast = &mcast;
+			reqs[i].Status = status;
+			reqs[i].Sent = TizenTimer_NowMs();
+			result->Count++;
+			sent = TizenSoap_SendBody(devnode->device.
+				TizenService[service].ControlURL, tmpl, body,
+				length, TizenCtrlPointMulticastComplete,
+				&reqs[i]) == 0;
+		}
+		TizenRcu_ReadUnlock(rcu);
+		if (!sent) {
+			ithread_mutex_lock(&mcast.Mutex);
+			mcast.Outstanding--;
+			ithread_mutex_unlock(&mcast.Mutex);
+		}
+	}
+	ithread_mutex_lock(&mcast.Mutex);
+	while (mcast.Outstanding > 0)
+		ithread_cond_wait(&mcast.Cond, &mcast.Mutex);
+	ithread_mutex_unlock(&mcast.Mutex);
+	ithread_cond_destroy(&mcast.Cond);
+	ithread_mutex_destroy(&mcast.Mutex);
+
+	result->Elapsed = TizenTimer_NowMs() - start;
+	for (i = 0; i < result->Count; i++) {
+		if (0 == result->Status[i].ErrCode)
+			result->Succeeded++;
+		if (result->Status[i].Latency > result->MaxLatency)
+			result->MaxLatency = result->Status[i].Latency;
+	}
+	rc = TIZEN_SUCCESS;
+
+__finish_mcast :
+	free(reqs);
+	free(body);
+	free(all);
 
 	return rc;
 }
 
+/********************************************************************************
+ * TizenCtrlPointCoalesceStats
+ *
+ * Description: 
+ *       Finds (or adds) the coalescing counters of an action. Called with
+ *       CoalesceMutex held.
+ *
+ ********************************************************************************/
+static struct tizen_coalesce_stats *TizenCtrlPointCoalesceStats(
+	const char *actionName)
+{
+	struct tizen_coalesce_stats *stats;
+
+	for (stats = CoalesceStats; stats; stats = stats->Next)
+		if (strcmp(stats->Action, actionName) == 0)
+			return stats;
+	stats = (struct tizen_coalesce_stats *)calloc(1, sizeof(*stats) +
+		strlen(actionName) + 1);
+	if (!stats)
+		return NULL;
+	strcpy(stats->Action, actionName);
+	stats->Next = CoalesceStats;
+	CoalesceStats = stats;
+
+	return stats;
+}
+
+/* Sending and completing a coalesced action call each other */
+static void TizenCtrlPointCoalesceComplete(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie);
+
+/********************************************************************************
+ * TizenCtrlPointCoalesceSend
+ *
+ * Description: 
+ *       Sends the pending value of a coalescing entry, and keeps doing so
+ *       while requests complete synchronously (no template yet) or fail.
+ *       Removes the entry once nothing is pending any more.
+ *
+ * Returns:
+ *   The result of the last request.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointCoalesceSend(struct tizen_coalesce *entry)
+{
+	struct tizen_coalesce **link;
+	char param_val_a[50];
+	char *param_val = param_val_a;
+	const char *param_name = entry->ParamName;
+	int rc = TIZEN_SUCCESS;
+	int tracked;
+
+	for (;;) {
+		ithread_mutex_lock(&CoalesceMutex);
+		if (!entry->HasPending) {
+			for (link = &CoalesceInFlight; *link != entry;
+			     link = &(*link)->Next)
+				;
+			*link = entry->Next;
+			ithread_mutex_unlock(&CoalesceMutex);
+			free(entry);
+			return rc;
+		}
+		sprintf(param_val_a, "%d", entry->Pending);
+		entry->HasPending = 0;
+		if (entry->Stats)
+			entry->Stats->Sent++;
+		ithread_mutex_unlock(&CoalesceMutex);
+
+		rc = TizenCtrlPointSendActionTracked(entry->Service,
+			entry->Handle, entry->Action, &param_name, &param_val,
+			1, TizenCtrlPointCoalesceComplete, entry, &tracked);
+		if (tracked)
+			return rc;
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointCoalesceComplete
+ *
+ * Description: 
+ *       Completion callback of a coalesced action: sends the latest value
+ *       given meanwhile, if any.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointCoalesceComplete(int errcode, const char *url,
+	const struct tizen_soap_template *tmpl, char *response, void *cookie)
+{
+	TizenCtrlPointActionComplete(errcode, url, tmpl, response, NULL);
+	TizenCtrlPointCoalesceSend((struct tizen_coalesce *)cookie);
+}
+
 /********************************************************************************
  * TizenCtrlPointSendActionNumericArg
  *
  * Description:Send an action with one argument to a device in the global device list.
+ *       While the same action is on the wire for the device, the value
+ *       waits, and a newer value replaces it: only the latest one is sent
+ *       when the request completes.
  *
  * Parameters:
  *   devnum -- The number of the device (order in the list, starting with 1)
@@ -418,13 +2174,63 @@ int TizenCtrlPointSendAction(
 int TizenCtrlPointSendActionNumericArg(int devnum, int service,
 	const char *actionName, const char *paramName, int paramValue)
 {
+	const struct tizen_schema *schema;
+	const char *values[TIZEN_ACTION_MAXARGS];
+	struct tizen_coalesce_stats *stats;
+	struct tizen_coalesce *entry;
+	TizenDeviceHandle handle;
 	char param_val_a[50];
 	char *param_val = param_val_a;
+	int action;
 
+	if (TizenCtrlPointGetHandle(devnum, &handle) != TIZEN_SUCCESS)
+		return TIZEN_ERROR;
+	/* A bad value must fail now, not replace a good pending one */
+	schema = TizenSchema_Find(TizenServiceType[service]);
 	sprintf(param_val_a, "%d", paramValue);
-	return TizenCtrlPointSendAction(
-		service, devnum, actionName, &paramName,
-		&param_val, 1);
+	if (schema && TizenCtrlPointCheckAction(schema, service, actionName,
+			&paramName, &param_val, 1, values, &action) !=
+	    TIZEN_SUCCESS)
+		return TIZEN_ERROR;
+
+	ithread_mutex_lock(&CoalesceMutex);
+	stats = TizenCtrlPointCoalesceStats(actionName);
+	if (stats)
+		stats->Requested++;
+	for (entry = CoalesceInFlight; entry; entry = entry->Next)
+		if (entry->Handle == handle && entry->Service == service &&
+		    strcmp(entry->Action, actionName) == 0)
+			break;
+	if (entry) {
+		/* Sent once the request on the wire completes, unless an
+		 * even newer value comes first */
+		if (entry->HasPending && entry->Stats)
+			entry->Stats->Replaced++;
+		entry->Pending = paramValue;
+		entry->HasPending = 1;
+		ithread_mutex_unlock(&CoalesceMutex);
+		return TIZEN_SUCCESS;
+	}
+	entry = (struct tizen_coalesce *)calloc(1, sizeof(*entry) +
+		strlen(actionName) + strlen(paramName) + 2);
+	if (!entry) {
+		ithread_mutex_unlock(&CoalesceMutex);
+		return TIZEN_ERROR;
+	}
+	entry->Handle = handle;
+	entry->Service = service;
+	entry->Stats = stats;
+	entry->Action = (char *)(entry + 1);
+	strcpy(entry->Action, actionName);
+	entry->ParamName = entry->Action + strlen(actionName) + 1;
+	strcpy(entry->ParamName, paramName);
+	entry->Pending = paramValue;
+	entry->HasPending = 1;
+	entry->Next = CoalesceInFlight;
+	CoalesceInFlight = entry;
+	ithread_mutex_unlock(&CoalesceMutex);
+
+	return TizenCtrlPointCoalesceSend(entry);
 }
 
 int TizenCtrlPointSendActionTextArg(int devnum, int service,
@@ -503,7 +2309,9 @@ int TizenCtrlPointSendText(int devnum, char *text)
  *       Given a list number, returns the pointer to the device
  *       node at that position in the global device list.  Note
  *       that this function is not thread safe.  It must be called 
- *       from a function that has locked the global device list.
+ *       from a function that has locked the global device list or
+ *       entered an RCU read section; the node is only valid until
+ *       the lock or read section is released.
  *
  * Parameters:
  *   devnum -- The number of the device (order in the list,
@@ -513,14 +2321,9 @@ int TizenCtrlPointSendText(int devnum, char *text)
  ********************************************************************************/
 int TizenCtrlPointGetDevice(int devnum, struct TizenDeviceNode **devnode)
 {
-	int count = devnum;
-	struct TizenDeviceNode *tmpdevnode = NULL;
+	struct TizenDeviceNode *tmpdevnode;
 
-	if (count)
-		tmpdevnode = GlobalDeviceList;
-	while (--count && tmpdevnode) {
-		tmpdevnode = tmpdevnode->next;
-	}
+	tmpdevnode = TizenRegistry_Nth(devnum);
 	if (!tmpdevnode) {
 		SampleUtil_Print("Error finding TizenDevice number -- %d\n",
 				 devnum);
@@ -532,30 +2335,202 @@ int TizenCtrlPointGetDevice(int devnum, struct TizenDeviceNode **devnode)
 }
 
 /********************************************************************************
- * TizenCtrlPointPrintList
+ * TizenCtrlPointGetDeviceByHandle
+ *
+ * Description: 
+ *       Given a device handle, returns the pointer to the device node, or
+ *       an error if the device has gone away since the handle was taken.
+ *       Same locking rules as TizenCtrlPointGetDevice.
+ *
+ * Parameters:
+ *   handle -- The handle of the device
+ *   devnode -- The output device node pointer
+ *
+ ********************************************************************************/
+int TizenCtrlPointGetDeviceByHandle(TizenDeviceHandle handle,
+	struct TizenDeviceNode **devnode)
+{
+	struct TizenDeviceNode *tmpdevnode;
+
+	tmpdevnode = TizenRegistry_FindByHandle(handle);
+	if (!tmpdevnode) {
+		SampleUtil_Print("Error finding TizenDevice handle -- %llx\n",
+				 handle);
+		return TIZEN_ERROR;
+	}
+	*devnode = tmpdevnode;
+
+	return TIZEN_SUCCESS;
+}
+
+/********************************************************************************
+ * TizenCtrlPointGetHandle
+ *
+ * Description: 
+ *       Given a list number, returns the stable handle of the device at
+ *       that position. Unlike the list number, the handle keeps naming the
+ *       same device when others are removed.
+ *
+ * Parameters:
+ *   devnum -- The number of the device (order in the list,
+ *             starting with 1)
+ *   handle -- The output device handle
+ *
+ ********************************************************************************/
+int TizenCtrlPointGetHandle(int devnum, TizenDeviceHandle *handle)
+{
+	struct TizenDeviceNode *devnode;
+	int rc;
+	int rcu;
+
+	rcu = TizenRcu_ReadLock();
+	rc = TizenCtrlPointGetDevice(devnum, &devnode);
+	if (TIZEN_SUCCESS == rc)
+		*handle = devnode->Handle;
+	TizenRcu_ReadUnlock(rcu);
+
+	return rc;
+}
+
+/********************************************************************************
+ * TizenCtrlPointGetHandles
+ *
+ * Description: 
+ *       Takes a snapshot of the handles of every device, in list order.
+ *       The caller frees the array.
+ *
+ * Parameters:
+ *   handles -- The output array, NULL if there is no device
+ *
+ * Returns:
+ *   The number of handles, or -1 if memory could not be allocated.
+ *
+ ********************************************************************************/
+int TizenCtrlPointGetHandles(TizenDeviceHandle **handles)
+{
+	struct tizen_order *order;
+	struct TizenDeviceNode *devnode;
+	int count = 0;
+	int i;
+	int rcu;
+
+	*handles = NULL;
+	rcu = TizenRcu_ReadLock();
+	order = TizenRegistry_Order();
+	if (order && order->len > order->holes) {
+		*handles = (TizenDeviceHandle *)malloc(
+			(order->len - order->holes) * sizeof(TizenDeviceHandle));
+		if (!*handles) {
+			TizenRcu_ReadUnlock(rcu);
+			return -1;
+		}
+		TIZEN_REGISTRY_FOREACH(order, i, devnode)
+			(*handles)[count++] = devnode->Handle;
+	}
+	TizenRcu_ReadUnlock(rcu);
+
+	return count;
+}
+
+/********************************************************************************
+ * TizenCtrlPointPrintList
+ *
+ * Description: 
+ *       Print the universal device names for each device in the global device list
+ *
+ * Parameters:
+ *   None
+ *
+ ********************************************************************************/
+int TizenCtrlPointPrintList()
+{
+	struct TizenDeviceNode *tmpdevnode;
+	struct tizen_order *order;
+	int i = 0, pos;
+	int rcu;
+
+	rcu = TizenRcu_ReadLock();
+
+	SampleUtil_Print("TizenCtrlPointPrintList:\n");
+	order = TizenRegistry_Order();
+	TIZEN_REGISTRY_FOREACH(order, pos, tmpdevnode) {
+		SampleUtil_Print(" %3d -- %s\n", ++i, tmpdevnode->device.UDN);
+	}
+	SampleUtil_Print("\n");
+	TizenRcu_ReadUnlock(rcu);
+
+	return TIZEN_SUCCESS;
+}
+
+/********************************************************************************
+ * TizenCtrlPointPrintPoolStats
  *
  * Description: 
- *       Print the universal device names for each device in the global device list
+ *       Print the usage of the device node pool, of the description
+ *       fetch queue and of the description cache, to help sizing them.
  *
  * Parameters:
  *   None
  *
  ********************************************************************************/
-int TizenCtrlPointPrintList()
+int TizenCtrlPointPrintPoolStats(void)
 {
-	struct TizenDeviceNode *tmpdevnode;
-	int i = 0;
-
-	ithread_mutex_lock(&DeviceListMutex);
-
-	SampleUtil_Print("TizenCtrlPointPrintList:\n");
-	tmpdevnode = GlobalDeviceList;
-	while (tmpdevnode) {
-		SampleUtil_Print(" %3d -- %s\n", ++i, tmpdevnode->device.UDN);
-		tmpdevnode = tmpdevnode->next;
-	}
-	SampleUtil_Print("\n");
-	ithread_mutex_unlock(&DeviceListMutex);
+	struct tizen_pool_stats stats;
+	struct tizen_fetch_stats fetch;
+	struct tizen_soap_stats soap;
+	struct tizen_http_pool_stats http;
+	struct tizen_coalesce_stats *coalesce;
+	struct tizen_subscription *subscription;
+	struct tizen_desc_stats desc;
+	int pending;
+
+	TizenPool_GetStats(&TizenNodePool, &stats);
+	SampleUtil_Print("TizenCtrlPointPrintPoolStats:\n");
+	SampleUtil_Print("  Node size  : %u bytes\n", (unsigned int)stats.objsize);
+	SampleUtil_Print("  Live       : %u\n", stats.live);
+	SampleUtil_Print("  Free       : %u\n", stats.free);
+	SampleUtil_Print("  High-water : %u\n", stats.highwater);
+	SampleUtil_Print("  Slabs      : %u (%u nodes each)\n", stats.slabs,
+			 TIZEN_NODE_POOL_SLAB);
+	TizenFetch_GetStats(&fetch);
+	SampleUtil_Print("  Fetches    : %u queued, %u merged, %u dropped, %u done\n",
+			 fetch.queued, fetch.merged, fetch.dropped, fetch.fetched);
+	SampleUtil_Print("  Fetch queue: %u pending, high-water %u (max %u)\n",
+			 fetch.pending, fetch.highwater, TIZEN_FETCH_QUEUE);
+	TizenDesc_GetStats(&desc);
+	SampleUtil_Print("  Desc cache : %u entries, %u hits, %u stores, %u evicted\n",
+			 desc.entries, desc.hits, desc.stores, desc.evictions);
+	SampleUtil_Print("  GetVar     : %u local, %u queries, %u joined\n",
+			 __atomic_load_n(&GetVarLocal, __ATOMIC_RELAXED),
+			 __atomic_load_n(&GetVarQueries, __ATOMIC_RELAXED),
+			 __atomic_load_n(&GetVarJoined, __ATOMIC_RELAXED));
+	TizenSoap_GetStats(&soap);
+	SampleUtil_Print("  SOAP       : %u sent (%u oversized), %u ok, %u faults, %u failed (%u rejected), %u pending\n",
+			 soap.sent, soap.oversized, soap.succeeded, soap.faults,
+			 soap.failed, soap.rejected, soap.pending);
+	ithread_mutex_lock(&CoalesceMutex);
+	for (coalesce = CoalesceStats; coalesce; coalesce = coalesce->Next)
+		SampleUtil_Print("  Coalesced  : %s %u requested, %u sent, %u replaced\n",
+				 coalesce->Action, coalesce->Requested,
+				 coalesce->Sent, coalesce->Replaced);
+	ithread_mutex_unlock(&CoalesceMutex);
+	ithread_mutex_lock(&SubscriptionMutex);
+	pending = 0;
+	for (subscription = Subscriptions; subscription;
+	     subscription = subscription->Next)
+		pending++;
+	SampleUtil_Print("  Subscribe  : %u asked, %u accepted, %u retried, %d pending\n",
+			 SubscribeAsked, SubscribeAccepted, SubscribeRetried,
+			 pending);
+	ithread_mutex_unlock(&SubscriptionMutex);
+	SampleUtil_Print("  Actions    : %u submitted, %u ok, %u failed\n",
+			 __atomic_load_n(&ActionSubmitted, __ATOMIC_RELAXED),
+			 __atomic_load_n(&ActionSucceeded, __ATOMIC_RELAXED),
+			 __atomic_load_n(&ActionFailed, __ATOMIC_RELAXED));
+	TizenHttp_GetPoolStats(&http);
+	SampleUtil_Print("  Keep-alive : %u requests, %u reused, %u opened, %u stale, %u expired, %u evicted, %u idle\n",
+			 http.requests, http.reused, http.opened, http.stale,
+			 http.expired, http.evicted, http.idle);
 
 	return TIZEN_SUCCESS;
 }
@@ -574,9 +2549,13 @@ int TizenCtrlPointPrintList()
  ********************************************************************************/
 int TizenCtrlPointPrintDevice(int devnum)
 {
+	struct tizen_breaker_state breaker;
+	const struct tizen_schema *schema;
 	struct TizenDeviceNode *tmpdevnode;
-	int i = 0, service, var;
+	int service, var;
 	char spacer[15];
+	char probe[32];
+	int rcu;
 
 	if (devnum <= 0) {
 		SampleUtil_Print(
@@ -586,22 +2565,17 @@ int TizenCtrlPointPrintDevice(int devnum)
 		return TIZEN_ERROR;
 	}
 
-	ithread_mutex_lock(&DeviceListMutex);
+	rcu = TizenRcu_ReadLock();
 
 	SampleUtil_Print("TizenCtrlPointPrintDevice:\n");
-	tmpdevnode = GlobalDeviceList;
-	while (tmpdevnode) {
-		i++;
-		if (i == devnum)
-			break;
-		tmpdevnode = tmpdevnode->next;
-	}
+	tmpdevnode = TizenRegistry_Nth(devnum);
 	if (!tmpdevnode) {
 		SampleUtil_Print(
 			"Error in TizenCtrlPointPrintDevice: "
 			"invalid devnum = %d  --  actual device count = %d\n",
-			devnum, i);
+			devnum, TizenRegistry_Count());
 	} else {
+		ithread_mutex_lock(&tmpdevnode->StateMutex);
 		SampleUtil_Print(
 			"  TizenDevice -- %d\n"
 			"    |                  \n"
@@ -615,7 +2589,24 @@ int TizenCtrlPointPrintDevice(int devnum)
 			tmpdevnode->device.DescDocURL,
 			tmpdevnode->device.FriendlyName,
 			tmpdevnode->device.PresURL,
-			tmpdevnode->device.AdvrTimeOut);
+			(int)(tmpdevnode->device.AdvrDeadline - TizenTimer_Now()));
+		/* Every service of the device shares the breaker of its host */
+		if (TizenBreaker_GetState(tmpdevnode->device.TizenService[0].
+					  ControlURL, &breaker) == 0) {
+			probe[0] = '\0';
+			if (breaker.retry)
+				sprintf(probe, ", probe in %d s", breaker.retry);
+			SampleUtil_Print(
+				"    +- Circuit        = %s%s\n"
+				"    +- Requests       = %u, %u failed (%u in a row), %u rejected\n"
+				"    +- Round trip     = p50 %u ms, p95 %u ms, timeout %d s\n",
+				TizenBreaker_CircuitName(breaker.circuit),
+				probe, breaker.requests, breaker.failures,
+				breaker.consecutive, breaker.rejected,
+				breaker.p50, breaker.p95,
+				breaker.timeout ? breaker.timeout :
+				TIZEN_SOAP_TIMEOUT);
+		}
 		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
 			if (service < TIZEN_SERVICE_SERVCOUNT - 1)
 				sprintf(spacer, "    |    ");
@@ -642,315 +2633,1121 @@ int TizenCtrlPointPrintDevice(int devnum)
 				spacer,
 				tmpdevnode->device.TizenService[service].SID,
 				spacer);
-			for (var = 0; var < TizenVarCount[service]; var++) {
+			schema = TizenSchema_Find(
+				tmpdevnode->device.TizenService[service].ServiceType);
+			for (var = 0; var < TizenCtrlPointVarCount(schema); var++) {
 				SampleUtil_Print(
 					"%s     +- %-10s = %s\n",
 					spacer,
-					TizenVarName[service][var],
-					tmpdevnode->device.TizenService[service].VariableStrVal[var]);
+					schema->Vars[var].Name,
+					TizenValue_Text(&tmpdevnode->device.TizenService[service].State[var]));
 			}
 		}
+		ithread_mutex_unlock(&tmpdevnode->StateMutex);
+	}
+	SampleUtil_Print("\n");
+	TizenRcu_ReadUnlock(rcu);
+
+	return TIZEN_SUCCESS;
+}
+
+/********************************************************************************
+ * TizenCtrlPointSubscribeBegin / TizenCtrlPointSubscribeEnd
+ *
+ * Description: 
+ *       Bracket a subscription from the UpnpSubscribe(Async) call until its SID
+ *       has been indexed (or dropped).
+ *
+ ********************************************************************************/
+static void TizenCtrlPointSubscribeBegin(void)
+{
+	ithread_mutex_lock(&SubscribeMutex);
+	SubscribeInFlight++;
+	ithread_mutex_unlock(&SubscribeMutex);
+}
+
+static void TizenCtrlPointSubscribeEnd(void)
+{
+	ithread_mutex_lock(&SubscribeMutex);
+	SubscribeInFlight--;
+	ithread_mutex_unlock(&SubscribeMutex);
+}
+
+/* Defined with TizenCtrlPointHandleEvent */
+static int TizenCtrlPointDeliverEvent(const char *sid, int evntkey,
+	IXML_Document *changes);
+
+/********************************************************************************
+ * TizenCtrlPointFreeEvents
+ *
+ * Description: 
+ *       Free a list of parked events that will not be delivered.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointFreeEvents(struct tizen_parked_event *events)
+{
+	struct tizen_parked_event *event;
+
+	while (events) {
+		event = events;
+		events = event->Next;
+		SampleUtil_Print("Dropping event %d for unknown SID %s\n",
+				 event->EventKey, event->SID);
+		ixmlDocument_free(event->Changes);
+		free(event);
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointParkEvent
+ *
+ * Description: 
+ *       Keep an event whose SID is unknown, if some subscription is in
+ *       flight, for TizenCtrlPointReplayEvents to deliver once the SID is
+ *       indexed; drop it otherwise. Never blocks the libupnp thread that
+ *       delivered it.
+ *
+ * Parameters:
+ *   sid -- The subscription id for the event
+ *   evntkey -- The eventkey number for the event
+ *   changes -- The DOM document representing the changes, copied
+ *
+ ********************************************************************************/
+static void TizenCtrlPointParkEvent(const char *sid, int evntkey,
+	IXML_Document *changes)
+{
+	struct tizen_parked_event *event, *next, **link;
+	struct tizen_parked_event *dropped = NULL;
+	unsigned int now = TizenTimer_Now();
+	int pending;
+	int service;
+	int found;
+	int rcu;
+
+	ithread_mutex_lock(&SubscribeMutex);
+	pending = SubscribeInFlight;
+	ithread_mutex_unlock(&SubscribeMutex);
+	if (!pending)
+		return;
+
+	event = (struct tizen_parked_event *)calloc(1, sizeof(*event));
+	if (!event)
+		return;
+	strncpy(event->SID, sid, sizeof(event->SID) - 1);
+	event->EventKey = evntkey;
+	event->Parked = now;
+	event->Changes = (IXML_Document *)ixmlNode_cloneNode(
+		(IXML_Node *)changes, 1);
+	if (!event->Changes) {
+		free(event);
+		return;
+	}
+
+	ithread_mutex_lock(&ParkMutex);
+	/* Expired ones first, then the oldest if still full */
+	while (ParkedEvents && ((int)(now - ParkedEvents->Parked) >=
+	       TIZEN_EVENT_SID_WAIT || ParkedCount >= TIZEN_EVENT_PARK_MAX)) {
+		next = ParkedEvents->Next;
+		ParkedEvents->Next = dropped;
+		dropped = ParkedEvents;
+		ParkedEvents = next;
+		ParkedCount--;
+	}
+	/* The SID may have been indexed, and its events replayed, since the
+	 * lookup of our caller */
+	rcu = TizenRcu_ReadLock();
+	found = TizenRegistry_FindBySID(sid, &service) != NULL;
+	TizenRcu_ReadUnlock(rcu);
+	if (!found) {
+		for (link = &ParkedEvents; *link; link = &(*link)->Next)
+			;
+		*link = event;
+		ParkedCount++;
+	}
+	ithread_mutex_unlock(&ParkMutex);
+
+	TizenCtrlPointFreeEvents(dropped);
+	if (found) {
+		TizenCtrlPointDeliverEvent(sid, evntkey, event->Changes);
+		ixmlDocument_free(event->Changes);
+		free(event);
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointReplayEvents
+ *
+ * Description: 
+ *       Deliver, in the order they came, the events parked for a SID that
+ *       has just been indexed.
+ *
+ * Parameters:
+ *   sid -- The subscription id
+ *
+ ********************************************************************************/
+static void TizenCtrlPointReplayEvents(const char *sid)
+{
+	struct tizen_parked_event *events = NULL, **tail = &events;
+	struct tizen_parked_event *event, **link;
+
+	ithread_mutex_lock(&ParkMutex);
+	for (link = &ParkedEvents; *link; ) {
+		event = *link;
+		if (strcmp(event->SID, sid) != 0) {
+			link = &event->Next;
+			continue;
+		}
+		*link = event->Next;
+		ParkedCount--;
+		event->Next = NULL;
+		*tail = event;
+		tail = &event->Next;
+	}
+	ithread_mutex_unlock(&ParkMutex);
+
+	while (events) {
+		event = events;
+		events = event->Next;
+		TizenCtrlPointDeliverEvent(event->SID, event->EventKey,
+					   event->Changes);
+		ixmlDocument_free(event->Changes);
+		free(event);
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointSubscribeTimeout
+ *
+ * Description: 
+ *       Returns the subscription timeout to ask for: default_timeout, less
+ *       up to TIZEN_SUBSCRIBE_JITTER percent at random. libupnp renews
+ *       with the timeout granted, so the spread lasts.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointSubscribeTimeout(void)
+{
+	int spread = default_timeout * TIZEN_SUBSCRIBE_JITTER / 100;
+
+	if (spread <= 0)
+		return default_timeout;
+
+	return default_timeout - rand() % (spread + 1);
+}
+
+/********************************************************************************
+ * TizenCtrlPointDropSubscription
+ *
+ * Description: 
+ *       Removes a subscription that succeeded or whose device is gone.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointDropSubscription(struct tizen_subscription *sub)
+{
+	struct tizen_subscription **link;
+
+	ithread_mutex_lock(&SubscriptionMutex);
+	for (link = &Subscriptions; *link != sub; link = &(*link)->Next)
+		;
+	*link = sub->Next;
+	ithread_mutex_unlock(&SubscriptionMutex);
+	free(sub);
+}
+
+/********************************************************************************
+ * TizenCtrlPointSubscriptionGone
+ *
+ * Description: 
+ *       Tells whether the device of a subscription is no longer registered.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointSubscriptionGone(const struct tizen_subscription *sub)
+{
+	int gone;
+	int rcu;
+
+	rcu = TizenRcu_ReadLock();
+	gone = !TizenRegistry_FindByHandle(sub->Handle);
+	TizenRcu_ReadUnlock(rcu);
+
+	return gone;
+}
+
+/* Sending a subscription and completing it call each other */
+static void TizenCtrlPointSendSubscription(struct tizen_subscription *sub);
+
+/********************************************************************************
+ * TizenCtrlPointArmRetry
+ *
+ * Description: 
+ *       Arms the next attempt of a failed subscription, after its backoff
+ *       and up to half as much again at random. Must be called with
+ *       SubscriptionMutex held.
+ *
+ * Returns:
+ *   The delay, in seconds.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointArmRetry(struct tizen_subscription *sub)
+{
+	int delay;
+
+	delay = sub->Backoff + rand() % (sub->Backoff / 2 + 1);
+	sub->Backoff *= 2;
+	if (sub->Backoff > TIZEN_SUBSCRIBE_MAX_RETRY)
+		sub->Backoff = TIZEN_SUBSCRIBE_MAX_RETRY;
+	TizenWheel_Arm(&SubscribeWheel, &sub->Timer,
+		       TizenTimer_Now() + (unsigned int)delay);
+	SubscribeRetried++;
+
+	return delay;
+}
+
+/********************************************************************************
+ * TizenCtrlPointRevalidated
+ *
+ * Description: 
+ *       Called when a subscription of a restored device is answered. Once
+ *       every one has been, removes the device if all were refused, and
+ *       otherwise retries the refused ones as usual.
+ *
+ * Parameters:
+ *   sub -- The subscription, freed here if accepted
+ *   accepted -- Whether the device accepted it
+ *
+ ********************************************************************************/
+static void TizenCtrlPointRevalidated(struct tizen_subscription *sub,
+	int accepted)
+{
+	TizenDeviceHandle handle = sub->Handle;
+	struct TizenDeviceNode *devnode;
+	struct tizen_subscription **link;
+	struct tizen_subscription *other;
+	int service, pending = 0;
+
+	ithread_mutex_lock(&SubscriptionMutex);
+	if (accepted) {
+		for (link = &Subscriptions; *link != sub; link = &(*link)->Next)
+			;
+		*link = sub->Next;
+	} else {
+		sub->Revalidate = TIZEN_REVALIDATE_REFUSED;
+	}
+	for (other = Subscriptions; other; other = other->Next)
+		if (other->Handle == handle &&
+		    other->Revalidate == TIZEN_REVALIDATE_PENDING)
+			pending = 1;
+	ithread_mutex_unlock(&SubscriptionMutex);
+	if (accepted)
+		free(sub);
+	/* The last answer decides */
+	if (pending)
+		return;
+
+	ithread_mutex_lock(&DeviceListMutex);
+	devnode = TizenRegistry_FindByHandle(handle);
+	for (service = 0; devnode && service < TIZEN_SERVICE_SERVCOUNT;
+	     service++)
+		if (devnode->device.TizenService[service].SID[0])
+			break;
+	if (devnode && service == TIZEN_SERVICE_SERVCOUNT) {
+		SampleUtil_Print("Cached device %s is gone\n",
+				 devnode->device.UDN);
+		TizenWheel_Cancel(&devnode->AdvrTimer);
+		TizenRegistry_Remove(devnode);
+		TizenCtrlPointDeleteNode(devnode);
+	}
+	ithread_mutex_unlock(&DeviceListMutex);
+
+	/* Those of a removed device are dropped when they come due */
+	ithread_mutex_lock(&SubscriptionMutex);
+	for (other = Subscriptions; other; other = other->Next)
+		if (other->Handle == handle &&
+		    other->Revalidate == TIZEN_REVALIDATE_REFUSED) {
+			other->Revalidate = 0;
+			TizenCtrlPointArmRetry(other);
+		}
+	ithread_mutex_unlock(&SubscriptionMutex);
+}
+
+/********************************************************************************
+ * TizenCtrlPointRetrySubscription
+ *
+ * Description: 
+ *       Schedules the next attempt of a failed subscription, or drops the
+ *       subscription if its device is gone.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointRetrySubscription(struct tizen_subscription *sub)
+{
+	int delay;
+
+	if (TizenCtrlPointSubscriptionGone(sub)) {
+		/* Its siblings may be waiting for its answer */
+		if (sub->Revalidate == TIZEN_REVALIDATE_PENDING)
+			TizenCtrlPointRevalidated(sub, 0);
+		else
+			TizenCtrlPointDropSubscription(sub);
+		return;
+	}
+	ithread_mutex_lock(&SubscriptionMutex);
+	delay = TizenCtrlPointArmRetry(sub);
+	ithread_mutex_unlock(&SubscriptionMutex);
+	SampleUtil_Print("Retrying subscription to %s in %d s\n",
+			 sub->EventURL, delay);
+}
+
+/********************************************************************************
+ * TizenCtrlPointSubscriptionComplete
+ *
+ * Description: 
+ *       Completion callback of UpnpSubscribeAsync: indexes the SID, or
+ *       schedules a retry. A restored device is revalidated instead.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointSubscriptionComplete(Upnp_EventType EventType,
+	void *Event, void *Cookie)
+{
+	struct tizen_subscription *sub = (struct tizen_subscription *)Cookie;
+	struct Upnp_Event_Subscribe *es_event =
+		(struct Upnp_Event_Subscribe *)Event;
+	struct TizenDeviceNode *devnode;
+
+	if (EventType != UPNP_EVENT_SUBSCRIBE_COMPLETE)
+		return 0;
+	/* A refusal is an answer */
+	TizenBreaker_Report(sub->EventURL,
+			    es_event->ErrCode == UPNP_E_SUCCESS ||
+			    es_event->ErrCode == UPNP_E_SUBSCRIBE_UNACCEPTED,
+			    TizenTimer_NowMs() - sub->Start);
+	if (es_event->ErrCode != UPNP_E_SUCCESS) {
+		SampleUtil_Print("Error Subscribing to EventURL -- %d\n",
+				 es_event->ErrCode);
+		TizenCtrlPointSubscribeEnd();
+		if (sub->Revalidate)
+			TizenCtrlPointRevalidated(sub, 0);
+		else
+			TizenCtrlPointRetrySubscription(sub);
+		return 0;
+	}
+
+	SampleUtil_Print("Subscribed to EventURL with SID=%s\n",
+			 es_event->Sid);
+	ithread_mutex_lock(&DeviceListMutex);
+	devnode = TizenRegistry_FindByHandle(sub->Handle);
+	if (devnode)
+		TizenRegistry_SetSID(devnode, sub->Service, es_event->Sid);
+	ithread_mutex_unlock(&DeviceListMutex);
+	if (devnode) {
+		TizenCtrlPointReplayEvents(es_event->Sid);
+	} else {
+		/* Removed while we were subscribing */
+		UpnpUnSubscribeAsync(ctrlpt_handle, es_event->Sid,
+			TizenCtrlPointCallbackEventHandler, NULL);
+	}
+	TizenCtrlPointSubscribeEnd();
+	ithread_mutex_lock(&SubscriptionMutex);
+	SubscribeAccepted++;
+	ithread_mutex_unlock(&SubscriptionMutex);
+	if (sub->Revalidate)
+		TizenCtrlPointRevalidated(sub, 1);
+	else
+		TizenCtrlPointDropSubscription(sub);
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenCtrlPointSendSubscription
+ *
+ * Description: 
+ *       Sends one attempt of a subscription, unless the device is known
+ *       not to answer, in which case the attempt is retried later.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointSendSubscription(struct tizen_subscription *sub)
+{
+	int ret;
+
+	if (TizenCtrlPointSubscriptionGone(sub)) {
+		/* Its siblings may be waiting for its answer */
+		if (sub->Revalidate == TIZEN_REVALIDATE_PENDING)
+			TizenCtrlPointRevalidated(sub, 0);
+		else
+			TizenCtrlPointDropSubscription(sub);
+		return;
+	}
+	if (!TizenBreaker_Allow(sub->EventURL, TIZEN_SOAP_TIMEOUT, NULL)) {
+		TizenCtrlPointRetrySubscription(sub);
+		return;
+	}
+	SampleUtil_Print("Subscribing to EventURL %s...\n", sub->EventURL);
+	sub->Start = TizenTimer_NowMs();
+	TizenCtrlPointSubscribeBegin();
+	ret = UpnpSubscribeAsync(ctrlpt_handle, sub->EventURL,
+		TizenCtrlPointSubscribeTimeout(),
+		TizenCtrlPointSubscriptionComplete, sub);
+	if (ret != UPNP_E_SUCCESS) {
+		SampleUtil_Print("Error in UpnpSubscribeAsync -- %d\n", ret);
+		TizenCtrlPointSubscribeEnd();
+		TizenCtrlPointRetrySubscription(sub);
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointSubscribeAsync
+ *
+ * Description: 
+ *       Subscribe to one service of a registered device without waiting:
+ *       the SID is indexed once the device accepts, and a failed attempt is
+ *       retried with a growing delay while the device is registered. Does
+ *       nothing if the service is already being subscribed to.
+ *
+ * Parameters:
+ *   handle -- The handle of the device
+ *   service -- The service
+ *   eventURL -- The event URL of the service
+ *   revalidate -- Non-zero for a device restored from the device cache:
+ *                 it is removed if it refuses every subscription. Sent by
+ *                 the timer thread, so that the other services of the
+ *                 device can be queued first
+ *
+ ********************************************************************************/
+static void TizenCtrlPointSubscribeAsync(TizenDeviceHandle handle,
+	int service, const char *eventURL, int revalidate)
+{
+	struct tizen_subscription *sub;
+
+	ithread_mutex_lock(&SubscriptionMutex);
+	for (sub = Subscriptions; sub; sub = sub->Next)
+		if (sub->Handle == handle && sub->Service == service)
+			break;
+	if (sub) {
+		ithread_mutex_unlock(&SubscriptionMutex);
+		return;
+	}
+	sub = (struct tizen_subscription *)calloc(1, sizeof(*sub) +
+		strlen(eventURL));
+	if (!sub) {
+		ithread_mutex_unlock(&SubscriptionMutex);
+		return;
+	}
+	sub->Handle = handle;
+	sub->Service = service;
+	sub->Backoff = TIZEN_SUBSCRIBE_RETRY;
+	sub->Revalidate = revalidate ? TIZEN_REVALIDATE_PENDING : 0;
+	strcpy(sub->EventURL, eventURL);
+	sub->Next = Subscriptions;
+	Subscriptions = sub;
+	SubscribeAsked++;
+	if (revalidate)
+		TizenWheel_Arm(&SubscribeWheel, &sub->Timer, TizenTimer_Now());
+	ithread_mutex_unlock(&SubscriptionMutex);
+
+	if (!revalidate)
+		TizenCtrlPointSendSubscription(sub);
+}
+
+/********************************************************************************
+ * TizenCtrlPointRetrySubscriptions
+ *
+ * Description: 
+ *       Called every second by the timer thread: sends the subscriptions
+ *       whose retry is due.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointRetrySubscriptions(void)
+{
+	struct tizen_timer *due, *timer;
+
+	ithread_mutex_lock(&SubscriptionMutex);
+	due = TizenWheel_Advance(&SubscribeWheel, TizenTimer_Now());
+	ithread_mutex_unlock(&SubscriptionMutex);
+	while (due) {
+		timer = due;
+		due = due->next;
+		TizenCtrlPointSendSubscription((struct tizen_subscription *)
+			((char *)timer -
+			 offsetof(struct tizen_subscription, Timer)));
+	}
+}
+
+/********************************************************************************
+ * TizenCtrlPointNewNode
+ *
+ * Description: 
+ *       Build an unregistered device node from a device description. Every
+ *       state variable starts out as "".
+ *
+ * Parameters:
+ *   info -- The description of the device, copied into the node
+ *
+ * Returns:
+ *   The node, or NULL if out of memory.
+ *
+ ********************************************************************************/
+static struct TizenDeviceNode *TizenCtrlPointNewNode(
+	const struct tizen_device_info *info)
+{
+	const struct tizen_schema *schema;
+	struct TizenDeviceNode *node;
+	struct tizen_freshness *fresh;
+	struct tizen_service *svc;
+	unsigned int arenasize;
+	int service;
+	int var;
+
+	/* Size the arena for every per-device string at once */
+	arenasize = TIZEN_ARENA_SIZE(strlen(info->UDN)) +
+		TIZEN_ARENA_SIZE(strlen(info->DescDocURL)) +
+		TIZEN_ARENA_SIZE(info->FriendlyName ?
+				 strlen(info->FriendlyName) : 0) +
+		TIZEN_ARENA_SIZE(strlen(info->PresURL));
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		arenasize += TIZEN_ARENA_SIZE(info->EventURL[service] ?
+			strlen(info->EventURL[service]) : 0);
+		arenasize += TIZEN_ARENA_SIZE(info->ControlURL[service] ?
+			strlen(info->ControlURL[service]) : 0);
+	}
+
+	node = (struct TizenDeviceNode *)TizenPool_Alloc(&TizenNodePool);
+	if (!node)
+		return NULL;
+	/* Zeroed: every value starts from TIZEN_SOURCE_NONE */
+	fresh = (struct tizen_freshness *)TizenPool_Alloc(&TizenFreshPool);
+	if (!fresh) {
+		TizenPool_Free(&TizenNodePool, node);
+		return NULL;
+	}
+	if (TizenArena_Init(&node->Arena, arenasize) != 0) {
+		TizenPool_Free(&TizenFreshPool, fresh);
+		TizenPool_Free(&TizenNodePool, node);
+		return NULL;
+	}
+	node->OrderIndex = -1;
+	node->CacheSlot = TIZEN_CACHE_NONE;
+	ithread_mutex_init(&node->StateMutex, 0);
+	node->device.UDN = TizenArena_Add(&node->Arena, info->UDN);
+	node->device.DescDocURL = TizenArena_Add(&node->Arena, info->DescDocURL);
+	node->device.FriendlyName =
+	    TizenArena_Add(&node->Arena, info->FriendlyName);
+	node->device.PresURL = TizenArena_Add(&node->Arena, info->PresURL);
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		svc = &node->device.TizenService[service];
+		svc->Fresh = &fresh[service];
+		/* Missing services keep "" everywhere */
+		svc->ServiceId = TizenIntern_Get(info->ServiceId[service]);
+		svc->ServiceType = TizenIntern_Get(
+			info->ServiceId[service] && *info->ServiceId[service] ?
+			TizenServiceType[service] : NULL);
+		svc->EventURL = TizenArena_Add(&node->Arena,
+					       info->EventURL[service]);
+		svc->ControlURL = TizenArena_Add(&node->Arena,
+						 info->ControlURL[service]);
+		/* The SID is filled in by TizenCtrlPointSubscriptionComplete */
+		strcpy(svc->SID, "");
+		/* The pool hands out zeroed nodes: every value starts "",
+		 * or at its SCPD default once the schema is known */
+		schema = TizenSchema_Find(svc->ServiceType);
+		for (var = 0; var < TizenCtrlPointVarCount(schema); var++)
+			TizenValue_Set(&svc->State[var], schema->Vars[var].Type,
+				       schema->Vars[var].Default);
+	}
+
+	return node;
+}
+
+/********************************************************************************
+ * TizenCtrlPointRegisterNode
+ *
+ * Description: 
+ *       Insert a new device node in the registry and arm its advertisement
+ *       timer, unless another discovery of the same device got there first.
+ *       A node that could not be registered is retired.
+ *
+ * Parameters:
+ *   node -- The device node, from TizenCtrlPointNewNode
+ *   expires -- The advertised max-age, in seconds
+ *   handle -- Where to return the handle of the registered device
+ *
+ * Returns:
+ *   0 if the node was registered, -1 otherwise.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointRegisterNode(struct TizenDeviceNode *node,
+	int expires, TizenDeviceHandle *handle)
+{
+	struct TizenDeviceNode *tmpdevnode;
+	int ret;
+
+	ithread_mutex_lock(&DeviceListMutex);
+	tmpdevnode = TizenRegistry_Find(node->device.UDN);
+	if (tmpdevnode) {
+		TizenCtrlPointArmAdvr(tmpdevnode, expires);
+		ret = -1;
+	} else {
+		ret = TizenRegistry_Add(node);
+		if (ret == 0)
+			TizenCtrlPointArmAdvr(node, expires);
+		else
+			SampleUtil_Print("Error adding device %s to the registry\n",
+					 node->device.UDN);
+	}
+	*handle = node->Handle;
+	ithread_mutex_unlock(&DeviceListMutex);
+	if (ret != 0) {
+		/* Never registered and not subscribed: nothing to reap. Its
+		 * cache slot, if any, is the one of the node that won. */
+		TizenRcu_Retire(node, TizenCtrlPointFreeNode);
+		return -1;
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenCtrlPointBuildDescription
+ *
+ * Description: 
+ *       Build the description of a device from the fields extracted from
+ *       its description document.
+ *
+ * Parameters:
+ *   parsed -- The fields of the description document
+ *   location -- The location of the description document URL
+ *   etag -- The ETag of the response it came in, or NULL
+ *   lastmodified -- The Last-Modified of the response, or NULL
+ *
+ * Returns:
+ *   The description (Match set if it is a Tizen device), or NULL if out of
+ *   memory.
+ *
+ ********************************************************************************/
+static struct tizen_desc *TizenCtrlPointBuildDescription(
+	const struct SampleUtil_Description *parsed,
+	const char *location,
+	const char *etag,
+	const char *lastmodified)
+{
+	char presURL[200];
+	char *serviceId[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
+	char *eventURL[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
+	char *controlURL[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
+	char *scpdURL[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
+	struct tizen_device_info info;
+	struct tizen_desc *desc;
+	int match = 0;
+	int ret;
+	int service;
+
+	presURL[0] = '\0';
+
+	if (parsed->modelName && strcmp(parsed->modelName, "Tizen") == 0 &&
+	    parsed->UDN && parsed->deviceType) {
+		SampleUtil_Print("UDN        = %s\n", parsed->UDN);
+		SampleUtil_Print("deviceType = %s\n", parsed->deviceType);
+
+		/* The presentation URL is relative to the Location, URLBase
+		 * is deliberately not used here */
+		if (strlen(location) + (parsed->presentationURL ?
+		    strlen(parsed->presentationURL) : 0) < sizeof(presURL))
+			ret = UpnpResolveURL(location, parsed->presentationURL,
+					     presURL);
+		else
+			ret = UPNP_E_OUTOF_BOUNDS;
+		if (UPNP_E_SUCCESS != ret) {
+			SampleUtil_Print("Error generating presURL from %s + %s\n",
+					 location, parsed->presentationURL ?
+					 parsed->presentationURL : "");
+			presURL[0] = '\0';
+		}
+		match = strcmp(parsed->deviceType, TizenDeviceType) == 0;
 	}
-	SampleUtil_Print("\n");
-	ithread_mutex_unlock(&DeviceListMutex);
 
-	return TIZEN_SUCCESS;
+	/* Other devices are only remembered as not ours */
+	for (service = 0; match && service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		if (!SampleUtil_FindService
+		    (parsed, location, TizenServiceType[service],
+		     &serviceId[service], &eventURL[service],
+		     &controlURL[service], &scpdURL[service])) {
+			SampleUtil_Print
+			    ("Error: Could not find Service: %s\n",
+			     TizenServiceType[service]);
+		}
+	}
+
+	info.UDN = parsed->UDN;
+	info.DescDocURL = location;
+	info.FriendlyName = parsed->friendlyName;
+	info.PresURL = presURL;
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		info.ServiceId[service] = serviceId[service];
+		info.EventURL[service] = eventURL[service];
+		info.ControlURL[service] = controlURL[service];
+		info.SCPDURL[service] = scpdURL[service];
+	}
+	desc = TizenDesc_New(&info, match, etag, lastmodified);
+
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		if (serviceId[service])
+			free(serviceId[service]);
+		if (controlURL[service])
+			free(controlURL[service]);
+		if (eventURL[service])
+			free(eventURL[service]);
+		if (scpdURL[service])
+			free(scpdURL[service]);
+	}
+
+	return desc;
 }
 
 /********************************************************************************
- * TizenCtrlPointAddDevice
+ * TizenCtrlPointParseDescription
  *
  * Description: 
- *       If the device is not already included in the global device list,
- *       add it.  Otherwise, update its advertisement expiration timeout.
+ *       Build the description of a device from its description document.
  *
  * Parameters:
  *   DescDoc -- The description document for the device
  *   location -- The location of the description document URL
- *   expires -- The expiration time for this advertisement
+ *   etag -- The ETag of the response it came in, or NULL
+ *   lastmodified -- The Last-Modified of the response, or NULL
  *
  ********************************************************************************/
-void TizenCtrlPointAddDevice(
+static struct tizen_desc *TizenCtrlPointParseDescription(
 	IXML_Document *DescDoc,
 	const char *location,
+	const char *etag,
+	const char *lastmodified)
+{
+	struct SampleUtil_Description parsed;
+
+	/* Read every element we need in a single walk of the document */
+	SampleUtil_ParseDescription(DescDoc, &parsed);
+
+	return TizenCtrlPointBuildDescription(&parsed, location, etag,
+		lastmodified);
+}
+
+/********************************************************************************
+ * TizenCtrlPointAddDescription
+ *
+ * Description: 
+ *       If the device of a parsed description is not already included in
+ *       the global device list, add it and subscribe to its services.
+ *       Otherwise, update its advertisement expiration timeout.
+ *
+ * Parameters:
+ *   desc -- The parsed description
+ *   expires -- The expiration time for this advertisement
+ *
+ ********************************************************************************/
+static void TizenCtrlPointAddDescription(const struct tizen_desc *desc,
 	int expires)
 {
-	char *deviceType = NULL;
-	char *friendlyName = NULL;
-	char presURL[200];
-	char *baseURL = NULL;
-	char *relURL = NULL;
-	char *UDN = NULL;
-	char *deviceTizen = NULL;
-	char *serviceId[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
-	char *eventURL[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
-	char *controlURL[TIZEN_SERVICE_SERVCOUNT] = { NULL, NULL };
-	Upnp_SID eventSID[TIZEN_SERVICE_SERVCOUNT];
-	int TimeOut[TIZEN_SERVICE_SERVCOUNT] = {
-		default_timeout,
-		default_timeout
-	};
 	struct TizenDeviceNode *deviceNode;
 	struct TizenDeviceNode *tmpdevnode;
-	int ret = 1;
-	int found = 0;
+	TizenDeviceHandle handle;
 	int service;
-	int var;
 
+	if (!desc->Match)
+		return;
+
+	SampleUtil_Print("Found Tizen device\n");
+
+	/* Check if this device is already in the list */
 	ithread_mutex_lock(&DeviceListMutex);
+	tmpdevnode = TizenRegistry_Find(desc->info.UDN);
+	if (tmpdevnode) {
+		/* The device is already there, so just re-arm  */
+		/* its advertisement timer */
+		TizenCtrlPointArmAdvr(tmpdevnode, expires);
+	}
+	ithread_mutex_unlock(&DeviceListMutex);
+	if (tmpdevnode)
+		return;
+
+	deviceNode = TizenCtrlPointNewNode(&desc->info);
+	if (!deviceNode)
+		return;
+	printf("------------------------------------------\n");
 
-	/* Read key elements from description document */
-	deviceTizen = SampleUtil_GetFirstDocumentItem(DescDoc, "modelName");
-	UDN = SampleUtil_GetFirstDocumentItem(DescDoc, "UDN");
-	deviceType = SampleUtil_GetFirstDocumentItem(DescDoc, "deviceType");
-	friendlyName = SampleUtil_GetFirstDocumentItem(DescDoc, "friendlyName");
-	//baseURL = SampleUtil_GetFirstDocumentItem(DescDoc, "URLBase");
-	relURL = SampleUtil_GetFirstDocumentItem(DescDoc, "presentationURL");
+	if (TizenCtrlPointRegisterNode(deviceNode, expires, &handle) != 0)
+		return;
+	/*Notify New Device Added */
+	SampleUtil_StateUpdate(NULL, NULL, desc->info.UDN, DEVICE_ADDED);
 
-	if(!deviceTizen || strcmp(deviceTizen, "Tizen")) {
-		goto __finish_add_device;
+	/* deviceNode may be removed and retired from here on, only the
+	 * handle and the URLs of the description are used. The services are
+	 * subscribed to in parallel. */
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		if (*desc->info.EventURL[service])
+			TizenCtrlPointSubscribeAsync(handle, service,
+				desc->info.EventURL[service], 0);
 	}
-	SampleUtil_Print("UDN        = %s\n", UDN);
-	SampleUtil_Print("deviceType = %s\n", deviceType);
+}
 
-	ret = UpnpResolveURL((baseURL ? baseURL : location), relURL, presURL);
+/********************************************************************************
+ * TizenCtrlPointAddDevice
+ *
+ * Description: 
+ *       If the device is not already included in the global device list,
+ *       add it.  Otherwise, update its advertisement expiration timeout.
+ *
+ * Parameters:
+ *   DescDoc -- The description document for the device
+ *   location -- The location of the description document URL
+ *   expires -- The expiration time for this advertisement
+ *
+ ********************************************************************************/
+void TizenCtrlPointAddDevice(
+	IXML_Document *DescDoc,
+	const char *location,
+	int expires)
+{
+	struct tizen_desc *desc;
 
-	if (UPNP_E_SUCCESS != ret)
-		SampleUtil_Print("Error generating presURL from %s + %s\n",
-				 baseURL, relURL);
+	desc = TizenCtrlPointParseDescription(DescDoc, location, NULL, NULL);
+	if (desc)
+		TizenCtrlPointAddDescription(desc, expires);
+	TizenDesc_Put(desc);
+}
 
-	if (strcmp(deviceType, TizenDeviceType) == 0) {
-		SampleUtil_Print("Found Tizen device\n");
+/*! A device read back from the device cache. */
+struct tizen_warm_node {
+	struct TizenDeviceNode *node;
+	/* Seconds left before its advertisement expires */
+	int expires;
+};
 
-		/* Check if this device is already in the list */
-		tmpdevnode = GlobalDeviceList;
-		while (tmpdevnode) {
-			if (strcmp(tmpdevnode->device.UDN, UDN) == 0) {
-				found = 1;
-				break;
-			}
-			tmpdevnode = tmpdevnode->next;
-		}
+struct tizen_warm_list {
+	struct tizen_warm_node *items;
+	int count;
+	int size;
+};
 
-		if (found) {
-			/* The device is already there, so just update  */
-			/* the advertisement timeout field */
-			tmpdevnode->device.AdvrTimeOut = expires;
-		} else {
-			for (service = 0; service < TIZEN_SERVICE_SERVCOUNT;
-			     service++) {
-				if (SampleUtil_FindAndParseService
-				    (DescDoc, location, TizenServiceType[service],
-				     &serviceId[service], &eventURL[service],
-				     &controlURL[service])) {
-					SampleUtil_Print
-					    ("Subscribing to EventURL %s...\n",
-					     eventURL[service]);
-					ret =
-					    UpnpSubscribe(ctrlpt_handle,
-							  eventURL[service],
-							  &TimeOut[service],
-							  eventSID[service]);
-					if (ret == UPNP_E_SUCCESS) {
-						SampleUtil_Print
-						    ("Subscribed to EventURL with SID=%s\n",
-						     eventSID[service]);
-					} else {
-						SampleUtil_Print
-						    ("Error Subscribing to EventURL -- %d\n",
-						     ret);
-						strcpy(eventSID[service], "");
-					}
-				} else {
-					SampleUtil_Print
-					    ("Error: Could not find Service: %s\n",
-					     TizenServiceType[service]);
-				}
-			}
-			/* Create a new device node */
-			deviceNode =
-			    (struct TizenDeviceNode *)
-			    malloc(sizeof(struct TizenDeviceNode));
-			strcpy(deviceNode->device.UDN, UDN);
-			strcpy(deviceNode->device.DescDocURL, location);
-			strcpy(deviceNode->device.FriendlyName, friendlyName);
-			strcpy(deviceNode->device.PresURL, presURL);
-			deviceNode->device.AdvrTimeOut = expires;
-			for (service = 0; service < TIZEN_SERVICE_SERVCOUNT;
-			     service++) {
-				if (serviceId[service] == NULL) {
-					/* not found */
-					continue;
-				}
-				strcpy(deviceNode->device.TizenService[service].
-				       ServiceId, serviceId[service]);
-				strcpy(deviceNode->device.TizenService[service].
-				       ServiceType, TizenServiceType[service]);
-				strcpy(deviceNode->device.TizenService[service].
-				       ControlURL, controlURL[service]);
-				strcpy(deviceNode->device.TizenService[service].
-				       EventURL, eventURL[service]);
-				strcpy(deviceNode->device.TizenService[service].
-				       SID, eventSID[service]);
-				for (var = 0; var < TizenVarCount[service]; var++) {
-					deviceNode->device.
-					    TizenService[service].VariableStrVal
-					    [var] =
-					    (char *)malloc(TIZEN_MAX_VAL_LEN);
-					strcpy(deviceNode->device.
-					       TizenService[service].VariableStrVal
-					       [var], "");
-				}
-			}
-			printf("------------------------------------------\n");
-			deviceNode->next = NULL;
-			/* Insert the new device node in the list */
-			if ((tmpdevnode = GlobalDeviceList)) {
-				while (tmpdevnode) {
-					if (tmpdevnode->next) {
-						tmpdevnode = tmpdevnode->next;
-					} else {
-						tmpdevnode->next = deviceNode;
-						break;
-					}
-				}
-			} else {
-				GlobalDeviceList = deviceNode;
-			}
-			/*Notify New Device Added */
-			SampleUtil_StateUpdate(NULL, NULL,
-					       deviceNode->device.UDN,
-					       DEVICE_ADDED);
-		}
+/********************************************************************************
+ * TizenCtrlPointWarmVisit
+ *
+ * Description: 
+ *       TizenCache_Load callback: rebuild an unregistered node from a cached
+ *       record whose advertisement has not run out yet.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointWarmVisit(const struct tizen_cache_entry *entry,
+	int slot, void *cookie)
+{
+	struct tizen_warm_list *warm = (struct tizen_warm_list *)cookie;
+	const struct tizen_schema *schema;
+	struct tizen_warm_node *items;
+	struct TizenDeviceNode *node;
+	long long left;
+	int service, var;
+
+	left = entry->Deadline - (long long)time(NULL);
+	if (left <= 0 || !*entry->info.UDN)
+		return 0;
+	if (warm->count == warm->size) {
+		items = (struct tizen_warm_node *)realloc(warm->items,
+			(warm->size ? warm->size * 2 : 16) * sizeof(*items));
+		if (!items)
+			return 0;
+		warm->items = items;
+		warm->size = warm->size ? warm->size * 2 : 16;
+	}
+	node = TizenCtrlPointNewNode(&entry->info);
+	if (!node)
+		return 0;
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		schema = TizenSchema_Find(
+			node->device.TizenService[service].ServiceType);
+		for (var = 0; var < TIZEN_MAXVARS; var++)
+			TizenValue_Set(&node->device.TizenService[service].State[var],
+				var < TizenCtrlPointVarCount(schema) ?
+				schema->Vars[var].Type : TIZEN_TYPE_STRING,
+				entry->State[service][var]);
 	}
+	node->CacheSlot = slot;
+	warm->items[warm->count].node = node;
+	warm->items[warm->count].expires = (int)left;
+	warm->count++;
 
-__finish_add_device :
+	return 1;
+}
 
-	ithread_mutex_unlock(&DeviceListMutex);
+/********************************************************************************
+ * TizenCtrlPointWarmStart
+ *
+ * Description: 
+ *       Open the device cache and register the devices it remembers, so
+ *       that they can be controlled before any search response comes in.
+ *       They are subscribed to again asynchronously, and removed if they
+ *       refuse every subscription.
+ *
+ ********************************************************************************/
+static void TizenCtrlPointWarmStart(void)
+{
+	struct tizen_warm_list warm = { NULL, 0, 0 };
+	struct TizenDeviceNode *node;
+	TizenDeviceHandle handle;
+	int service;
+	int slot;
+	int i;
 
-	if (deviceTizen)
-		free(deviceTizen);
-	if (deviceType)
-		free(deviceType);
-	if (friendlyName)
-		free(friendlyName);
-	if (UDN)
-		free(UDN);
-	if (baseURL)
-		free(baseURL);
-	if (relURL)
-		free(relURL);
-	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
-		if (serviceId[service])
-			free(serviceId[service]);
-		if (controlURL[service])
-			free(controlURL[service]);
-		if (eventURL[service])
-			free(eventURL[service]);
+	if (TizenCache_Open(TizenCacheFile) != 0)
+		return;
+	TizenCache_Load(TizenCtrlPointWarmVisit, &warm);
+
+	for (i = 0; i < warm.count; i++) {
+		node = warm.items[i].node;
+		slot = node->CacheSlot;
+		if (TizenCtrlPointRegisterNode(node, warm.items[i].expires,
+		    &handle) != 0) {
+			/* Same UDN twice in the cache */
+			TizenCache_Drop(&slot);
+			continue;
+		}
+		SampleUtil_Print("Restored cached device %s\n",
+				 node->device.UDN);
+		SampleUtil_StateUpdate(NULL, NULL, node->device.UDN,
+				       DEVICE_ADDED);
+		/* The timer thread, not started yet, sends them */
+		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++)
+			if (*node->device.TizenService[service].EventURL)
+				TizenCtrlPointSubscribeAsync(handle, service,
+					node->device.TizenService[service].EventURL,
+					1);
 	}
+	free(warm.items);
 }
 
-void TizenStateUpdate(char *UDN, int Service, IXML_Document *ChangedVariables,
-		   char **State)
+void TizenStateUpdate(const char *UDN, int Service, IXML_Document *ChangedVariables,
+		   struct tizen_service *Svc)
 {
-	IXML_NodeList *properties;
-	IXML_NodeList *variables;
-	IXML_Element *property;
-	IXML_Element *variable;
-	long unsigned int length;
-	long unsigned int length1;
-	long unsigned int i;
+	const struct tizen_schema *schema;
+	IXML_Node *propertyset;
+	IXML_Node *property;
+	IXML_Node *variable;
+	IXML_Node *value;
 	int j;
-	char *tmpstate = NULL;
 
 	SampleUtil_Print("Tizen State Update (service %d):\n", Service);
-	/* Find all of the e:property tags in the document */
-	properties = ixmlDocument_getElementsByTagName(ChangedVariables,
-		"e:property");
-	if (properties) {
-		length = ixmlNodeList_length(properties);
-		for (i = 0; i < length; i++) {
-			/* Loop through each property change found */
-			property = (IXML_Element *)ixmlNodeList_item(
-				properties, i);
-			/* For each variable name in the state table,
-			 * check if this is a corresponding property change */
-			for (j = 0; j < TizenVarCount[Service]; j++) {
-				variables = ixmlElement_getElementsByTagName(
-					property, TizenVarName[Service][j]);
-				/* If a match is found, extract 
-				 * the value, and update the state table */
-				if (variables) {
-					length1 = ixmlNodeList_length(variables);
-					if (length1) {
-						variable = (IXML_Element *)
-							ixmlNodeList_item(variables, 0);
-						tmpstate =
-						    SampleUtil_GetElementValue(variable);
-						if (tmpstate) {
-							strcpy(State[j], tmpstate);
-							SampleUtil_Print(
-								" Variable Name: %s New Value:'%s'\n",
-								TizenVarName[Service][j], State[j]);
-						}
-						if (tmpstate)
-							free(tmpstate);
-						tmpstate = NULL;
-					}
-					ixmlNodeList_free(variables);
-					variables = NULL;
-				}
-			}
+	schema = TizenSchema_Find(TizenServiceType[Service]);
+	/* Until its SCPD is loaded the variables of the service are unknown */
+	if (!schema)
+		return;
+	/* A single walk over e:propertyset/e:property/<variable> */
+	propertyset = ixmlNode_getFirstChild((IXML_Node *)ChangedVariables);
+	while (propertyset &&
+	       ixmlNode_getNodeType(propertyset) != eELEMENT_NODE)
+		propertyset = ixmlNode_getNextSibling(propertyset);
+	if (!propertyset)
+		return;
+	for (property = ixmlNode_getFirstChild(propertyset); property;
+	     property = ixmlNode_getNextSibling(property)) {
+		if (ixmlNode_getNodeType(property) != eELEMENT_NODE ||
+		    strcmp(ixmlNode_getNodeName(property), "e:property") != 0)
+			continue;
+		for (variable = ixmlNode_getFirstChild(property); variable;
+		     variable = ixmlNode_getNextSibling(variable)) {
+			if (ixmlNode_getNodeType(variable) != eELEMENT_NODE)
+				continue;
+			j = TizenSchema_VarIndex(schema,
+				ixmlNode_getNodeName(variable));
+			if (j < 0 || j >= TIZEN_MAXVARS)
+				continue;
+			value = ixmlNode_getFirstChild(variable);
+			if (!value || ixmlNode_getNodeType(value) != eTEXT_NODE)
+				continue;
+			/* Numbers are parsed here, once */
+			TizenValue_Set(&Svc->State[j], schema->Vars[j].Type,
+				ixmlNode_getNodeValue(value));
+			Svc->Fresh->Source[j] = TIZEN_SOURCE_EVENT;
+			Svc->Fresh->Updated[j] = TizenTimer_Now();
+			SampleUtil_Print(" Variable Name: %s New Value:'%s'\n",
+				schema->Vars[j].Name,
+				TizenValue_Text(&Svc->State[j]));
+			if (schema->Vars[j].HasRange &&
+			    Svc->State[j].Type == TIZEN_TYPE_INT &&
+			    (Svc->State[j].Num.Int < schema->Vars[j].Minimum ||
+			     Svc->State[j].Num.Int > schema->Vars[j].Maximum))
+				SampleUtil_Print(" Warning: %s out of range [%ld, %ld]\n",
+					schema->Vars[j].Name,
+					schema->Vars[j].Minimum,
+					schema->Vars[j].Maximum);
 		}
-		ixmlNodeList_free(properties);
 	}
 	return;
 	UDN = UDN;
 }
 
 /********************************************************************************
- * /TizenCtrlPointHandleEvent
+ * TizenCtrlPointDeliverEvent
  *
  * Description: 
- *       Handle a UPnP event that was received.  Process the event and update
- *       the appropriate service state table.
+ *       Update the state table of the service an event belongs to.
  *
  * Parameters:
  *   sid -- The subscription id for the event
  *   eventkey -- The eventkey number for the event
  *   changes -- The DOM document representing the changes
  *
+ * Returns:
+ *   1 if the SID is known, 0 otherwise.
+ *
  ********************************************************************************/
-void TizenCtrlPointHandleEvent(
+static int TizenCtrlPointDeliverEvent(
 	const char *sid,
 	int evntkey,
 	IXML_Document *changes)
 {
 	struct TizenDeviceNode *tmpdevnode;
 	int service;
-
-	ithread_mutex_lock(&DeviceListMutex);
-
-	tmpdevnode = GlobalDeviceList;
-	while (tmpdevnode) {
-		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; ++service) {
-			if (strcmp(tmpdevnode->device.TizenService[service].SID, sid) ==  0) {
-				SampleUtil_Print("Received Tizen %s Event: %d for SID %s\n",
-					TizenServiceName[service],
-					evntkey,
-					sid);
-				TizenStateUpdate(
-					tmpdevnode->device.UDN,
-					service,
-					changes,
-					(char **)&tmpdevnode->device.TizenService[service].VariableStrVal);
-				break;
-			}
-		}
-		tmpdevnode = tmpdevnode->next;
+	int rcu;
+
+	rcu = TizenRcu_ReadLock();
+	tmpdevnode = TizenRegistry_FindBySID(sid, &service);
+	if (tmpdevnode) {
+		SampleUtil_Print("Received Tizen %s Event: %d for SID %s\n",
+			TizenServiceName[service],
+			evntkey,
+			sid);
+		ithread_mutex_lock(&tmpdevnode->StateMutex);
+		TizenStateUpdate(
+			tmpdevnode->device.UDN,
+			service,
+			changes,
+			&tmpdevnode->device.TizenService[service]);
+		ithread_mutex_unlock(&tmpdevnode->StateMutex);
+		TizenCtrlPointMarkDirty(tmpdevnode, TIZEN_CACHE_DIRTY_STATE);
 	}
+	TizenRcu_ReadUnlock(rcu);
 
-	ithread_mutex_unlock(&DeviceListMutex);
+	return tmpdevnode != NULL;
+}
+
+/********************************************************************************
+ * /TizenCtrlPointHandleEvent
+ *
+ * Description: 
+ *       Handle a UPnP event that was received.  Process the event and update
+ *       the appropriate service state table.
+ *
+ * Parameters:
+ *   sid -- The subscription id for the event
+ *   eventkey -- The eventkey number for the event
+ *   changes -- The DOM document representing the changes
+ *
+ ********************************************************************************/
+void TizenCtrlPointHandleEvent(
+	const char *sid,
+	int evntkey,
+	IXML_Document *changes)
+{
+	/* Possibly the initial event of a subscription whose SID we have not
+	 * been told yet */
+	if (!TizenCtrlPointDeliverEvent(sid, evntkey, changes))
+		TizenCtrlPointParkEvent(sid, evntkey, changes);
 }
 
 /********************************************************************************
@@ -977,25 +3774,17 @@ void TizenCtrlPointHandleSubscribeUpdate(
 
 	ithread_mutex_lock(&DeviceListMutex);
 
-	tmpdevnode = GlobalDeviceList;
-	while (tmpdevnode) {
-		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
-			if (strcmp
-			    (tmpdevnode->device.TizenService[service].EventURL,
-			     eventURL) == 0) {
-				SampleUtil_Print
-				    ("Received Tizen %s Event Renewal for eventURL %s\n",
-				     TizenServiceName[service], eventURL);
-				strcpy(tmpdevnode->device.TizenService[service].
-				       SID, sid);
-				break;
-			}
-		}
-
-		tmpdevnode = tmpdevnode->next;
+	tmpdevnode = TizenRegistry_FindByEventURL(eventURL, &service);
+	if (tmpdevnode) {
+		SampleUtil_Print
+		    ("Received Tizen %s Event Renewal for eventURL %s\n",
+		     TizenServiceName[service], eventURL);
+		TizenRegistry_SetSID(tmpdevnode, service, sid);
 	}
 
 	ithread_mutex_unlock(&DeviceListMutex);
+	if (tmpdevnode)
+		TizenCtrlPointReplayEvents(sid);
 
 	return;
 	timeout = timeout;
@@ -1007,27 +3796,220 @@ void TizenCtrlPointHandleGetVar(
 	const DOMString varValue)
 {
 
+	const struct tizen_schema *schema;
 	struct TizenDeviceNode *tmpdevnode;
+	struct tizen_service *svc;
+	int service;
+	int var;
+	int rcu;
+
+	rcu = TizenRcu_ReadLock();
+
+	tmpdevnode = TizenRegistry_FindByControlURL(controlURL, &service);
+	if (tmpdevnode) {
+		/* Keep the answer for the next GetVar */
+		svc = &tmpdevnode->device.TizenService[service];
+		schema = TizenSchema_Find(svc->ServiceType);
+		var = TizenSchema_VarIndex(schema, varName);
+		if (var >= 0 && var < TIZEN_MAXVARS) {
+			ithread_mutex_lock(&tmpdevnode->StateMutex);
+			TizenValue_Set(&svc->State[var], schema->Vars[var].Type,
+				       varValue);
+			svc->Fresh->Source[var] = TIZEN_SOURCE_QUERY;
+			svc->Fresh->Updated[var] = TizenTimer_Now();
+			ithread_mutex_unlock(&tmpdevnode->StateMutex);
+		}
+		SampleUtil_StateUpdate(varName, varValue,
+				       tmpdevnode->device.UDN,
+				       GET_VAR_COMPLETE);
+	}
+
+	TizenRcu_ReadUnlock(rcu);
+}
+
+/********************************************************************************
+ * TizenCtrlPointRenewDevice
+ *
+ * Description: 
+ *       Fast path for the announcements of a known device: re-arm its
+ *       advertisement timer without downloading its description again.
+ *       A device announced at another Location has moved (new address or
+ *       reboot with a new description URL), so it is removed and must be
+ *       fetched again.
+ *
+ * Parameters:
+ *   UDN -- The Unique Device Name of the device
+ *   location -- The announced Location URL
+ *   expires -- The advertised max-age, in seconds
+ *
+ * Returns:
+ *   TIZEN_SUCCESS if the device is known at that Location and was renewed,
+ *   TIZEN_WARNING if it was known at another Location and was removed,
+ *   TIZEN_ERROR if it is unknown or its service schemas are not loaded yet.
+ *
+ ********************************************************************************/
+static int TizenCtrlPointRenewDevice(const char *UDN, const char *location,
+	int expires)
+{
+	struct TizenDeviceNode *devnode;
+	int ret = TIZEN_ERROR;
 	int service;
 
+	if (!UDN || !*UDN)
+		return TIZEN_ERROR;
 	ithread_mutex_lock(&DeviceListMutex);
+	devnode = TizenRegistry_Find(UDN);
+	if (devnode && strcmp(devnode->device.DescDocURL, location) == 0) {
+		TizenCtrlPointArmAdvr(devnode, expires);
+		ret = TIZEN_SUCCESS;
+		/* Restored from the device cache before the SCPDs of its
+		 * services were seen: fetch the description to load them */
+		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++)
+			if (*devnode->device.TizenService[service].ServiceType &&
+			    !TizenSchema_Find(
+			     devnode->device.TizenService[service].ServiceType))
+				ret = TIZEN_ERROR;
+	} else if (devnode) {
+		SampleUtil_Print("Device %s moved to %s\n", UDN, location);
+		TizenWheel_Cancel(&devnode->AdvrTimer);
+		TizenRegistry_Remove(devnode);
+		TizenCtrlPointDeleteNode(devnode);
+		ret = TIZEN_WARNING;
+	}
+	ithread_mutex_unlock(&DeviceListMutex);
 
-	tmpdevnode = GlobalDeviceList;
-	while (tmpdevnode) {
-		for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
-			if (strcmp
-			    (tmpdevnode->device.TizenService[service].ControlURL,
-			     controlURL) == 0) {
-				SampleUtil_StateUpdate(varName, varValue,
-						       tmpdevnode->device.UDN,
-						       GET_VAR_COMPLETE);
-				break;
-			}
+	return ret;
+}
+
+/********************************************************************************
+ * TizenCtrlPointLoadSchemas
+ *
+ * Description: 
+ *       Download and parse the SCPD of every service of a device whose
+ *       service type has no schema yet. Each SCPD is thus fetched once per
+ *       service type, not once per device. Runs on a fetch thread.
+ *
+ * Parameters:
+ *   desc -- The description of the device
+ *
+ ********************************************************************************/
+static void TizenCtrlPointLoadSchemas(const struct tizen_desc *desc)
+{
+	const struct tizen_schema *schema;
+	struct tizen_http_response resp;
+	int service;
+
+	for (service = 0; desc->Match && service < TIZEN_SERVICE_SERVCOUNT;
+	     service++) {
+		if (!*desc->info.SCPDURL[service] ||
+		    TizenSchema_Find(TizenServiceType[service]))
+			continue;
+		if (TizenHttp_Request("GET", desc->info.SCPDURL[service], NULL,
+				      NULL, 0, &resp,
+				      TIZEN_DESC_FETCH_TIMEOUT) != 0) {
+			SampleUtil_Print("Error obtaining SCPD from %s\n",
+					 desc->info.SCPDURL[service]);
+			continue;
 		}
-		tmpdevnode = tmpdevnode->next;
+		/* Its state has to fit in the state tables of the nodes */
+		schema = resp.status == 200 && resp.body ?
+			TizenSchema_Load(TizenServiceType[service], resp.body,
+					 TIZEN_MAXVARS) :
+			NULL;
+		if (!schema && resp.status == 200 && resp.body)
+			SampleUtil_Print("Error: SCPD from %s is invalid or has "
+					 "more than %d state variables\n",
+					 desc->info.SCPDURL[service],
+					 TIZEN_MAXVARS);
+		else if (!schema)
+			SampleUtil_Print("Error parsing SCPD from %s -- HTTP %d\n",
+					 desc->info.SCPDURL[service],
+					 resp.status);
+		else if (TizenSoap_Prepare(schema) != 0)
+			SampleUtil_Print("Error compiling the actions of %s\n",
+					 TizenServiceType[service]);
+		TizenHttp_Free(&resp);
 	}
+}
 
-	ithread_mutex_unlock(&DeviceListMutex);
+/********************************************************************************
+ * TizenCtrlPointFetchDevice
+ *
+ * Description: 
+ *       Download a device description and add the device. Runs on a fetch
+ *       thread (see TizenFetch_Start), never on a libupnp callback. A
+ *       description seen before is requested conditionally, and reused as
+ *       is if the device answers 304 Not Modified.
+ *
+ * Parameters:
+ *   location -- The Location URL of the description
+ *   expires -- The advertised max-age, in seconds
+ *
+ ********************************************************************************/
+static void TizenCtrlPointFetchDevice(const char *location, int expires)
+{
+	struct SampleUtil_Description parsed;
+	struct tizen_http_response resp;
+	struct tizen_desc *cached, *desc = NULL;
+	IXML_Document *DescDoc = NULL;
+	char headers[2 * TIZEN_HTTP_VALIDATOR_LEN + 64];
+	int ret;
+
+	/* Revalidate what we parsed last time rather than parse it again */
+	headers[0] = '\0';
+	cached = TizenDesc_Find(location);
+	if (cached && *cached->ETag)
+		snprintf(headers, sizeof(headers), "If-None-Match: %s\r\n",
+			 cached->ETag);
+	if (cached && *cached->LastModified)
+		snprintf(headers + strlen(headers),
+			 sizeof(headers) - strlen(headers),
+			 "If-Modified-Since: %s\r\n", cached->LastModified);
+
+	ret = TizenHttp_Request("GET", location, headers, NULL, 0, &resp,
+				TIZEN_DESC_FETCH_TIMEOUT);
+	if (ret != 0) {
+		SampleUtil_Print("Error obtaining device description from %s\n",
+			location);
+	} else if (resp.status == 304 && cached) {
+		desc = cached;
+		cached = NULL;
+	} else if (resp.status != 200 || !resp.body) {
+		SampleUtil_Print("Error obtaining device description from %s -- HTTP %d\n",
+			location, resp.status);
+	} else if (TizenXml_ParseDescription(resp.body, resp.length,
+					     &parsed) == 0) {
+		/* The usual case: no DOM at all */
+		desc = TizenCtrlPointBuildDescription(&parsed, location,
+			resp.ETag, resp.LastModified);
+		if (desc && (*desc->ETag || *desc->LastModified))
+			TizenDesc_Store(desc);
+		else
+			TizenDesc_Remove(location);
+	} else if (ixmlParseBufferEx(resp.body, &DescDoc) != IXML_SUCCESS) {
+		SampleUtil_Print("Error parsing device description from %s\n",
+			location);
+	} else {
+		desc = TizenCtrlPointParseDescription(DescDoc, location,
+			resp.ETag, resp.LastModified);
+		/* Without a validator there is nothing to revalidate */
+		if (desc && (*desc->ETag || *desc->LastModified))
+			TizenDesc_Store(desc);
+		else
+			TizenDesc_Remove(location);
+	}
+	if (ret == 0)
+		TizenHttp_Free(&resp);
+	if (DescDoc) {
+		ixmlDocument_free(DescDoc);
+	}
+	TizenDesc_Put(cached);
+	if (desc) {
+		TizenCtrlPointLoadSchemas(desc);
+		TizenCtrlPointAddDescription(desc, expires);
+		TizenDesc_Put(desc);
+	}
+	TizenCtrlPointPrintList();
 }
 
 /********************************************************************************
@@ -1056,25 +4038,24 @@ int TizenCtrlPointCallbackEventHandler(Upnp_EventType EventType, void *Event, vo
 	case UPNP_DISCOVERY_ADVERTISEMENT_ALIVE:
 	case UPNP_DISCOVERY_SEARCH_RESULT: {
 		struct Upnp_Discovery *d_event = (struct Upnp_Discovery *)Event;
-		IXML_Document *DescDoc = NULL;
-		int ret;
 
 		if (d_event->ErrCode != UPNP_E_SUCCESS) {
 			SampleUtil_Print("Error in Discovery Callback -- %d\n",
 				d_event->ErrCode);
 		}
-		ret = UpnpDownloadXmlDoc(d_event->Location, &DescDoc);
-		if (ret != UPNP_E_SUCCESS) {
-			SampleUtil_Print("Error obtaining device description from %s -- error = %d\n",
-				d_event->Location, ret);
-		} else {
-			TizenCtrlPointAddDevice(
-				DescDoc, d_event->Location, d_event->Expires);
-		}
-		if (DescDoc) {
-			ixmlDocument_free(DescDoc);
-		}
-		TizenCtrlPointPrintList();
+		/* A device re-announces itself several times per cycle, one
+		 * NT at a time: as long as its Location does not change, all
+		 * it needs is a longer lease. */
+		if (TizenCtrlPointRenewDevice(d_event->DeviceId,
+		    d_event->Location, d_event->Expires) == TIZEN_SUCCESS)
+			break;
+		/* An ALIVE comes again next cycle, a search result does not:
+		 * shed the former first when the fetch queue is busy. */
+		if (TizenFetch_Submit(d_event->Location, d_event->Expires,
+		    EventType == UPNP_DISCOVERY_ADVERTISEMENT_ALIVE) ==
+		    TIZEN_FETCH_DROPPED)
+			SampleUtil_Print("Fetch queue busy, dropping announcement from %s\n",
+				d_event->Location);
 		break;
 	}
 	case UPNP_DISCOVERY_SEARCH_TIMEOUT:
@@ -1117,6 +4098,8 @@ int TizenCtrlPointCallbackEventHandler(Upnp_EventType EventType, void *Event, vo
 				sv_event->StateVarName,
 				sv_event->CurrentVal);
 		}
+		/* Only GetVar queries carry a cookie */
+		TizenCtrlPointEndGetVar((struct tizen_getvar *)Cookie);
 		break;
 	}
 	/* GENA Stuff */
@@ -1129,8 +4112,18 @@ int TizenCtrlPointCallbackEventHandler(Upnp_EventType EventType, void *Event, vo
 			e_event->ChangedVariables);
 		break;
 	}
+	case UPNP_EVENT_UNSUBSCRIBE_COMPLETE: {
+		struct Upnp_Event_Subscribe *es_event = (struct Upnp_Event_Subscribe *)Event;
+
+		/* Issued by the reaper for a node that is already gone: the
+		 * SID must not be written back to a re-added device. */
+		if (es_event->ErrCode != UPNP_E_SUCCESS) {
+			SampleUtil_Print("Error in Event Unsubscribe Callback -- %d\n",
+					es_event->ErrCode);
+		}
+		break;
+	}
 	case UPNP_EVENT_SUBSCRIBE_COMPLETE:
-	case UPNP_EVENT_UNSUBSCRIBE_COMPLETE:
 	case UPNP_EVENT_RENEWAL_COMPLETE: {
 		struct Upnp_Event_Subscribe *es_event = (struct Upnp_Event_Subscribe *)Event;
 
@@ -1148,24 +4141,21 @@ int TizenCtrlPointCallbackEventHandler(Upnp_EventType EventType, void *Event, vo
 	case UPNP_EVENT_AUTORENEWAL_FAILED:
 	case UPNP_EVENT_SUBSCRIPTION_EXPIRED: {
 		struct Upnp_Event_Subscribe *es_event = (struct Upnp_Event_Subscribe *)Event;
-		int TimeOut = default_timeout;
-		Upnp_SID newSID;
-		int ret;
-
-		ret = UpnpSubscribe(
-			ctrlpt_handle,
-			es_event->PublisherUrl,
-			&TimeOut,
-			newSID);
-		if (ret == UPNP_E_SUCCESS) {
-			SampleUtil_Print("Subscribed to EventURL with SID=%s\n", newSID);
-			TizenCtrlPointHandleSubscribeUpdate(
-				es_event->PublisherUrl,
-				newSID,
-				TimeOut);
-		} else {
-			SampleUtil_Print("Error Subscribing to EventURL -- %d\n", ret);
-		}
+		struct TizenDeviceNode *devnode;
+		TizenDeviceHandle handle = TIZEN_INVALID_HANDLE;
+		int service;
+		int rcu;
+
+		/* Subscribe afresh without holding this libupnp thread */
+		rcu = TizenRcu_ReadLock();
+		devnode = TizenRegistry_FindByEventURL(es_event->PublisherUrl,
+						       &service);
+		if (devnode)
+			handle = devnode->Handle;
+		TizenRcu_ReadUnlock(rcu);
+		if (handle != TIZEN_INVALID_HANDLE)
+			TizenCtrlPointSubscribeAsync(handle, service,
+						     es_event->PublisherUrl, 0);
 		break;
 	}
 	/* ignore these cases, since this is not a device */
@@ -1179,65 +4169,90 @@ int TizenCtrlPointCallbackEventHandler(Upnp_EventType EventType, void *Event, vo
 	Cookie = Cookie;
 }
 
-void TizenCtrlPointVerifyTimeouts(int incr)
+void TizenCtrlPointVerifyTimeouts(void)
 {
-	struct TizenDeviceNode *prevdevnode;
 	struct TizenDeviceNode *curdevnode;
-	int ret;
+	struct tizen_timer *due, *timer;
+	char **renew = NULL;
+	int nrenew = 0;
+	int ndue = 0;
+	unsigned int now;
+	int ret, pos;
 
 	ithread_mutex_lock(&DeviceListMutex);
 
-	prevdevnode = NULL;
-	curdevnode = GlobalDeviceList;
-	while (curdevnode) {
-		curdevnode->device.AdvrTimeOut -= incr;
-		/*SampleUtil_Print("Advertisement Timeout: %d\n", curdevnode->device.AdvrTimeOut); */
-		if (curdevnode->device.AdvrTimeOut <= 0) {
+	now = TizenTimer_Now();
+	due = TizenWheel_Advance(&AdvrWheel, now);
+	for (timer = due; timer; timer = timer->next)
+		ndue++;
+	if (ndue)
+		renew = (char **)malloc(ndue * sizeof(char *));
+	while (due) {
+		timer = due;
+		due = due->next;
+		curdevnode = (struct TizenDeviceNode *)((char *)timer -
+			offsetof(struct TizenDeviceNode, AdvrTimer));
+		if ((int)(now - curdevnode->device.AdvrDeadline) >= 0) {
 			/* This advertisement has expired, so we should remove the device
 			 * from the list */
-			if (GlobalDeviceList == curdevnode)
-				GlobalDeviceList = curdevnode->next;
-			else
-				prevdevnode->next = curdevnode->next;
+			TizenRegistry_Remove(curdevnode);
 			TizenCtrlPointDeleteNode(curdevnode);
-			if (prevdevnode)
-				curdevnode = prevdevnode->next;
-			else
-				curdevnode = GlobalDeviceList;
 		} else {
-			if (curdevnode->device.AdvrTimeOut < 2 * incr) {
-				/* This advertisement is about to expire, so
-				 * send out a search request for this device
-				 * UDN to try to renew */
-				ret = UpnpSearchAsync(ctrlpt_handle, incr,
-						      curdevnode->device.UDN,
-						      NULL);
-				if (ret != UPNP_E_SUCCESS)
-					SampleUtil_Print
-					    ("Error sending search request for Device UDN: %s -- err = %d\n",
-					     curdevnode->device.UDN, ret);
-			}
-			prevdevnode = curdevnode;
-			curdevnode = curdevnode->next;
+			/* This advertisement is about to expire, so
+			 * send out a search request for this device
+			 * UDN to try to renew (once the lock is
+			 * dropped, sending the M-SEARCH takes a
+			 * while), and wait for the real expiry */
+			if (renew)
+				renew[nrenew++] = strdup(curdevnode->device.UDN);
+			TizenWheel_Arm(&AdvrWheel, &curdevnode->AdvrTimer,
+				       curdevnode->device.AdvrDeadline);
 		}
 	}
 
 	ithread_mutex_unlock(&DeviceListMutex);
+
+	for (pos = 0; pos < nrenew; pos++) {
+		if (!renew[pos])
+			continue;
+		ret = UpnpSearchAsync(ctrlpt_handle, TIZEN_ADVR_RESEARCH_MX,
+				      renew[pos], NULL);
+		if (ret != UPNP_E_SUCCESS)
+			SampleUtil_Print
+			    ("Error sending search request for Device UDN: %s -- err = %d\n",
+			     renew[pos], ret);
+		free(renew[pos]);
+	}
+	free(renew);
 }
 
 /*!
  * \brief Function that runs in its own thread and monitors advertisement
  * and subscription timeouts for devices in the global device list.
+ *
+ * It wakes up on every CLOCK_MONOTONIC second boundary (absolute deadlines,
+ * so processing time does not accumulate as drift) and runs the timers that
+ * are due.
  */
-static int TizenCtrlPointTimerLoopRun = 1;
+static int TizenCtrlPointTimerLoopRun = 0;
+static ithread_t TizenCtrlPointTimerThread;
 void *TizenCtrlPointTimerLoop(void *args)
 {
-	/* how often to verify the timeouts, in seconds */
-	int incr = 30;
+	struct timespec wakeup;
 
+	wakeup.tv_sec = TizenTimer_Now();
+	wakeup.tv_nsec = 0;
 	while (TizenCtrlPointTimerLoopRun) {
-		isleep((unsigned int)incr);
-		TizenCtrlPointVerifyTimeouts(incr);
+		wakeup.tv_sec++;
+		while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME,
+				       &wakeup, NULL) == EINTR)
+			;
+		TizenCtrlPointVerifyTimeouts();
+		TizenCtrlPointRetrySubscriptions();
+		TizenCtrlPointFlushCache();
+		/* Release the nodes and tables retired since the last tick. */
+		TizenRcu_Reclaim();
+		TizenHttp_PoolExpire(0);
 	}
 
 	return NULL;
@@ -1253,8 +4268,9 @@ void *TizenCtrlPointTimerLoop(void *args)
  */
 int TizenCtrlPointStart(print_string printFunctionPtr, state_update updateFunctionPtr, int combo)
 {
-	ithread_t timer_thread;
+	ithread_t reaper_thread;
 	int rc;
+	int i;
 	/*
 	*/
 	
@@ -1265,6 +4281,26 @@ __init_retry :
 	SampleUtil_RegisterUpdateFunction(updateFunctionPtr);
 
 	ithread_mutex_init(&DeviceListMutex, 0);
+	ithread_mutex_init(&ReaperMutex, 0);
+	ithread_cond_init(&ReaperCond, NULL);
+	ithread_mutex_init(&SubscribeMutex, 0);
+	ithread_mutex_init(&GetVarMutex, 0);
+	for (i = 0; i < TIZEN_ACTION_BUCKETS; i++) {
+		ithread_mutex_init(&ActionBuckets[i].Mutex, 0);
+		ActionBuckets[i].Queues = NULL;
+	}
+	TizenPool_Init(&TizenNodePool, sizeof(struct TizenDeviceNode),
+		       TIZEN_NODE_POOL_SLAB);
+	TizenPool_Init(&TizenFreshPool, TIZEN_SERVICE_SERVCOUNT *
+		       sizeof(struct tizen_freshness), TIZEN_NODE_POOL_SLAB);
+	TizenStrings_Init();
+	TizenValue_Init();
+	TizenRcu_Init();
+	TizenRegistry_Init();
+	TizenWheel_Init(&AdvrWheel, TizenTimer_Now());
+	TizenWheel_Init(&SubscribeWheel, TizenTimer_Now());
+	/* Different devices, different renewal times */
+	srand(TizenTimer_NowMs());
 
 	SampleUtil_Print("Initializing UPnP Sdk with\n"
 			 "\tipaddress = %s port = %u\n",
@@ -1311,21 +4347,94 @@ __init_retry :
 
 	SampleUtil_Print("Control Point Registered\n");
 
-	TizenCtrlPointRefresh();
-
-	/* start a timer thread */
-	ithread_create(&timer_thread, NULL, TizenCtrlPointTimerLoop, NULL);
-	ithread_detach(timer_thread);
+	/* start the reaper thread before the first device can go away */
+	ReaperRun = 1;
+	ithread_create(&reaper_thread, NULL, TizenCtrlPointReaperLoop, NULL);
+	ithread_detach(reaper_thread);
+
+	if (TizenFetch_Start(TIZEN_FETCH_WORKERS, TIZEN_FETCH_QUEUE,
+			     TizenCtrlPointFetchDevice) != 0)
+		SampleUtil_Print("Error starting the fetch threads\n");
+	if (TizenSoap_Start(TIZEN_SOAP_WORKERS, TIZEN_SOAP_TIMEOUT) != 0)
+		SampleUtil_Print("Error starting the SOAP threads\n");
+
+	/* The devices we knew are usable right away, the search confirms
+	 * them and finds the new ones */
+	TizenCtrlPointStopping = 0;
+	TizenCtrlPointWarmStart();
+	TizenCtrlPointSearch();
+
+	/* start a timer thread, joined by TizenCtrlPointStop */
+	TizenCtrlPointTimerLoopRun = 1;
+	if (ithread_create(&TizenCtrlPointTimerThread, NULL,
+			   TizenCtrlPointTimerLoop, NULL) != 0) {
+		TizenCtrlPointTimerLoopRun = 0;
+		SampleUtil_Print("Error starting the timer thread\n");
+	}
 
 	return TIZEN_SUCCESS;
 }
 
 int TizenCtrlPointStop(void)
 {
-	TizenCtrlPointTimerLoopRun = 0;
+	struct tizen_coalesce_stats *coalesce;
+	struct tizen_subscription *subscription;
+	int bucket;
+
+	/* The timer thread works on everything released below: wait for its
+	 * current tick to end first */
+	if (TizenCtrlPointTimerLoopRun) {
+		TizenCtrlPointTimerLoopRun = 0;
+		ithread_join(TizenCtrlPointTimerThread, NULL);
+	}
+	TizenFetch_Stop();
+	/* Completes the coalesced actions too */
+	TizenSoap_Stop();
+	ithread_mutex_lock(&CoalesceMutex);
+	while (CoalesceStats) {
+		coalesce = CoalesceStats;
+		CoalesceStats = coalesce->Next;
+		free(coalesce);
+	}
+	ithread_mutex_unlock(&CoalesceMutex);
+	/* Keep the devices in the cache for the next start */
+	TizenCtrlPointStopping = 1;
+	/* The state of the last events, while the devices are registered */
+	TizenCtrlPointFlushCache();
 	TizenCtrlPointRemoveAll();
+	TizenCtrlPointStopReaper();
+	TizenCache_Close();
 	UpnpUnRegisterClient( ctrlpt_handle );
 	UpnpFinish();
+	/* No callback will complete them any more */
+	while (GetVarInFlight)
+		TizenCtrlPointEndGetVar(GetVarInFlight);
+	ithread_mutex_lock(&SubscriptionMutex);
+	while (Subscriptions) {
+		subscription = Subscriptions;
+		Subscriptions = subscription->Next;
+		TizenWheel_Cancel(&subscription->Timer);
+		free(subscription);
+	}
+	ithread_mutex_unlock(&SubscriptionMutex);
+	ithread_mutex_lock(&ParkMutex);
+	TizenCtrlPointFreeEvents(ParkedEvents);
+	ParkedEvents = NULL;
+	ParkedCount = 0;
+	ithread_mutex_unlock(&ParkMutex);
+	/* Queued too late, the record has the state of the flush above */
+	ithread_mutex_lock(&CacheDirtyMutex);
+	free(CacheDirty);
+	CacheDirty = NULL;
+	CacheDirtyCount = 0;
+	CacheDirtySize = 0;
+	ithread_mutex_unlock(&CacheDirtyMutex);
+	TizenCtrlPointFailActions();
+	for (bucket = 0; bucket < TIZEN_ACTION_BUCKETS; bucket++)
+		ithread_mutex_destroy(&ActionBuckets[bucket].Mutex);
+	TizenRcu_Reclaim();
+	TizenSoap_Finish();
+	TizenSchema_Finish();
 	SampleUtil_Finish();
 
 	return TIZEN_SUCCESS;
@@ -1339,6 +4448,7 @@ void TizenCtrlPointPrintShortHelp(void)
 		"  HelpFull\n"
 		"  ListDev\n"
 		"  Refresh\n"
+		"  PoolStats\n"
 		"  PrintDev      <devnum>\n"
 		"  PowerOn       <devnum>\n"
 		"  PowerOff      <devnum>\n"
@@ -1380,6 +4490,10 @@ void TizenCtrlPointPrintLongHelp(void)
 		"  Refresh\n"
 		"       Delete all of the devices from the device list and issue new\n"
 		"         search request to rebuild the list from scratch.\n"
+		"  PoolStats\n"
+		"       Print how many device nodes are live and free in the node\n"
+		"         pool, and the most that were ever live at once, and how\n"
+		"         busy the description fetch queue and cache have been.\n"
 		"  PrintDev       <devnum>\n"
 		"       Print the state table for the device <devnum>.\n"
 		"         e.g., 'PrintDev 1' prints the state table for the first\n"
@@ -1460,6 +4574,7 @@ enum cmdloop_tizencmds {
 	PRTDEV,
 	LSTDEV,
 	REFRESH,
+	POOLSTATS,
 	EXITCMD
 };
 
@@ -1483,6 +4598,7 @@ static struct cmdloop_commands cmdloop_cmdlist[] = {
 	{"HelpFull",      PRTFULLHELP, 1, ""},
 	{"ListDev",       LSTDEV,      1, ""},
 	{"Refresh",       REFRESH,     1, ""},
+	{"PoolStats",     POOLSTATS,   1, ""},
 	{"PrintDev",      PRTDEV,      2, "<devnum>"},
 	{"PowerOn",       POWON,       2, "<devnum>"},
 	{"PowerOff",      POWOFF,      2, "<devnum>"},
@@ -1518,8 +4634,12 @@ void *TizenCtrlPointCommandLoop(void *args)
 	char cmdline[100];
 	char str_fullpath[256] = {'\0'};
 	char *filename;
-	int devnum = 0;
-	struct TizenDeviceNode *tmpdevnode = NULL;
+	struct tizen_mcast_result result;
+	TizenDeviceHandle *handles;
+	const char *param_name = "Text";
+	char *param_val;
+	int devcount;
+	int i;
 	
 	int filereadlength=0;
 	char str_url[256] = {'\0'}; 
@@ -1550,12 +4670,28 @@ void *TizenCtrlPointCommandLoop(void *args)
 		sprintf(str_url2, "http://%s:%d/%s", ip_address, port, filename);
 		printf("[OCS] filename : %s\n", str_url2);
 
-		devnum = 1;
-		tmpdevnode = GlobalDeviceList;
-		while(tmpdevnode) {
-			TizenCtrlPointSendActionTextArg(devnum++, TIZEN_SERVICE_PICTURE, "SendText", "Text", str_url2);
-			tmpdevnode = tmpdevnode->next;
+		/* Every device at once: the round lasts as long as the
+		 * slowest device, not as long as all of them together. */
+		param_val = str_url2;
+		if (TizenCtrlPointMulticastAction(TIZEN_SERVICE_PICTURE,
+		    "SendText", &param_name, &param_val, 1, NULL, 0, NULL,
+		    NULL, 0, &result) == TIZEN_SUCCESS) {
+			printf("[OCS] sent to %d/%d devices in %u ms (slowest %u ms)\n",
+			       result.Succeeded, result.Count, result.Elapsed,
+			       result.MaxLatency);
+			free(result.Status);
+			goto __next_period;
+		}
+
+		/* No SCPD yet, one at a time. One snapshot for the whole
+		 * round: resolving devnums one by one would skip or repeat
+		 * devices that come and go meanwhile. */
+		devcount = TizenCtrlPointGetHandles(&handles);
+		for (i = 0; i < devcount; i++) {
+			TizenCtrlPointSendActionByHandle(TIZEN_SERVICE_PICTURE,
+				handles[i], "SendText", &param_name, &param_val, 1);
 		}
+		free(handles);
 
 __next_period :
 		sleep(1);
@@ -1687,6 +4823,9 @@ int TizenCtrlPointProcessCommand(char *cmdline)
 	case REFRESH:
 		TizenCtrlPointRefresh();
 		break;
+	case POOLSTATS:
+		TizenCtrlPointPrintPoolStats();
+		break;
 	case EXITCMD:
 		rc = TizenCtrlPointStop();
 		exit(rc);
@@ -49,6 +49,12 @@ extern "C" {
 #endif
 
 #include "sample_util.h"
+#include "tizen_registry.h"
+#include "tizen_pool.h"
+#include "tizen_soap.h"
+#include "tizen_strings.h"
+#include "tizen_timer.h"
+#include "tizen_value.h"
 
 #include "upnp.h"
 #include "UpnpString.h"
@@ -62,59 +68,212 @@ extern "C" {
 #define TIZEN_SERVICE_CONTROL	0
 #define TIZEN_SERVICE_PICTURE	1
 
-#define TIZEN_CONTROL_VARCOUNT	3
-#define TIZEN_CONTROL_POWER	0
-#define TIZEN_CONTROL_CHANNEL	1
-#define TIZEN_CONTROL_VOLUME	2
-
-#define TIZEN_PICTURE_VARCOUNT	5
-#define TIZEN_PICTURE_COLOR	0
-#define TIZEN_PICTURE_TINT		1
-#define TIZEN_PICTURE_CONTRAST	2
-#define TIZEN_PICTURE_BRIGHTNESS	3
-
-#define TIZEN_MAX_VAL_LEN		5
-
 #define TIZEN_SUCCESS		0
 #define TIZEN_ERROR		(-1)
 #define TIZEN_WARNING		1
 
-/* This should be the maximum VARCOUNT from above */
-#define TIZEN_MAXVARS		TIZEN_PICTURE_VARCOUNT
+/*
+ * State variables tracked per service. The variables of a service and their
+ * indexes come from its SCPD (see tizen_schema.h); an SCPD that declares
+ * more is rejected.
+ */
+#define TIZEN_MAXVARS		5
 
 extern const char *TizenServiceName[];
-extern const char *TizenVarName[TIZEN_SERVICE_SERVCOUNT][TIZEN_MAXVARS];
-extern char TizenVarCount[];
 
+/*
+ * When and where from the values of a service were last confirmed by the
+ * device. Kept beside the node, from TizenFreshPool, so that the node stays
+ * within eight cache lines.
+ */
+struct tizen_freshness {
+    /* Where each value of State comes from, TIZEN_SOURCE_* */
+    unsigned char Source[TIZEN_MAXVARS];
+    /* TizenTimer_Now() tick at which each value was last confirmed by
+     * the device */
+    unsigned int Updated[TIZEN_MAXVARS];
+};
+
+/*
+ * The string fields below are never NULL. ServiceId and ServiceType are
+ * interned (TizenIntern_Get), the other strings live in the arena of the
+ * device node. All of them are immutable while the node is alive.
+ */
 struct tizen_service {
-    char ServiceId[NAME_SIZE];
-    char ServiceType[NAME_SIZE];
-    char *VariableStrVal[TIZEN_MAXVARS];
-    char EventURL[NAME_SIZE];
-    char ControlURL[NAME_SIZE];
-    char SID[NAME_SIZE];
+    /* "" while not subscribed */
+    Upnp_SID SID;
+    /* Freshness of State, allocated with the node */
+    struct tizen_freshness *Fresh;
+    const char *ServiceId;
+    const char *ServiceType;
+    const char *EventURL;
+    const char *ControlURL;
+    /* Indexed like the variables of the schema of ServiceType */
+    struct tizen_value State[TIZEN_MAXVARS];
 };
 
-extern struct TizenDeviceNode *GlobalDeviceList;
+/* Origin of a state value */
+#define TIZEN_SOURCE_NONE	0	/* SCPD default or device cache */
+#define TIZEN_SOURCE_EVENT	1	/* GENA event */
+#define TIZEN_SOURCE_QUERY	2	/* QueryStateVariable answer */
+
+/* Longest text returned by TizenCtrlPointReadVar */
+#define TIZEN_VAR_READ_LEN	256
+
+/* A state variable as known locally, see TizenCtrlPointReadVar */
+struct tizen_var_reading {
+    /* TIZEN_TYPE_* the value parsed as, and its number if numeric */
+    int Type;
+    long long Num;
+    /* Seconds since the device last confirmed the value, -1 if never */
+    int Age;
+    /* TIZEN_SOURCE_* */
+    int Source;
+    /* The text, truncated to TIZEN_VAR_READ_LEN - 1 bytes */
+    char Text[TIZEN_VAR_READ_LEN];
+};
 
 struct TizenDevice {
-    char UDN[250];
-    char DescDocURL[250];
-    char FriendlyName[250];
-    char PresURL[250];
-    int  AdvrTimeOut;
+    /* TizenTimer_Now() tick at which the advertisement expires */
+    unsigned int AdvrDeadline;
+    const char *UDN;
+    const char *DescDocURL;
+    const char *FriendlyName;
+    const char *PresURL;
     struct tizen_service TizenService[TIZEN_SERVICE_SERVCOUNT];
 };
 
+/*
+ * Description of a device, as parsed from its description document or read
+ * back from the device cache. Only borrowed pointers.
+ */
+struct tizen_device_info {
+    const char *UDN;
+    const char *DescDocURL;
+    const char *FriendlyName;
+    const char *PresURL;
+    const char *ServiceId[TIZEN_SERVICE_SERVCOUNT];
+    const char *EventURL[TIZEN_SERVICE_SERVCOUNT];
+    const char *ControlURL[TIZEN_SERVICE_SERVCOUNT];
+    /* Absolute SCPD URLs, NULL when read back from the device cache */
+    const char *SCPDURL[TIZEN_SERVICE_SERVCOUNT];
+};
+
+/*
+ * The fields the lookups and the expiry timer touch (UDNHash, OrderIndex,
+ * Handle, AdvrTimer, AdvrDeadline) come first so that they share a cache
+ * line.
+ */
 struct TizenDeviceNode {
+    /* TizenHash_String(device.UDN), cached for the registry */
+    unsigned int UDNHash;
+    /* Position in the registry insertion order, -1 while not registered */
+    int OrderIndex;
+    /* Stable handle, valid while the node is registered. Stays set after
+     * removal, TIZEN_INVALID_HANDLE if the node was never registered */
+    TizenDeviceHandle Handle;
+    /* Fires for the pre-expiry re-search, then for the expiry itself.
+     * Protected by DeviceListMutex */
+    struct tizen_timer AdvrTimer;
     struct TizenDevice device;
-    struct TizenDeviceNode *next;
+    /* Slot in the device cache (TizenCache_Store), TIZEN_CACHE_NONE while
+     * not cached. Protected by StateMutex */
+    int CacheSlot;
+    /* AdvrDeadline as last written to the cache. Protected by StateMutex */
+    unsigned int CacheDeadline;
+    /* Changes not written to the cache yet (TIZEN_CACHE_DIRTY_* bits), set
+     * and cleared atomically */
+    int CacheDirty;
+    /* Link in the reaper queue once the node has been removed */
+    struct TizenDeviceNode *ReapNext;
+    /* Backing store of the per-device strings */
+    struct tizen_arena Arena;
+    /* Protects the mutable service state (SIDs and State) */
+    ithread_mutex_t StateMutex;
 };
 
+/*
+ * Selects the devices of a multicast action. Runs inside an RCU read
+ * section: it must not block. Returns non-zero to include the device.
+ */
+typedef int (*TizenDeviceFilter)(const struct TizenDeviceNode *, void *);
+
+/* Outcome of a multicast action on one device */
+struct tizen_mcast_status {
+    TizenDeviceHandle Handle;
+    /* 0 on success, the UPnP error code of a SOAP fault, or
+     * TIZEN_SOAP_TRANSPORT_ERROR if the request failed or was not sent */
+    int ErrCode;
+    /* Milliseconds from the dispatch of the request to its completion */
+    unsigned int Latency;
+};
+
+/* Aggregate outcome of a multicast action, see
+ * TizenCtrlPointMulticastAction */
+struct tizen_mcast_result {
+    /* Devices selected, entries of Status */
+    int Count;
+    /* Devices whose ErrCode is 0 */
+    int Succeeded;
+    /* Milliseconds the whole multicast took, and the slowest device */
+    unsigned int Elapsed;
+    unsigned int MaxLatency;
+    /* Per device outcome in dispatch order, to be freed by the caller */
+    struct tizen_mcast_status *Status;
+};
+
+/* Outstanding requests of a multicast action when no window is given */
+#define TIZEN_MCAST_WINDOW	8
+
+/* An action submitted with TizenCtrlPointSubmitAction, opaque */
+struct tizen_action;
+
+/* Outcome of a submitted action */
+struct tizen_action_result {
+    /* 0 on success, the UPnP error code of a SOAP fault, or
+     * TIZEN_SOAP_TRANSPORT_ERROR if the request failed or was not sent */
+    int ErrCode;
+    /* Milliseconds from the dispatch of the request to its completion */
+    unsigned int Latency;
+    /* Milliseconds the action waited behind the earlier ones of its device */
+    unsigned int Queued;
+    /* The body of the response, NULL if there is none. Valid until the
+     * action is released */
+    const char *Response;
+};
+
+/*
+ * Called once a submitted action completes, on the thread that completed
+ * it and before its waiters wake up. May submit further actions, but must
+ * not wait for one.
+ */
+typedef void (*TizenActionCallback)(struct tizen_action *,
+    const struct tizen_action_result *, void *);
+
+/* Requests of one device on the wire at once when no window is set */
+#define TIZEN_ACTION_WINDOW	1
+
 extern ithread_mutex_t DeviceListMutex;
 
+/*! Pool of device nodes. */
+extern struct tizen_pool TizenNodePool;
+
+/*! Pool of the freshness tables of the device nodes, one per node for all
+ * of its services. */
+extern struct tizen_pool TizenFreshPool;
+
 extern UpnpClient_Handle ctrlpt_handle;
 
+/*! Path of the persistent device cache. */
+extern const char *TizenCacheFile;
+
+/*! Seconds during which an evented value answers GetVar locally. */
+extern int TizenCtrlPointVarTTL;
+
+/*! Requests of one device on the wire at once. 1 keeps the submitted
+ * actions of a device strictly ordered. */
+extern int TizenCtrlPointActionWindow;
+
 void	TizenCtrlPointPrintHelp(void);
 int		TizenCtrlPointDeleteNode(struct TizenDeviceNode *);
 int		TizenCtrlPointRemoveDevice(const char *);
@@ -122,6 +281,11 @@ int		TizenCtrlPointRemoveAll(void);
 int		TizenCtrlPointRefresh(void);
 
 int		TizenCtrlPointSendAction(int, int, const char *, const char **, char **, int);
+int		TizenCtrlPointSendActionByHandle(int, TizenDeviceHandle, const char *, const char **, char **, int);
+int		TizenCtrlPointMulticastAction(int, const char *, const char **, char **, int, const TizenDeviceHandle *, int, TizenDeviceFilter, void *, int, struct tizen_mcast_result *);
+struct tizen_action *TizenCtrlPointSubmitAction(int, TizenDeviceHandle, const char *, const char **, char **, int, TizenActionCallback, void *);
+int		TizenCtrlPointWaitAction(struct tizen_action *, int, struct tizen_action_result *);
+void	TizenCtrlPointReleaseAction(struct tizen_action *);
 int		TizenCtrlPointSendActionNumericArg(int devnum, int service, const char *actionName, const char *paramName, int paramValue);
 int		TizenCtrlPointSendPowerOn(int devnum);
 int		TizenCtrlPointSendPowerOff(int devnum);
@@ -133,6 +297,8 @@ int		TizenCtrlPointSendSetContrast(int, int);
 int		TizenCtrlPointSendSetBrightness(int, int);
 
 int		TizenCtrlPointGetVar(int, int, const char *);
+int		TizenCtrlPointGetVarByHandle(int, TizenDeviceHandle, const char *);
+int		TizenCtrlPointReadVar(int, TizenDeviceHandle, const char *, struct tizen_var_reading *);
 int		TizenCtrlPointGetPower(int devnum);
 int		TizenCtrlPointGetChannel(int);
 int		TizenCtrlPointGetVolume(int);
@@ -142,7 +308,11 @@ int		TizenCtrlPointGetContrast(int);
 int		TizenCtrlPointGetBrightness(int);
 
 int		TizenCtrlPointGetDevice(int, struct TizenDeviceNode **);
+int		TizenCtrlPointGetDeviceByHandle(TizenDeviceHandle, struct TizenDeviceNode **);
+int		TizenCtrlPointGetHandle(int, TizenDeviceHandle *);
+int		TizenCtrlPointGetHandles(TizenDeviceHandle **);
 int		TizenCtrlPointPrintList(void);
+int		TizenCtrlPointPrintPoolStats(void);
 int		TizenCtrlPointPrintDevice(int);
 void	TizenCtrlPointAddDevice(IXML_Document *, const char *, int); 
 void    TizenCtrlPointHandleGetVar(const char *, const char *, const DOMString);
@@ -151,34 +321,33 @@ void    TizenCtrlPointHandleGetVar(const char *, const char *, const DOMString);
  * \brief Update a Tizen state table. Called when an event is received.
  *
  * Note: this function is NOT thread save. It must be called from another
- * function that has locked the global device list.
+ * function that has locked the StateMutex of the device.
  **/
 void TizenStateUpdate(
 	/*! [in] The UDN of the parent device. */
-	char *UDN,
+	const char *UDN,
 	/*! [in] The service state table to update. */
 	int Service,
 	/*! [out] DOM document representing the XML received with the event. */
 	IXML_Document *ChangedVariables,
-	/*! [out] pointer to the state table for the Tizen  service to update. */
-	char **State);
+	/*! [out] The Tizen service whose state table is updated. */
+	struct tizen_service *Svc);
 
 void	TizenCtrlPointHandleEvent(const char *, int, IXML_Document *); 
 void	TizenCtrlPointHandleSubscribeUpdate(const char *, const Upnp_SID, int); 
 int		TizenCtrlPointCallbackEventHandler(Upnp_EventType, void *, void *);
 
 /*!
- * \brief Checks the advertisement each device in the global device list.
+ * \brief Processes the advertisement timers that are due.
  *
  * If an advertisement expires, the device is removed from the list.
  *
  * If an advertisement is about to expire, a search request is sent for that
  * device.
+ *
+ * Only the devices whose timer is due are touched.
  */
-void TizenCtrlPointVerifyTimeouts(
-	/*! [in] The increment to subtract from the timeouts each time the
-	 * function is called. */
-	int incr);
+void TizenCtrlPointVerifyTimeouts(void);
 
 void	TizenCtrlPointPrintCommands(void);
 void*	TizenCtrlPointCommandLoop(void *);
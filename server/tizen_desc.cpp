@@ -0,0 +1,265 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Description Cache
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_desc.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! Number of hash chains, a power of two. */
+#define TIZEN_DESC_BUCKETS	1024
+
+/*! Protects everything below and the private fields of the entries. */
+static ithread_mutex_t TizenDescMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tizen_desc *TizenDescBuckets[TIZEN_DESC_BUCKETS];
+/*! Least and most recently used entries. */
+static struct tizen_desc *TizenDescOldest = NULL;
+static struct tizen_desc *TizenDescNewest = NULL;
+static struct tizen_desc_stats TizenDescStats;
+
+/********************************************************************************
+ * TizenDesc_Copy
+ *
+ * Description:
+ *       Copies a string to *pos and advances it. NULL is copied as "".
+ *
+ ********************************************************************************/
+static const char *TizenDesc_Copy(char **pos, const char *str)
+{
+	size_t len = str ? strlen(str) + 1 : 1;
+	char *copy = *pos;
+
+	memcpy(copy, str ? str : "", len);
+	*pos += len;
+
+	return copy;
+}
+
+static size_t TizenDesc_Size(const char *str)
+{
+	return str ? strlen(str) + 1 : 1;
+}
+
+struct tizen_desc *TizenDesc_New(const struct tizen_device_info *info,
+	int match, const char *etag, const char *lastmodified)
+{
+	struct tizen_desc *desc;
+	size_t size;
+	char *pos;
+	int service;
+
+	size = sizeof(*desc) + TizenDesc_Size(etag) +
+		TizenDesc_Size(lastmodified) + TizenDesc_Size(info->UDN) +
+		TizenDesc_Size(info->DescDocURL) +
+		TizenDesc_Size(info->FriendlyName) +
+		TizenDesc_Size(info->PresURL);
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++)
+		size += TizenDesc_Size(info->ServiceId[service]) +
+			TizenDesc_Size(info->EventURL[service]) +
+			TizenDesc_Size(info->ControlURL[service]) +
+			TizenDesc_Size(info->SCPDURL[service]);
+
+	/* One block: the strings follow the structure */
+	desc = (struct tizen_desc *)calloc(1, size);
+	if (!desc)
+		return NULL;
+	pos = (char *)(desc + 1);
+	desc->Match = match;
+	desc->ETag = TizenDesc_Copy(&pos, etag);
+	desc->LastModified = TizenDesc_Copy(&pos, lastmodified);
+	desc->info.UDN = TizenDesc_Copy(&pos, info->UDN);
+	desc->info.DescDocURL = TizenDesc_Copy(&pos, info->DescDocURL);
+	desc->info.FriendlyName = TizenDesc_Copy(&pos, info->FriendlyName);
+	desc->info.PresURL = TizenDesc_Copy(&pos, info->PresURL);
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		desc->info.ServiceId[service] =
+		    TizenDesc_Copy(&pos, info->ServiceId[service]);
+		desc->info.EventURL[service] =
+		    TizenDesc_Copy(&pos, info->EventURL[service]);
+		desc->info.ControlURL[service] =
+		    TizenDesc_Copy(&pos, info->ControlURL[service]);
+		desc->info.SCPDURL[service] =
+		    TizenDesc_Copy(&pos, info->SCPDURL[service]);
+	}
+	desc->hash = TizenHash_String(desc->info.DescDocURL);
+	desc->refs = 1;
+
+	return desc;
+}
+
+void TizenDesc_Put(struct tizen_desc *desc)
+{
+	if (desc && __atomic_sub_fetch(&desc->refs, 1, __ATOMIC_ACQ_REL) == 0)
+		free(desc);
+}
+
+/********************************************************************************
+ * TizenDesc_Unlink
+ *
+ * Description:
+ *       Takes an entry out of its chain and of the LRU list. Called with
+ *       TizenDescMutex held. The cache reference is not dropped.
+ *
+ ********************************************************************************/
+static void TizenDesc_Unlink(struct tizen_desc *desc)
+{
+	struct tizen_desc **link;
+
+	link = &TizenDescBuckets[desc->hash & (TIZEN_DESC_BUCKETS - 1)];
+	while (*link != desc)
+		link = &(*link)->next;
+	*link = desc->next;
+	if (desc->older)
+		desc->older->newer = desc->newer;
+	else
+		TizenDescOldest = desc->newer;
+	if (desc->newer)
+		desc->newer->older = desc->older;
+	else
+		TizenDescNewest = desc->older;
+	TizenDescStats.entries--;
+}
+
+/********************************************************************************
+ * TizenDesc_Touch
+ *
+ * Description:
+ *       Moves an entry to the most recently used end of the LRU list.
+ *       Called with TizenDescMutex held.
+ *
+ ********************************************************************************/
+static void TizenDesc_Touch(struct tizen_desc *desc)
+{
+	if (desc == TizenDescNewest)
+		return;
+	if (desc->older)
+		desc->older->newer = desc->newer;
+	else
+		TizenDescOldest = desc->newer;
+	desc->newer->older = desc->older;
+	desc->older = TizenDescNewest;
+	desc->newer = NULL;
+	TizenDescNewest->newer = desc;
+	TizenDescNewest = desc;
+}
+
+/********************************************************************************
+ * TizenDesc_Lookup
+ *
+ * Description:
+ *       Finds the entry of a Location. Called with TizenDescMutex held.
+ *
+ ********************************************************************************/
+static struct tizen_desc *TizenDesc_Lookup(const char *location,
+	unsigned int hash)
+{
+	struct tizen_desc *desc;
+
+	for (desc = TizenDescBuckets[hash & (TIZEN_DESC_BUCKETS - 1)]; desc;
+	     desc = desc->next)
+		if (desc->hash == hash &&
+		    strcmp(desc->info.DescDocURL, location) == 0)
+			return desc;
+
+	return NULL;
+}
+
+struct tizen_desc *TizenDesc_Find(const char *location)
+{
+	unsigned int hash = TizenHash_String(location);
+	struct tizen_desc *desc;
+
+	ithread_mutex_lock(&TizenDescMutex);
+	desc = TizenDesc_Lookup(location, hash);
+	if (desc) {
+		TizenDesc_Touch(desc);
+		__atomic_add_fetch(&desc->refs, 1, __ATOMIC_RELAXED);
+		TizenDescStats.hits++;
+	}
+	ithread_mutex_unlock(&TizenDescMutex);
+
+	return desc;
+}
+
+void TizenDesc_Store(struct tizen_desc *desc)
+{
+	struct tizen_desc *old, *evicted = NULL;
+	struct tizen_desc **bucket;
+
+	__atomic_add_fetch(&desc->refs, 1, __ATOMIC_RELAXED);
+	ithread_mutex_lock(&TizenDescMutex);
+	old = TizenDesc_Lookup(desc->info.DescDocURL, desc->hash);
+	if (old)
+		TizenDesc_Unlink(old);
+	bucket = &TizenDescBuckets[desc->hash & (TIZEN_DESC_BUCKETS - 1)];
+	desc->next = *bucket;
+	*bucket = desc;
+	desc->older = TizenDescNewest;
+	desc->newer = NULL;
+	if (TizenDescNewest)
+		TizenDescNewest->newer = desc;
+	else
+		TizenDescOldest = desc;
+	TizenDescNewest = desc;
+	TizenDescStats.entries++;
+	TizenDescStats.stores++;
+	if (TizenDescStats.entries > TIZEN_DESC_MAX_ENTRIES) {
+		evicted = TizenDescOldest;
+		TizenDesc_Unlink(evicted);
+		TizenDescStats.evictions++;
+	}
+	ithread_mutex_unlock(&TizenDescMutex);
+	TizenDesc_Put(old);
+	TizenDesc_Put(evicted);
+}
+
+void TizenDesc_Remove(const char *location)
+{
+	unsigned int hash = TizenHash_String(location);
+	struct tizen_desc *desc;
+
+	ithread_mutex_lock(&TizenDescMutex);
+	desc = TizenDesc_Lookup(location, hash);
+	if (desc)
+		TizenDesc_Unlink(desc);
+	ithread_mutex_unlock(&TizenDescMutex);
+	TizenDesc_Put(desc);
+}
+
+void TizenDesc_GetStats(struct tizen_desc_stats *stats)
+{
+	ithread_mutex_lock(&TizenDescMutex);
+	*stats = TizenDescStats;
+	ithread_mutex_unlock(&TizenDescMutex);
+}
+
+/*! @} Description Cache */
+
+/*! @} UpnpSamples */
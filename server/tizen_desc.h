@@ -0,0 +1,146 @@
+#ifndef UPNP_TIZEN_DESC_H
+#define UPNP_TIZEN_DESC_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Description Cache
+ *
+ * Parsed device descriptions, keyed by Location URL, with the validators
+ * (ETag, Last-Modified) of the response they came from. A description that
+ * has to be fetched again is requested conditionally, and a 304 answer
+ * reuses the parsed copy instead of downloading and parsing the XML.
+ *
+ * Descriptions are immutable and reference counted: a lookup returns a
+ * reference that stays valid after the entry is replaced or evicted.
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_ctrl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Most descriptions kept; the oldest entry is evicted past it. */
+#define TIZEN_DESC_MAX_ENTRIES	4096
+
+/*! A parsed description. */
+struct tizen_desc {
+	/*! Non-zero if the description is of a device we control. Other
+	 * devices are cached too, so that they are not parsed again. */
+	int Match;
+	/*! Validators of the response, "" if absent. */
+	const char *ETag;
+	const char *LastModified;
+	/*! The device. info.DescDocURL is the Location. */
+	struct tizen_device_info info;
+
+	/* Private */
+	int refs;
+	unsigned int hash;
+	struct tizen_desc *next;
+	struct tizen_desc *older;
+	struct tizen_desc *newer;
+};
+
+/*! Cache statistics, see TizenDesc_GetStats(). */
+struct tizen_desc_stats {
+	/*! Descriptions cached right now. */
+	unsigned int entries;
+	/*! Lookups that found a description. */
+	unsigned int hits;
+	/*! Descriptions stored. */
+	unsigned int stores;
+	/*! Descriptions evicted to stay under TIZEN_DESC_MAX_ENTRIES. */
+	unsigned int evictions;
+};
+
+/*!
+ * \brief Builds a description. Every string is copied; NULL strings are
+ * stored as "".
+ *
+ * \return The description holding one reference, or NULL if out of memory.
+ */
+struct tizen_desc *TizenDesc_New(
+	/*! [in] The device. */
+	const struct tizen_device_info *info,
+	/*! [in] See tizen_desc.Match. */
+	int match,
+	/*! [in] ETag of the response, or NULL. */
+	const char *etag,
+	/*! [in] Last-Modified of the response, or NULL. */
+	const char *lastmodified);
+
+/*!
+ * \brief Drops a reference to a description.
+ */
+void TizenDesc_Put(
+	/*! [in] The description, may be NULL. */
+	struct tizen_desc *desc);
+
+/*!
+ * \brief Looks up the description of a Location.
+ *
+ * \return A new reference to the description, or NULL.
+ */
+struct tizen_desc *TizenDesc_Find(
+	/*! [in] The Location URL. */
+	const char *location);
+
+/*!
+ * \brief Caches a description under its Location (info.DescDocURL),
+ * replacing any previous one. The cache takes its own reference.
+ */
+void TizenDesc_Store(
+	/*! [in] The description. */
+	struct tizen_desc *desc);
+
+/*!
+ * \brief Forgets the description of a Location, if any.
+ */
+void TizenDesc_Remove(
+	/*! [in] The Location URL. */
+	const char *location);
+
+/*!
+ * \brief Returns a snapshot of the cache statistics.
+ */
+void TizenDesc_GetStats(
+	/*! [out] The statistics. */
+	struct tizen_desc_stats *stats);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Description Cache */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_DESC_H */
@@ -0,0 +1,253 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Fetch Pipeline
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_fetch.h"
+#include "tizen_registry.h"
+
+#include "ithread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! Upper bound on the number of fetch threads. */
+#define TIZEN_FETCH_MAX_WORKERS	16
+
+/*! One queued (or running) fetch. */
+struct tizen_fetch_job {
+	struct tizen_fetch_job *next;
+	/*! TizenHash_String(location). */
+	unsigned int hash;
+	int expires;
+	char *location;
+};
+
+/*! Protects everything below. */
+static ithread_mutex_t TizenFetchMutex = PTHREAD_MUTEX_INITIALIZER;
+static ithread_cond_t TizenFetchCond = PTHREAD_COND_INITIALIZER;
+static struct tizen_fetch_job *TizenFetchHead = NULL;
+static struct tizen_fetch_job *TizenFetchTail = NULL;
+/*! The job each fetch thread is running, NULL if idle. */
+static struct tizen_fetch_job *TizenFetchRunning[TIZEN_FETCH_MAX_WORKERS];
+static ithread_t TizenFetchThreads[TIZEN_FETCH_MAX_WORKERS];
+static int TizenFetchWorkers = 0;
+static int TizenFetchQueueMax = 0;
+static int TizenFetchRun = 0;
+static tizen_fetch_handler TizenFetchHandler = NULL;
+static struct tizen_fetch_stats TizenFetchStats;
+
+static void TizenFetch_FreeJob(struct tizen_fetch_job *job)
+{
+	free(job->location);
+	free(job);
+}
+
+/********************************************************************************
+ * TizenFetch_FindJob
+ *
+ * Description:
+ *       Looks for a queued or running fetch of a Location. Called with
+ *       TizenFetchMutex held. The queue is bounded, a scan is cheap.
+ *
+ ********************************************************************************/
+static struct tizen_fetch_job *TizenFetch_FindJob(const char *location,
+	unsigned int hash)
+{
+	struct tizen_fetch_job *job;
+	int i;
+
+	for (job = TizenFetchHead; job; job = job->next)
+		if (job->hash == hash && strcmp(job->location, location) == 0)
+			return job;
+	for (i = 0; i < TizenFetchWorkers; i++) {
+		job = TizenFetchRunning[i];
+		if (job && job->hash == hash &&
+		    strcmp(job->location, location) == 0)
+			return job;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \brief Fetch thread: runs the handler for the queued Locations, in order.
+ */
+static void *TizenFetch_Loop(void *args)
+{
+	int worker = (int)(long)args;
+	struct tizen_fetch_job *job;
+
+	ithread_mutex_lock(&TizenFetchMutex);
+	for (;;) {
+		while (!TizenFetchHead && TizenFetchRun)
+			ithread_cond_wait(&TizenFetchCond, &TizenFetchMutex);
+		if (!TizenFetchRun)
+			break;
+		job = TizenFetchHead;
+		TizenFetchHead = job->next;
+		if (!TizenFetchHead)
+			TizenFetchTail = NULL;
+		TizenFetchStats.pending--;
+		/* Stays visible to TizenFetch_FindJob while running */
+		TizenFetchRunning[worker] = job;
+		ithread_mutex_unlock(&TizenFetchMutex);
+
+		TizenFetchHandler(job->location, job->expires);
+
+		ithread_mutex_lock(&TizenFetchMutex);
+		TizenFetchRunning[worker] = NULL;
+		TizenFetchStats.fetched++;
+		TizenFetch_FreeJob(job);
+	}
+	ithread_mutex_unlock(&TizenFetchMutex);
+
+	return NULL;
+}
+
+int TizenFetch_Start(int workers, int queuemax, tizen_fetch_handler handler)
+{
+	int i;
+
+	if (workers < 1)
+		workers = 1;
+	if (workers > TIZEN_FETCH_MAX_WORKERS)
+		workers = TIZEN_FETCH_MAX_WORKERS;
+	ithread_mutex_lock(&TizenFetchMutex);
+	memset(&TizenFetchStats, 0, sizeof(TizenFetchStats));
+	memset(TizenFetchRunning, 0, sizeof(TizenFetchRunning));
+	TizenFetchHandler = handler;
+	TizenFetchQueueMax = queuemax > 0 ? queuemax : 1;
+	TizenFetchWorkers = 0;
+	TizenFetchRun = 1;
+	for (i = 0; i < workers; i++) {
+		if (ithread_create(&TizenFetchThreads[i], NULL,
+				   TizenFetch_Loop, (void *)(long)i) != 0)
+			break;
+		TizenFetchWorkers++;
+	}
+	if (!TizenFetchWorkers)
+		TizenFetchRun = 0;
+	ithread_mutex_unlock(&TizenFetchMutex);
+
+	return TizenFetchWorkers ? 0 : -1;
+}
+
+void TizenFetch_Stop(void)
+{
+	struct tizen_fetch_job *job;
+	int workers, i;
+
+	ithread_mutex_lock(&TizenFetchMutex);
+	TizenFetchRun = 0;
+	while (TizenFetchHead) {
+		job = TizenFetchHead;
+		TizenFetchHead = job->next;
+		TizenFetch_FreeJob(job);
+	}
+	TizenFetchTail = NULL;
+	TizenFetchStats.pending = 0;
+	workers = TizenFetchWorkers;
+	TizenFetchWorkers = 0;
+	ithread_cond_broadcast(&TizenFetchCond);
+	ithread_mutex_unlock(&TizenFetchMutex);
+
+	for (i = 0; i < workers; i++)
+		ithread_join(TizenFetchThreads[i], NULL);
+}
+
+int TizenFetch_Submit(const char *location, int expires, int redundant)
+{
+	struct tizen_fetch_job *job;
+	unsigned int hash;
+	unsigned int limit;
+	int ret = TIZEN_FETCH_DROPPED;
+
+	if (!location || !*location)
+		return TIZEN_FETCH_DROPPED;
+	hash = TizenHash_String(location);
+
+	ithread_mutex_lock(&TizenFetchMutex);
+	if (!TizenFetchRun)
+		goto __finish_submit;
+	job = TizenFetch_FindJob(location, hash);
+	if (job) {
+		/* Same description: one download serves every announcement */
+		if (expires > job->expires)
+			job->expires = expires;
+		TizenFetchStats.merged++;
+		ret = TIZEN_FETCH_MERGED;
+		goto __finish_submit;
+	}
+	/* Past the high-water mark only announcements that will not be
+	 * repeated get in */
+	limit = (unsigned int)TizenFetchQueueMax;
+	if (redundant)
+		limit = (limit + 1) / 2;
+	if (TizenFetchStats.pending >= limit) {
+		TizenFetchStats.dropped++;
+		goto __finish_submit;
+	}
+	job = (struct tizen_fetch_job *)malloc(sizeof(*job));
+	if (!job)
+		goto __finish_submit;
+	job->location = strdup(location);
+	if (!job->location) {
+		free(job);
+		goto __finish_submit;
+	}
+	job->next = NULL;
+	job->hash = hash;
+	job->expires = expires;
+	if (TizenFetchTail)
+		TizenFetchTail->next = job;
+	else
+		TizenFetchHead = job;
+	TizenFetchTail = job;
+	TizenFetchStats.queued++;
+	if (++TizenFetchStats.pending > TizenFetchStats.highwater)
+		TizenFetchStats.highwater = TizenFetchStats.pending;
+	ithread_cond_signal(&TizenFetchCond);
+	ret = TIZEN_FETCH_QUEUED;
+
+__finish_submit :
+	ithread_mutex_unlock(&TizenFetchMutex);
+
+	return ret;
+}
+
+void TizenFetch_GetStats(struct tizen_fetch_stats *stats)
+{
+	ithread_mutex_lock(&TizenFetchMutex);
+	*stats = TizenFetchStats;
+	ithread_mutex_unlock(&TizenFetchMutex);
+}
+
+/*! @} Fetch Pipeline */
+
+/*! @} UpnpSamples */
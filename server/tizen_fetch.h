@@ -0,0 +1,130 @@
+#ifndef UPNP_TIZEN_FETCH_H
+#define UPNP_TIZEN_FETCH_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Fetch Pipeline
+ *
+ * Downloads of device descriptions, taken off the libupnp callback threads.
+ *
+ * Discovery callbacks only queue the Location of the announcement. A small,
+ * fixed set of fetch threads drains the queue and runs the handler (download
+ * and parse) for each Location. A Location that is already queued or being
+ * fetched is not queued again, and the queue is bounded: once it fills past
+ * its high-water mark, announcements the caller flags as redundant are shed
+ * first, and once it is full everything is shed. Nothing here ever blocks
+ * the caller.
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! The Location was queued. */
+#define TIZEN_FETCH_QUEUED	0
+/*! The Location was already queued or being fetched. */
+#define TIZEN_FETCH_MERGED	1
+/*! The queue was too busy (or the pipeline stopped), nothing was queued. */
+#define TIZEN_FETCH_DROPPED	(-1)
+
+/*!
+ * \brief Called on a fetch thread for every queued Location.
+ */
+typedef void (*tizen_fetch_handler)(
+	/*! [in] The Location URL of the announcement. */
+	const char *location,
+	/*! [in] The largest max-age announced for it while it was queued. */
+	int expires);
+
+/*! Pipeline statistics, see TizenFetch_GetStats(). */
+struct tizen_fetch_stats {
+	/*! Locations queued. */
+	unsigned int queued;
+	/*! Announcements merged into a pending fetch. */
+	unsigned int merged;
+	/*! Announcements shed because the queue was busy. */
+	unsigned int dropped;
+	/*! Fetches completed. */
+	unsigned int fetched;
+	/*! Locations waiting in the queue right now. */
+	unsigned int pending;
+	/*! Highest value pending has ever reached. */
+	unsigned int highwater;
+};
+
+/*!
+ * \brief Starts the fetch threads.
+ *
+ * \return 0 on success, -1 on error.
+ */
+int TizenFetch_Start(
+	/*! [in] Number of fetch threads. */
+	int workers,
+	/*! [in] Maximum number of queued Locations. */
+	int queuemax,
+	/*! [in] The function that processes a Location. */
+	tizen_fetch_handler handler);
+
+/*!
+ * \brief Discards the queued Locations and waits for the running fetches to
+ * finish. Later submissions are dropped.
+ */
+void TizenFetch_Stop(void);
+
+/*!
+ * \brief Queues a Location for fetching.
+ *
+ * \return TIZEN_FETCH_QUEUED, TIZEN_FETCH_MERGED or TIZEN_FETCH_DROPPED.
+ */
+int TizenFetch_Submit(
+	/*! [in] The Location URL. */
+	const char *location,
+	/*! [in] The announced max-age, in seconds. */
+	int expires,
+	/*! [in] Non-zero if the announcement will be repeated anyway (an
+	 * ALIVE), so that it may be shed as soon as the queue is half full. */
+	int redundant);
+
+/*!
+ * \brief Returns a snapshot of the pipeline statistics.
+ */
+void TizenFetch_GetStats(
+	/*! [out] The statistics. */
+	struct tizen_fetch_stats *stats);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Fetch Pipeline */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_FETCH_H */
@@ -0,0 +1,763 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name HTTP Client
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_http.h"
+#include "tizen_timer.h"
+
+#include "ithread.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+/*! Largest header block accepted, in bytes. */
+#define TIZEN_HTTP_MAX_HEADER	(16 * 1024)
+
+/*! Idle connections kept per host, and in all. */
+#define TIZEN_HTTP_POOL_PER_HOST	4
+#define TIZEN_HTTP_POOL_MAX	32
+
+/*! A kept-alive connection waiting for the next request to its host. */
+struct tizen_http_idle {
+	/*! Zero if the slot is free. */
+	int used;
+	int fd;
+	/*! TizenTimer_Now() when the connection became idle. */
+	unsigned int since;
+	/*! "host port". */
+	char key[280];
+};
+
+/*! Protects the pool below. */
+static ithread_mutex_t TizenHttpPoolMutex = PTHREAD_MUTEX_INITIALIZER;
+static struct tizen_http_idle TizenHttpIdle[TIZEN_HTTP_POOL_MAX];
+static struct tizen_http_pool_stats TizenHttpPoolStats;
+
+/*! A connection and the bytes received on it so far. */
+struct tizen_http_conn {
+	int fd;
+	/*! TizenTimer_NowMs() by which the whole request must be done. */
+	unsigned int deadline;
+	char *buf;
+	size_t len;
+	size_t size;
+	/*! Set once the peer closed the connection. */
+	int eof;
+	/*! Set if the peer reset the connection, or closed it under a send. */
+	int reset;
+};
+
+/********************************************************************************
+ * TizenHttp_ParseURL
+ *
+ * Description:
+ *       Splits an http:// URL into host, port and path.
+ *
+ * Returns:
+ *   0 on success, -1 if the URL is not a plain http:// URL.
+ *
+ ********************************************************************************/
+static int TizenHttp_ParseURL(const char *url, char *host, size_t hostlen,
+	char *port, size_t portlen, const char **path)
+{
+	const char *p, *end, *colon;
+	size_t len;
+
+	if (strncasecmp(url, "http://", 7) != 0)
+		return -1;
+	p = url + 7;
+	end = p + strcspn(p, "/?#");
+	*path = *end == '/' ? end : "/";
+	if (*p == '[') {
+		/* [IPv6]:port */
+		colon = (const char *)memchr(p, ']', (size_t)(end - p));
+		if (!colon)
+			return -1;
+		len = (size_t)(colon - p - 1);
+		if (len == 0 || len >= hostlen)
+			return -1;
+		memcpy(host, p + 1, len);
+		colon = colon[1] == ':' ? colon + 1 : NULL;
+	} else {
+		colon = (const char *)memchr(p, ':', (size_t)(end - p));
+		len = (size_t)((colon ? colon : end) - p);
+		if (len == 0 || len >= hostlen)
+			return -1;
+		memcpy(host, p, len);
+	}
+	host[len] = '\0';
+	if (colon && end - colon > 1) {
+		len = (size_t)(end - colon - 1);
+		if (len >= portlen)
+			return -1;
+		memcpy(port, colon + 1, len);
+		port[len] = '\0';
+	} else {
+		snprintf(port, portlen, "80");
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenHttp_Wait
+ *
+ * Description:
+ *       Waits until the socket is readable or writable, at most until the
+ *       deadline of the request, so that a peer trickling bytes cannot
+ *       hold the request longer than its timeout.
+ *
+ * Returns:
+ *   0 when ready, -1 on timeout or error.
+ *
+ ********************************************************************************/
+static int TizenHttp_Wait(struct tizen_http_conn *conn, short events)
+{
+	struct pollfd pfd;
+	int left;
+	int ret;
+
+	pfd.fd = conn->fd;
+	pfd.events = events;
+	pfd.revents = 0;
+	do {
+		left = (int)(conn->deadline - TizenTimer_NowMs());
+		if (left <= 0)
+			return -1;
+		ret = poll(&pfd, 1, left);
+	} while (ret < 0 && errno == EINTR);
+
+	return ret > 0 ? 0 : -1;
+}
+
+static int TizenHttp_Connect(struct tizen_http_conn *conn, const char *host,
+	const char *port)
+{
+	struct addrinfo hints, *res, *ai;
+	socklen_t errlen;
+	int err;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo(host, port, &hints, &res) != 0)
+		return -1;
+	for (ai = res; ai; ai = ai->ai_next) {
+		conn->fd = socket(ai->ai_family, ai->ai_socktype,
+				  ai->ai_protocol);
+		if (conn->fd < 0)
+			continue;
+		fcntl(conn->fd, F_SETFL, fcntl(conn->fd, F_GETFL) | O_NONBLOCK);
+		if (connect(conn->fd, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		if (errno == EINPROGRESS &&
+		    TizenHttp_Wait(conn, POLLOUT) == 0) {
+			err = 0;
+			errlen = sizeof(err);
+			if (getsockopt(conn->fd, SOL_SOCKET, SO_ERROR, &err,
+				       &errlen) == 0 && err == 0)
+				break;
+		}
+		close(conn->fd);
+		conn->fd = -1;
+	}
+	freeaddrinfo(res);
+
+	return conn->fd >= 0 ? 0 : -1;
+}
+
+static int TizenHttp_Send(struct tizen_http_conn *conn, const char *data,
+	size_t len)
+{
+	ssize_t n;
+
+	while (len > 0) {
+		n = send(conn->fd, data, len, MSG_NOSIGNAL);
+		if (n > 0) {
+			data += n;
+			len -= (size_t)n;
+		} else if (n < 0 && errno == EINTR) {
+			continue;
+		} else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			if (TizenHttp_Wait(conn, POLLOUT) != 0)
+				return -1;
+		} else {
+			if (n < 0 && (errno == EPIPE || errno == ECONNRESET))
+				conn->reset = 1;
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenHttp_Fill
+ *
+ * Description:
+ *       Appends whatever the peer sends next to the connection buffer.
+ *
+ * Returns:
+ *   0 if data was read or the peer closed (conn->eof), -1 on error,
+ *   timeout or when the buffer would exceed limit.
+ *
+ ********************************************************************************/
+static int TizenHttp_Fill(struct tizen_http_conn *conn, size_t limit)
+{
+	char *buf;
+	size_t size;
+	ssize_t n;
+
+	if (conn->len + 1 >= conn->size) {
+		size = conn->size ? conn->size * 2 : 4096;
+		if (size > limit + 1)
+			size = limit + 1;
+		if (conn->len + 1 >= size)
+			return -1;
+		buf = (char *)realloc(conn->buf, size);
+		if (!buf)
+			return -1;
+		conn->buf = buf;
+		conn->buf[conn->len] = '\0';
+		conn->size = size;
+	}
+	for (;;) {
+		n = recv(conn->fd, conn->buf + conn->len,
+			 conn->size - conn->len - 1, 0);
+		if (n > 0) {
+			conn->len += (size_t)n;
+			conn->buf[conn->len] = '\0';
+			return 0;
+		}
+		if (n == 0) {
+			conn->eof = 1;
+			return 0;
+		}
+		if (errno == EINTR)
+			continue;
+		if (errno == ECONNRESET)
+			conn->reset = 1;
+		if ((errno != EAGAIN && errno != EWOULDBLOCK) ||
+		    TizenHttp_Wait(conn, POLLIN) != 0)
+			return -1;
+	}
+}
+
+/********************************************************************************
+ * TizenHttp_Find
+ *
+ * Description:
+ *       Finds a string in what was received from offset from on. Bodies
+ *       may hold NUL bytes, so the search is bounded by the length.
+ *
+ * Returns:
+ *   The first match, or NULL.
+ *
+ ********************************************************************************/
+static char *TizenHttp_Find(struct tizen_http_conn *conn, size_t from,
+	const char *str)
+{
+	if (!conn->buf || from > conn->len)
+		return NULL;
+
+	return (char *)memmem(conn->buf + from, conn->len - from, str,
+			      strlen(str));
+}
+
+static int TizenHttp_HexDigit(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	return -1;
+}
+
+/********************************************************************************
+ * TizenHttp_Header
+ *
+ * Description:
+ *       Finds a header in a header block.
+ *
+ * Returns:
+ *   The value (leading blanks skipped, ending at CR), or NULL.
+ *
+ ********************************************************************************/
+static const char *TizenHttp_Header(const char *headers, const char *name,
+	size_t *len)
+{
+	size_t namelen = strlen(name);
+	const char *line, *value;
+
+	for (line = strstr(headers, "\r\n"); line && line[2] != '\r';
+	     line = strstr(line + 2, "\r\n")) {
+		if (strncasecmp(line + 2, name, namelen) != 0 ||
+		    line[2 + namelen] != ':')
+			continue;
+		value = line + 3 + namelen;
+		value += strspn(value, " \t");
+		*len = strcspn(value, "\r");
+		while (*len > 0 &&
+		       (value[*len - 1] == ' ' || value[*len - 1] == '\t'))
+			(*len)--;
+		return value;
+	}
+
+	return NULL;
+}
+
+static void TizenHttp_CopyHeader(const char *headers, const char *name,
+	char *dest, size_t size)
+{
+	const char *value;
+	size_t len;
+
+	dest[0] = '\0';
+	value = TizenHttp_Header(headers, name, &len);
+	if (value && len < size) {
+		memcpy(dest, value, len);
+		dest[len] = '\0';
+	}
+}
+
+/********************************************************************************
+ * TizenHttp_ReadChunked
+ *
+ * Description:
+ *       Decodes a chunked body starting at offset start of the connection
+ *       buffer, reading more as needed. The decoded body replaces the
+ *       encoded one in place.
+ *
+ * Returns:
+ *   The body length, or -1 on error.
+ *
+ ********************************************************************************/
+static long TizenHttp_ReadChunked(struct tizen_http_conn *conn, size_t start)
+{
+	size_t in = start, out = start;
+	size_t chunk, pos, eol;
+	size_t limit = start + TIZEN_HTTP_MAX_BODY * 2;
+	char *crlf;
+	int digit;
+
+	for (;;) {
+		while (!(crlf = TizenHttp_Find(conn, in, "\r\n"))) {
+			if (conn->eof || TizenHttp_Fill(conn, limit) != 0 ||
+			    conn->eof)
+				return -1;
+		}
+		eol = (size_t)(crlf - conn->buf);
+		/* Hexadecimal size, then maybe extensions */
+		chunk = 0;
+		for (pos = in; pos < eol; pos++) {
+			digit = TizenHttp_HexDigit(conn->buf[pos]);
+			if (digit < 0)
+				break;
+			chunk = chunk * 16 + (size_t)digit;
+			if (chunk > TIZEN_HTTP_MAX_BODY - (out - start))
+				return -1;
+		}
+		if (pos == in || (pos < eol && conn->buf[pos] != ';' &&
+				  conn->buf[pos] != ' ' && conn->buf[pos] != '\t'))
+			return -1;
+		in = eol + 2;
+		if (chunk == 0)
+			break;
+		while (conn->len - in < chunk + 2) {
+			if (conn->eof || TizenHttp_Fill(conn, limit) != 0 ||
+			    conn->eof)
+				return -1;
+		}
+		if (memcmp(conn->buf + in + chunk, "\r\n", 2) != 0)
+			return -1;
+		memmove(conn->buf + out, conn->buf + in, chunk);
+		out += chunk;
+		in += chunk + 2;
+	}
+	conn->buf[out] = '\0';
+
+	return (long)(out - start);
+}
+
+/********************************************************************************
+ * TizenHttp_Exchange
+ *
+ * Description:
+ *       Sends a request on a connection and reads the whole response.
+ *       *reusable tells whether the connection may carry another request:
+ *       an HTTP/1.1 response the peer did not close, whose body was sized
+ *       by Content-Length, with nothing received past it.
+ *
+ * Returns:
+ *   0 if a response was received, -1 otherwise.
+ *
+ ********************************************************************************/
+static int TizenHttp_Exchange(struct tizen_http_conn *conn,
+	const char *method, const char *request, size_t reqlen,
+	const char *headers, const char *body, size_t bodylen,
+	struct tizen_http_response *resp, int *reusable)
+{
+	const char *value;
+	char *end;
+	size_t hdrlen, len;
+	long bodysize = -1;
+	int chunked = 0;
+	int minor = 0;
+
+	memset(resp, 0, sizeof(*resp));
+	*reusable = 0;
+	if (TizenHttp_Send(conn, request, reqlen) != 0 ||
+	    (headers && TizenHttp_Send(conn, headers, strlen(headers)) != 0) ||
+	    TizenHttp_Send(conn, "\r\n", 2) != 0 ||
+	    (bodylen && TizenHttp_Send(conn, body, bodylen) != 0))
+		return -1;
+
+	/* Status line and headers */
+	while (!(end = TizenHttp_Find(conn, 0, "\r\n\r\n"))) {
+		if ((conn->buf && conn->eof) ||
+		    TizenHttp_Fill(conn, TIZEN_HTTP_MAX_HEADER) != 0)
+			return -1;
+	}
+	hdrlen = (size_t)(end - conn->buf) + 4;
+	if (sscanf(conn->buf, "HTTP/%*d.%d %d", &minor, &resp->status) != 2)
+		return -1;
+	TizenHttp_CopyHeader(conn->buf, "ETag", resp->ETag, sizeof(resp->ETag));
+	TizenHttp_CopyHeader(conn->buf, "Last-Modified", resp->LastModified,
+			     sizeof(resp->LastModified));
+	value = TizenHttp_Header(conn->buf, "Transfer-Encoding", &len);
+	if (value && len >= 7 && strncasecmp(value + len - 7, "chunked", 7) == 0)
+		chunked = 1;
+	value = TizenHttp_Header(conn->buf, "Content-Length", &len);
+	if (value && !chunked)
+		bodysize = strtol(value, NULL, 10);
+	value = TizenHttp_Header(conn->buf, "Connection", &len);
+	*reusable = minor >= 1 && !chunked &&
+		!(value && len >= 5 && strncasecmp(value, "close", 5) == 0);
+
+	/* Body */
+	if (strcasecmp(method, "HEAD") == 0 || resp->status == 204 ||
+	    resp->status == 304 || resp->status / 100 == 1) {
+		bodysize = 0;
+	} else if (chunked) {
+		bodysize = TizenHttp_ReadChunked(conn, hdrlen);
+		if (bodysize < 0)
+			return -1;
+	} else if (bodysize >= 0) {
+		if (bodysize > TIZEN_HTTP_MAX_BODY)
+			return -1;
+		while (conn->len - hdrlen < (size_t)bodysize) {
+			if (conn->eof || TizenHttp_Fill(conn,
+			    hdrlen + (size_t)bodysize) != 0 || conn->eof)
+				return -1;
+		}
+	} else {
+		/* Delimited by the end of the connection */
+		*reusable = 0;
+		while (!conn->eof)
+			if (TizenHttp_Fill(conn,
+			    hdrlen + TIZEN_HTTP_MAX_BODY) != 0)
+				return -1;
+		bodysize = (long)(conn->len - hdrlen);
+	}
+	if (conn->eof || (!chunked && conn->len != hdrlen + (size_t)bodysize))
+		*reusable = 0;
+	if (bodysize > 0) {
+		resp->body = (char *)malloc((size_t)bodysize + 1);
+		if (!resp->body)
+			return -1;
+		memcpy(resp->body, conn->buf + hdrlen, (size_t)bodysize);
+		resp->body[bodysize] = '\0';
+		resp->length = (size_t)bodysize;
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenHttp_PoolTake
+ *
+ * Description:
+ *       Takes the most recently used idle connection to a host, skipping
+ *       (and closing) those the peer closed or wrote to meanwhile.
+ *
+ * Returns:
+ *   The socket, or -1 if there is none.
+ *
+ ********************************************************************************/
+static int TizenHttp_PoolTake(const char *key)
+{
+	struct pollfd pfd;
+	int best, fd, i;
+
+	ithread_mutex_lock(&TizenHttpPoolMutex);
+	for (;;) {
+		best = -1;
+		for (i = 0; i < TIZEN_HTTP_POOL_MAX; i++)
+			if (TizenHttpIdle[i].used &&
+			    strcmp(TizenHttpIdle[i].key, key) == 0 &&
+			    (best < 0 || TizenHttpIdle[i].since >
+			     TizenHttpIdle[best].since))
+				best = i;
+		if (best < 0) {
+			fd = -1;
+			break;
+		}
+		fd = TizenHttpIdle[best].fd;
+		TizenHttpIdle[best].used = 0;
+		TizenHttpPoolStats.idle--;
+		/* An idle connection has nothing to read unless the peer
+		 * closed it */
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 0) == 0)
+			break;
+		close(fd);
+		TizenHttpPoolStats.stale++;
+	}
+	ithread_mutex_unlock(&TizenHttpPoolMutex);
+
+	return fd;
+}
+
+/********************************************************************************
+ * TizenHttp_PoolPut
+ *
+ * Description:
+ *       Keeps a connection for the next request to the same host. The
+ *       least recently used connection makes room when the host or the
+ *       whole pool is full.
+ *
+ ********************************************************************************/
+static void TizenHttp_PoolPut(const char *key, int fd)
+{
+	int free_slot = -1, oldest = -1, oldest_host = -1;
+	int count = 0, i;
+
+	ithread_mutex_lock(&TizenHttpPoolMutex);
+	for (i = 0; i < TIZEN_HTTP_POOL_MAX; i++) {
+		if (!TizenHttpIdle[i].used) {
+			if (free_slot < 0)
+				free_slot = i;
+			continue;
+		}
+		if (oldest < 0 ||
+		    TizenHttpIdle[i].since < TizenHttpIdle[oldest].since)
+			oldest = i;
+		if (strcmp(TizenHttpIdle[i].key, key) == 0) {
+			count++;
+			if (oldest_host < 0 || TizenHttpIdle[i].since <
+			    TizenHttpIdle[oldest_host].since)
+				oldest_host = i;
+		}
+	}
+	i = count >= TIZEN_HTTP_POOL_PER_HOST ? oldest_host :
+		free_slot >= 0 ? free_slot : oldest;
+	if (TizenHttpIdle[i].used) {
+		close(TizenHttpIdle[i].fd);
+		TizenHttpPoolStats.evicted++;
+		TizenHttpPoolStats.idle--;
+	}
+	TizenHttpIdle[i].used = 1;
+	TizenHttpIdle[i].fd = fd;
+	TizenHttpIdle[i].since = TizenTimer_Now();
+	snprintf(TizenHttpIdle[i].key, sizeof(TizenHttpIdle[i].key), "%s",
+		 key);
+	TizenHttpPoolStats.idle++;
+	ithread_mutex_unlock(&TizenHttpPoolMutex);
+}
+
+/********************************************************************************
+ * TizenHttp_Do
+ *
+ * Description:
+ *       Runs a request, on a connection of its own or, when pooled, on a
+ *       kept-alive connection to the host if there is one. A kept-alive
+ *       connection may have been closed by the peer just before being
+ *       used: if the peer closed or reset it before any byte of the
+ *       response arrived, the request is sent again on a new connection.
+ *       Not after a timeout though: the peer may have run the request.
+ *
+ ********************************************************************************/
+static int TizenHttp_Do(const char *method, const char *url,
+	const char *headers, const char *body, size_t bodylen,
+	struct tizen_http_response *resp, int timeout, int pooled)
+{
+	struct tizen_http_conn conn;
+	char host[256], port[16], request[1024];
+	char key[sizeof(TizenHttpIdle[0].key)];
+	const char *path;
+	unsigned int deadline;
+	int reused, reusable = 0;
+	int n, ret = -1;
+
+	memset(resp, 0, sizeof(*resp));
+	if (TizenHttp_ParseURL(url, host, sizeof(host), port, sizeof(port),
+			       &path) != 0)
+		return -1;
+	n = snprintf(request, sizeof(request),
+		"%s %.*s HTTP/1.1\r\n"
+		"Host: %s%s%s%s%s\r\n"
+		"%s"
+		"Content-Length: %lu\r\n",
+		method, (int)strcspn(path, "#"), path,
+		strchr(host, ':') ? "[" : "", host,
+		strchr(host, ':') ? "]" : "",
+		strcmp(port, "80") ? ":" : "", strcmp(port, "80") ? port : "",
+		pooled ? "" : "Connection: close\r\n",
+		(unsigned long)bodylen);
+	if (n < 0 || (size_t)n >= sizeof(request))
+		return -1;
+	snprintf(key, sizeof(key), "%s %s", host, port);
+
+	/* A retry on a new connection shares the time left */
+	deadline = TizenTimer_NowMs() + (timeout > 0 ? timeout : 1) * 1000;
+	for (;;) {
+		memset(&conn, 0, sizeof(conn));
+		conn.deadline = deadline;
+		conn.fd = pooled ? TizenHttp_PoolTake(key) : -1;
+		reused = conn.fd >= 0;
+		if (!reused && TizenHttp_Connect(&conn, host, port) != 0)
+			break;
+		ret = TizenHttp_Exchange(&conn, method, request, (size_t)n,
+			headers, body, bodylen, resp, &reusable);
+		if (ret == 0 || !reused || conn.len ||
+		    !(conn.eof || conn.reset)) {
+			if (pooled) {
+				ithread_mutex_lock(&TizenHttpPoolMutex);
+				TizenHttpPoolStats.requests++;
+				if (reused)
+					TizenHttpPoolStats.reused++;
+				else
+					TizenHttpPoolStats.opened++;
+				ithread_mutex_unlock(&TizenHttpPoolMutex);
+			}
+			break;
+		}
+		/* Closed by the peer while idle: once more, afresh */
+		TizenHttp_Free(resp);
+		close(conn.fd);
+		free(conn.buf);
+		ithread_mutex_lock(&TizenHttpPoolMutex);
+		TizenHttpPoolStats.stale++;
+		ithread_mutex_unlock(&TizenHttpPoolMutex);
+	}
+
+	if (ret != 0)
+		TizenHttp_Free(resp);
+	if (conn.fd >= 0) {
+		if (pooled && 0 == ret && reusable)
+			TizenHttp_PoolPut(key, conn.fd);
+		else
+			close(conn.fd);
+	}
+	free(conn.buf);
+
+	return ret;
+}
+
+int TizenHttp_Request(const char *method, const char *url,
+	const char *headers, const char *body, size_t bodylen,
+	struct tizen_http_response *resp, int timeout)
+{
+	return TizenHttp_Do(method, url, headers, body, bodylen, resp,
+			    timeout, 0);
+}
+
+int TizenHttp_PooledRequest(const char *method, const char *url,
+	const char *headers, const char *body, size_t bodylen,
+	struct tizen_http_response *resp, int timeout)
+{
+	return TizenHttp_Do(method, url, headers, body, bodylen, resp,
+			    timeout, 1);
+}
+
+void TizenHttp_PoolExpire(int all)
+{
+	unsigned int now = TizenTimer_Now();
+	int i;
+
+	ithread_mutex_lock(&TizenHttpPoolMutex);
+	for (i = 0; i < TIZEN_HTTP_POOL_MAX; i++) {
+		if (!TizenHttpIdle[i].used || (!all &&
+		    now - TizenHttpIdle[i].since < TIZEN_HTTP_IDLE_TIMEOUT))
+			continue;
+		close(TizenHttpIdle[i].fd);
+		TizenHttpIdle[i].used = 0;
+		TizenHttpPoolStats.idle--;
+		if (!all)
+			TizenHttpPoolStats.expired++;
+	}
+	ithread_mutex_unlock(&TizenHttpPoolMutex);
+}
+
+void TizenHttp_GetPoolStats(struct tizen_http_pool_stats *stats)
+{
+	ithread_mutex_lock(&TizenHttpPoolMutex);
+	*stats = TizenHttpPoolStats;
+	ithread_mutex_unlock(&TizenHttpPoolMutex);
+}
+
+int TizenHttp_HostKey(const char *url, char *key, size_t size)
+{
+	char host[256], port[16];
+	const char *path;
+	int n;
+
+	if (TizenHttp_ParseURL(url, host, sizeof(host), port, sizeof(port),
+			       &path) != 0)
+		return -1;
+	n = snprintf(key, size, "%s %s", host, port);
+
+	return n < 0 || (size_t)n >= size ? -1 : 0;
+}
+
+void TizenHttp_Free(struct tizen_http_response *resp)
+{
+	free(resp->body);
+	resp->body = NULL;
+	resp->length = 0;
+}
+
+/*! @} HTTP Client */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,190 @@
+#ifndef UPNP_TIZEN_HTTP_H
+#define UPNP_TIZEN_HTTP_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name HTTP Client
+ *
+ * A small blocking HTTP/1.1 client for the requests the libupnp client API
+ * cannot express: the libupnp 1.6 calls take no request headers and hide the
+ * response headers, so conditional requests (If-None-Match,
+ * If-Modified-Since) are impossible with them.
+ *
+ * Only plain http:// URLs are supported. Bodies may be sized by
+ * Content-Length, chunked, or delimited by the end of the connection.
+ *
+ * TizenHttp_PooledRequest() keeps the connection open afterwards when the
+ * peer allows it, and reuses it for the next request to the same host, so
+ * that a stream of small requests (a slider driving SetVolume) costs
+ * neither a handshake nor a TIME_WAIT socket per request. Idle connections
+ * are closed after TIZEN_HTTP_IDLE_TIMEOUT seconds.
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Largest response body accepted, in bytes. */
+#define TIZEN_HTTP_MAX_BODY	(256 * 1024)
+
+/*! Size of the buffers holding the validators of a response. */
+#define TIZEN_HTTP_VALIDATOR_LEN	128
+
+/*! Seconds an idle kept-alive connection is kept. */
+#define TIZEN_HTTP_IDLE_TIMEOUT	15
+
+/*! Connection pool statistics, see TizenHttp_GetPoolStats(). */
+struct tizen_http_pool_stats {
+	/*! Requests run by TizenHttp_PooledRequest(). */
+	unsigned int requests;
+	/*! Requests sent on a kept-alive connection. */
+	unsigned int reused;
+	/*! Requests that needed a new connection. */
+	unsigned int opened;
+	/*! Idle connections found closed by the peer. */
+	unsigned int stale;
+	/*! Idle connections closed after TIZEN_HTTP_IDLE_TIMEOUT. */
+	unsigned int expired;
+	/*! Idle connections closed to make room for another. */
+	unsigned int evicted;
+	/*! Idle connections right now. */
+	unsigned int idle;
+};
+
+/*! A response, see TizenHttp_Request(). */
+struct tizen_http_response {
+	/*! HTTP status code. */
+	int status;
+	/*! The body, NUL terminated, NULL if empty. Free with
+	 * TizenHttp_Free(). */
+	char *body;
+	/*! Length of the body. */
+	size_t length;
+	/*! ETag header, "" if absent. */
+	char ETag[TIZEN_HTTP_VALIDATOR_LEN];
+	/*! Last-Modified header, "" if absent. */
+	char LastModified[TIZEN_HTTP_VALIDATOR_LEN];
+};
+
+/*!
+ * \brief Sends a request and reads the whole response.
+ *
+ * \return 0 if a response was received (whatever its status), -1 on a
+ * malformed URL, a network error, a timeout or an oversized response.
+ */
+int TizenHttp_Request(
+	/*! [in] The method, e.g. "GET". */
+	const char *method,
+	/*! [in] The http:// URL. */
+	const char *url,
+	/*! [in] Extra header lines, each ending with CRLF, or NULL. */
+	const char *headers,
+	/*! [in] The request body, or NULL. */
+	const char *body,
+	/*! [in] The length of the body. */
+	size_t bodylen,
+	/*! [out] The response. */
+	struct tizen_http_response *resp,
+	/*! [in] Timeout of the whole request, in seconds. */
+	int timeout);
+
+/*!
+ * \brief Like TizenHttp_Request(), on a kept-alive connection to the host
+ * when one is idle. Should the peer turn out to have closed a kept-alive
+ * connection before any byte of the response arrived, the request is sent
+ * again on a new connection. It is not after a timeout.
+ *
+ * \return 0 if a response was received (whatever its status), -1 on a
+ * malformed URL, a network error, a timeout or an oversized response.
+ */
+int TizenHttp_PooledRequest(
+	/*! [in] The method, e.g. "POST". */
+	const char *method,
+	/*! [in] The http:// URL. */
+	const char *url,
+	/*! [in] Extra header lines, each ending with CRLF, or NULL. */
+	const char *headers,
+	/*! [in] The request body, or NULL. */
+	const char *body,
+	/*! [in] The length of the body. */
+	size_t bodylen,
+	/*! [out] The response. */
+	struct tizen_http_response *resp,
+	/*! [in] Timeout of the whole request, in seconds. */
+	int timeout);
+
+/*!
+ * \brief Closes the idle connections, those idle for
+ * TIZEN_HTTP_IDLE_TIMEOUT seconds or more unless all is set.
+ */
+void TizenHttp_PoolExpire(
+	/*! [in] Non-zero to close every idle connection. */
+	int all);
+
+/*!
+ * \brief Returns a snapshot of the connection pool statistics.
+ */
+void TizenHttp_GetPoolStats(
+	/*! [out] The statistics. */
+	struct tizen_http_pool_stats *stats);
+
+/*!
+ * \brief Writes the "host port" key of an http:// URL, the same for every
+ * URL served by one host and port.
+ *
+ * \return 0 on success, -1 if the URL is not a plain http:// URL or the
+ * key does not fit.
+ */
+int TizenHttp_HostKey(
+	/*! [in] The http:// URL. */
+	const char *url,
+	/*! [out] The key, NUL terminated. */
+	char *key,
+	/*! [in] The size of key. */
+	size_t size);
+
+/*!
+ * \brief Releases the body of a response.
+ */
+void TizenHttp_Free(
+	/*! [in] The response. */
+	struct tizen_http_response *resp);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} HTTP Client */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_HTTP_H */
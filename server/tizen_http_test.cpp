@@ -0,0 +1,238 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name HTTP Client Test
+ *
+ * Runs TizenHttp_Request() against canned responses served from a local
+ * socket: bodies sized by Content-Length, chunked (with a NUL byte in the
+ * data), delimited by the end of the connection, malformed or truncated
+ * responses, and a peer that trickles its response past the timeout.
+ *
+ * Usage: tizen_http_test. Exits with 0 if every case passed.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_http.h"
+#include "tizen_timer.h"
+
+#include "ithread.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/*! Literal with its length, NUL bytes included. */
+#define TIZEN_TEST_BYTES(s)	s, sizeof(s) - 1
+
+/*! A canned response and what the client should make of it. */
+struct tizen_http_case {
+	const char *Name;
+	const char *Response;
+	size_t Length;
+	/*! Milliseconds between the bytes sent, 0 to send at once. */
+	int Trickle;
+	/*! Timeout given to the request, in seconds. */
+	int Timeout;
+	/*! Expected return value of TizenHttp_Request(). */
+	int Ret;
+	int Status;
+	const char *Body;
+	size_t BodyLength;
+	const char *ETag;
+};
+
+static const struct tizen_http_case TizenHttpCases[] = {
+	{ "Content-Length", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Content-Length: 5\r\nETag: \"v1\"\r\n\r\nhello"),
+	  0, 5, 0, 200, TIZEN_TEST_BYTES("hello"), "\"v1\"" },
+	{ "chunked", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Transfer-Encoding: chunked\r\n\r\n"
+		"5\r\nab\0cd\r\n3;name=value\r\nxyz\r\n0\r\n\r\n"),
+	  0, 5, 0, 200, TIZEN_TEST_BYTES("ab\0cdxyz"), "" },
+	{ "chunked, byte by byte", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Transfer-Encoding: chunked\r\n\r\n"
+		"A\r\n0123456789\r\n1\r\n\0\r\n0\r\n\r\n"),
+	  1, 5, 0, 200, TIZEN_TEST_BYTES("0123456789\0"), "" },
+	{ "Connection: close", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Connection: close\r\n\r\nup to the end"),
+	  0, 5, 0, 200, TIZEN_TEST_BYTES("up to the end"), "" },
+	{ "HTTP/1.0", TIZEN_TEST_BYTES("HTTP/1.0 200 OK\r\n"
+		"Content-Type: text/xml\r\n\r\n<root/>"),
+	  0, 5, 0, 200, TIZEN_TEST_BYTES("<root/>"), "" },
+	{ "Not Modified", TIZEN_TEST_BYTES("HTTP/1.1 304 Not Modified\r\n"
+		"ETag: \"v1\"\r\n\r\n"),
+	  0, 5, 0, 304, NULL, 0, "\"v1\"" },
+	{ "bad chunk size", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Transfer-Encoding: chunked\r\n\r\nzz\r\nab\r\n0\r\n\r\n"),
+	  0, 5, -1, 0, NULL, 0, NULL },
+	{ "bad chunk end", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Transfer-Encoding: chunked\r\n\r\n3\r\nabcXX0\r\n\r\n"),
+	  0, 5, -1, 0, NULL, 0, NULL },
+	{ "truncated body", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Content-Length: 10\r\n\r\nshort"),
+	  0, 5, -1, 0, NULL, 0, NULL },
+	{ "trickled past the timeout", TIZEN_TEST_BYTES("HTTP/1.1 200 OK\r\n"
+		"Content-Length: 40\r\n\r\n"
+		"0123456789012345678901234567890123456789"),
+	  50, 1, -1, 0, NULL, 0, NULL },
+};
+
+/*! The case the server answers next. */
+static const struct tizen_http_case *TizenHttpCase;
+static int TizenHttpListen = -1;
+
+/********************************************************************************
+ * TizenHttpTest_Serve
+ *
+ * Description:
+ *       Server thread: for every connection, reads the request headers and
+ *       sends the response of the current case, then closes.
+ *
+ ********************************************************************************/
+static void *TizenHttpTest_Serve(void *args)
+{
+	const struct tizen_http_case *test;
+	char request[2048];
+	size_t len, sent;
+	ssize_t n;
+	int fd;
+
+	for (;;) {
+		fd = accept(TizenHttpListen, NULL, NULL);
+		if (fd < 0)
+			break;
+		test = TizenHttpCase;
+		len = 0;
+		request[0] = '\0';
+		while (!strstr(request, "\r\n\r\n") && len < sizeof(request) - 1) {
+			n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+			if (n <= 0)
+				break;
+			len += (size_t)n;
+			request[len] = '\0';
+		}
+		for (sent = 0; sent < test->Length; sent += (size_t)n) {
+			n = send(fd, test->Response + sent, test->Trickle ? 1 :
+				 test->Length - sent, MSG_NOSIGNAL);
+			if (n <= 0)
+				break;
+			if (test->Trickle)
+				usleep(test->Trickle * 1000);
+		}
+		close(fd);
+	}
+
+	return NULL;
+	args = args;
+}
+
+/********************************************************************************
+ * TizenHttpTest_Run
+ *
+ * Description:
+ *       Runs one case.
+ *
+ * Returns:
+ *   0 if it passed, 1 otherwise.
+ *
+ ********************************************************************************/
+static int TizenHttpTest_Run(const char *url, const struct tizen_http_case *test)
+{
+	struct tizen_http_response resp;
+	unsigned int start;
+	const char *why = NULL;
+	int ret;
+
+	TizenHttpCase = test;
+	start = TizenTimer_NowMs();
+	ret = TizenHttp_Request("GET", url, NULL, NULL, 0, &resp, test->Timeout);
+	if (ret != test->Ret)
+		why = "return value";
+	else if (TizenTimer_NowMs() - start > (unsigned int)test->Timeout * 1000 + 500)
+		why = "timeout";
+	else if (0 == ret && resp.status != test->Status)
+		why = "status";
+	else if (0 == ret && (resp.length != test->BodyLength ||
+		 (test->BodyLength && (!resp.body ||
+		  memcmp(resp.body, test->Body, test->BodyLength) != 0))))
+		why = "body";
+	else if (0 == ret && strcmp(resp.ETag, test->ETag) != 0)
+		why = "ETag";
+	if (0 == ret)
+		TizenHttp_Free(&resp);
+	printf("%s: %s\n", why ? "FAIL" : "PASS", test->Name);
+	if (why)
+		printf("\twrong %s (returned %d, status %d, %lu body bytes)\n",
+		       why, ret, 0 == ret ? resp.status : 0,
+		       (unsigned long)(0 == ret ? resp.length : 0));
+
+	return why ? 1 : 0;
+}
+
+int main(void)
+{
+	struct sockaddr_in addr;
+	socklen_t addrlen = sizeof(addr);
+	ithread_t server;
+	char url[64];
+	size_t i;
+	int failed = 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	TizenHttpListen = socket(AF_INET, SOCK_STREAM, 0);
+	if (TizenHttpListen < 0 ||
+	    bind(TizenHttpListen, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+	    listen(TizenHttpListen, 4) != 0 ||
+	    getsockname(TizenHttpListen, (struct sockaddr *)&addr,
+			&addrlen) != 0) {
+		fprintf(stderr, "Cannot listen on the loopback interface\n");
+		return EXIT_FAILURE;
+	}
+	snprintf(url, sizeof(url), "http://127.0.0.1:%d/desc.xml",
+		 ntohs(addr.sin_port));
+	if (ithread_create(&server, NULL, TizenHttpTest_Serve, NULL) != 0) {
+		fprintf(stderr, "Cannot start the server thread\n");
+		return EXIT_FAILURE;
+	}
+	ithread_detach(server);
+
+	for (i = 0; i < sizeof(TizenHttpCases) / sizeof(TizenHttpCases[0]); i++)
+		failed += TizenHttpTest_Run(url, &TizenHttpCases[i]);
+	printf("%d of %lu cases failed\n", failed,
+	       (unsigned long)(sizeof(TizenHttpCases) / sizeof(TizenHttpCases[0])));
+
+	return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*! @} HTTP Client Test */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,140 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Object Pool
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_pool.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+void TizenPool_Init(struct tizen_pool *pool, size_t objsize,
+	unsigned int perslab)
+{
+	memset(pool, 0, sizeof(*pool));
+	if (objsize < sizeof(void *))
+		objsize = sizeof(void *);
+	pool->objsize = (objsize + TIZEN_POOL_ALIGN - 1) &
+		~(size_t)(TIZEN_POOL_ALIGN - 1);
+	pool->perslab = perslab ? perslab : 1;
+	pool->stats.objsize = pool->objsize;
+	ithread_mutex_init(&pool->mutex, 0);
+}
+
+void TizenPool_Destroy(struct tizen_pool *pool)
+{
+	void *slab, *next;
+
+	ithread_mutex_lock(&pool->mutex);
+	for (slab = pool->slabs; slab; slab = next) {
+		next = *(void **)slab;
+		free(slab);
+	}
+	pool->slabs = NULL;
+	pool->freelist = NULL;
+	ithread_mutex_unlock(&pool->mutex);
+	ithread_mutex_destroy(&pool->mutex);
+}
+
+/********************************************************************************
+ * TizenPool_Grow
+ *
+ * Description:
+ *       Allocates a new slab and threads its objects onto the free list.
+ *       The first cache line of the slab links the slab list. Called with
+ *       the pool mutex held.
+ *
+ ********************************************************************************/
+static int TizenPool_Grow(struct tizen_pool *pool)
+{
+	char *slab, *obj;
+	void *mem;
+	unsigned int i;
+
+	if (posix_memalign(&mem, TIZEN_POOL_ALIGN,
+	    TIZEN_POOL_ALIGN + pool->perslab * pool->objsize) != 0)
+		return -1;
+	slab = (char *)mem;
+	*(void **)slab = pool->slabs;
+	pool->slabs = slab;
+	/* Thread backwards so that objects come out in address order */
+	for (i = pool->perslab; i > 0; i--) {
+		obj = slab + TIZEN_POOL_ALIGN + (i - 1) * pool->objsize;
+		*(void **)obj = pool->freelist;
+		pool->freelist = obj;
+	}
+	pool->stats.free += pool->perslab;
+	pool->stats.slabs++;
+
+	return 0;
+}
+
+void *TizenPool_Alloc(struct tizen_pool *pool)
+{
+	void *obj = NULL;
+
+	ithread_mutex_lock(&pool->mutex);
+	if (!pool->freelist && TizenPool_Grow(pool) != 0)
+		goto __finish_alloc;
+	obj = pool->freelist;
+	pool->freelist = *(void **)obj;
+	pool->stats.free--;
+	pool->stats.live++;
+	if (pool->stats.live > pool->stats.highwater)
+		pool->stats.highwater = pool->stats.live;
+
+__finish_alloc :
+	ithread_mutex_unlock(&pool->mutex);
+	if (obj)
+		memset(obj, 0, pool->objsize);
+
+	return obj;
+}
+
+void TizenPool_Free(struct tizen_pool *pool, void *ptr)
+{
+	if (!ptr)
+		return;
+	ithread_mutex_lock(&pool->mutex);
+	*(void **)ptr = pool->freelist;
+	pool->freelist = ptr;
+	pool->stats.live--;
+	pool->stats.free++;
+	ithread_mutex_unlock(&pool->mutex);
+}
+
+void TizenPool_GetStats(struct tizen_pool *pool, struct tizen_pool_stats *stats)
+{
+	ithread_mutex_lock(&pool->mutex);
+	*stats = pool->stats;
+	ithread_mutex_unlock(&pool->mutex);
+}
+
+/*! @} Object Pool */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,137 @@
+#ifndef UPNP_TIZEN_POOL_H
+#define UPNP_TIZEN_POOL_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Object Pool
+ *
+ * A slab allocator for fixed size objects. Objects are carved out of large
+ * cache-aligned slabs and recycled through a free list, so device churn does
+ * not fragment the heap. Slabs are only given back by TizenPool_Destroy().
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "ithread.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Alignment of every object, one cache line. */
+#define TIZEN_POOL_ALIGN	64
+
+/*! Pool statistics, see TizenPool_GetStats(). */
+struct tizen_pool_stats {
+	/*! Size of one object, rounded up to TIZEN_POOL_ALIGN. */
+	size_t objsize;
+	/*! Objects handed out and not freed yet. */
+	unsigned int live;
+	/*! Objects sitting in the free list. */
+	unsigned int free;
+	/*! Highest value live has ever reached. */
+	unsigned int highwater;
+	/*! Number of slabs allocated. */
+	unsigned int slabs;
+};
+
+/*! A pool of fixed size objects. */
+struct tizen_pool {
+	/*! Size of one object, rounded up to TIZEN_POOL_ALIGN. */
+	size_t objsize;
+	/*! Objects per slab. */
+	unsigned int perslab;
+	/*! Free objects, linked through their first word. */
+	void *freelist;
+	/*! Allocated slabs, linked through their first word. */
+	void *slabs;
+	/*! Statistics. */
+	struct tizen_pool_stats stats;
+	/*! Protects everything above. */
+	ithread_mutex_t mutex;
+};
+
+/*!
+ * \brief Initializes an empty pool. No memory is allocated until the first
+ * TizenPool_Alloc().
+ */
+void TizenPool_Init(
+	/*! [in] The pool. */
+	struct tizen_pool *pool,
+	/*! [in] Size of the objects. */
+	size_t objsize,
+	/*! [in] Number of objects allocated at once when the pool runs dry. */
+	unsigned int perslab);
+
+/*!
+ * \brief Releases every slab of the pool. Objects still in use become
+ * invalid.
+ */
+void TizenPool_Destroy(
+	/*! [in] The pool. */
+	struct tizen_pool *pool);
+
+/*!
+ * \brief Takes an object from the pool.
+ *
+ * \return A zero-filled, TIZEN_POOL_ALIGN aligned object, or NULL if a new
+ * slab was needed and could not be allocated.
+ */
+void *TizenPool_Alloc(
+	/*! [in] The pool. */
+	struct tizen_pool *pool);
+
+/*!
+ * \brief Gives an object back to the pool.
+ */
+void TizenPool_Free(
+	/*! [in] The pool. */
+	struct tizen_pool *pool,
+	/*! [in] An object returned by TizenPool_Alloc(), may be NULL. */
+	void *ptr);
+
+/*!
+ * \brief Returns a snapshot of the pool statistics.
+ */
+void TizenPool_GetStats(
+	/*! [in] The pool. */
+	struct tizen_pool *pool,
+	/*! [out] The statistics. */
+	struct tizen_pool_stats *stats);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Object Pool */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_POOL_H */
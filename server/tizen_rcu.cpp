@@ -0,0 +1,172 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Read-Copy-Update
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_rcu.h"
+
+#include "ithread.h"
+
+#include <sched.h>
+#include <stdlib.h>
+
+/*! One retired object waiting for a grace period. */
+struct tizen_rcu_retired {
+	void *ptr;
+	tizen_rcu_release release;
+	struct tizen_rcu_retired *next;
+};
+
+/*!
+ * Readers register in the counter selected by the low bit of the epoch.
+ * A grace period flips the epoch and waits for the old counter to drain.
+ */
+static unsigned int TizenRcuEpoch = 0;
+static int TizenRcuReaders[2] = { 0, 0 };
+
+/*! Serializes grace periods. */
+static ithread_mutex_t TizenRcuSyncMutex;
+
+/*! Protects TizenRcuRetired. */
+static ithread_mutex_t TizenRcuRetireMutex;
+static struct tizen_rcu_retired *TizenRcuRetired = NULL;
+
+void TizenRcu_Init(void)
+{
+	ithread_mutex_init(&TizenRcuSyncMutex, 0);
+	ithread_mutex_init(&TizenRcuRetireMutex, 0);
+	TizenRcuEpoch = 0;
+	TizenRcuReaders[0] = 0;
+	TizenRcuReaders[1] = 0;
+	TizenRcuRetired = NULL;
+}
+
+void TizenRcu_Finish(void)
+{
+	TizenRcu_Reclaim();
+	ithread_mutex_destroy(&TizenRcuRetireMutex);
+	ithread_mutex_destroy(&TizenRcuSyncMutex);
+}
+
+int TizenRcu_ReadLock(void)
+{
+	unsigned int epoch;
+
+	for (;;) {
+		epoch = __atomic_load_n(&TizenRcuEpoch, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&TizenRcuReaders[epoch & 1], 1,
+			__ATOMIC_SEQ_CST);
+		/* If a grace period flipped the epoch in between, it may
+		 * already have found our counter empty: retry. */
+		if (__atomic_load_n(&TizenRcuEpoch, __ATOMIC_SEQ_CST) == epoch)
+			return (int)(epoch & 1);
+		__atomic_sub_fetch(&TizenRcuReaders[epoch & 1], 1,
+			__ATOMIC_SEQ_CST);
+	}
+}
+
+void TizenRcu_ReadUnlock(int token)
+{
+	__atomic_sub_fetch(&TizenRcuReaders[token], 1, __ATOMIC_RELEASE);
+}
+
+/********************************************************************************
+ * TizenRcu_WaitReaders
+ *
+ * Description:
+ *       Spin (yielding the CPU) until no reader is registered in the given
+ *       epoch counter.
+ *
+ ********************************************************************************/
+static void TizenRcu_WaitReaders(int phase)
+{
+	while (__atomic_load_n(&TizenRcuReaders[phase], __ATOMIC_ACQUIRE))
+		sched_yield();
+}
+
+void TizenRcu_Synchronize(void)
+{
+	unsigned int epoch;
+
+	ithread_mutex_lock(&TizenRcuSyncMutex);
+	epoch = __atomic_load_n(&TizenRcuEpoch, __ATOMIC_SEQ_CST);
+	/* Readers left over from the previous flip must be gone before the
+	 * counter is reused. */
+	TizenRcu_WaitReaders((epoch + 1) & 1);
+	__atomic_store_n(&TizenRcuEpoch, epoch + 1, __ATOMIC_SEQ_CST);
+	TizenRcu_WaitReaders(epoch & 1);
+	ithread_mutex_unlock(&TizenRcuSyncMutex);
+}
+
+void TizenRcu_Retire(void *ptr, tizen_rcu_release release)
+{
+	struct tizen_rcu_retired *item;
+
+	if (!ptr)
+		return;
+	item = (struct tizen_rcu_retired *)malloc(sizeof(*item));
+	if (!item) {
+		/* Cannot defer: wait for the readers right here. */
+		TizenRcu_Synchronize();
+		release(ptr);
+		return;
+	}
+	item->ptr = ptr;
+	item->release = release;
+	ithread_mutex_lock(&TizenRcuRetireMutex);
+	item->next = TizenRcuRetired;
+	TizenRcuRetired = item;
+	ithread_mutex_unlock(&TizenRcuRetireMutex);
+}
+
+int TizenRcu_Reclaim(void)
+{
+	struct tizen_rcu_retired *list, *next;
+	int count = 0;
+
+	ithread_mutex_lock(&TizenRcuRetireMutex);
+	list = TizenRcuRetired;
+	TizenRcuRetired = NULL;
+	ithread_mutex_unlock(&TizenRcuRetireMutex);
+	if (!list)
+		return 0;
+	TizenRcu_Synchronize();
+	while (list) {
+		next = list->next;
+		list->release(list->ptr);
+		free(list);
+		list = next;
+		count++;
+	}
+
+	return count;
+}
+
+/*! @} Read-Copy-Update */
+
+/*! @} UpnpSamples */
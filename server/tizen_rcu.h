@@ -0,0 +1,114 @@
+#ifndef UPNP_TIZEN_RCU_H
+#define UPNP_TIZEN_RCU_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Read-Copy-Update
+ *
+ * A minimal epoch based RCU for the read-mostly device registry.
+ *
+ * Readers bracket their accesses with TizenRcu_ReadLock() and
+ * TizenRcu_ReadUnlock(). They never block and never take a mutex. Writers
+ * (serialized by DeviceListMutex) publish new versions of shared structures
+ * with TIZEN_RCU_ASSIGN() and hand the old versions to TizenRcu_Retire().
+ * Retired memory is released by TizenRcu_Reclaim() once every reader that
+ * could still see it has left its read section.
+ *
+ * A read section must not call TizenRcu_Synchronize() or TizenRcu_Reclaim(),
+ * and should not block on the network.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Loads an RCU protected pointer inside a read section. */
+#define TIZEN_RCU_DEREFERENCE(p)	__atomic_load_n(&(p), __ATOMIC_ACQUIRE)
+
+/*! Publishes a fully initialized object to readers. */
+#define TIZEN_RCU_ASSIGN(p, v)		__atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+/*! Callback used to release a retired object. */
+typedef void (*tizen_rcu_release)(void *ptr);
+
+/*!
+ * \brief Initializes the RCU state. Must be called before anything else.
+ */
+void TizenRcu_Init(void);
+
+/*!
+ * \brief Reclaims everything still retired and releases the RCU state.
+ */
+void TizenRcu_Finish(void);
+
+/*!
+ * \brief Enters a read section.
+ *
+ * \return A token that must be passed to TizenRcu_ReadUnlock().
+ */
+int TizenRcu_ReadLock(void);
+
+/*!
+ * \brief Leaves a read section.
+ */
+void TizenRcu_ReadUnlock(
+	/*! [in] The token returned by TizenRcu_ReadLock(). */
+	int token);
+
+/*!
+ * \brief Waits until every read section that was running when the function
+ * was called has finished.
+ */
+void TizenRcu_Synchronize(void);
+
+/*!
+ * \brief Queues an object to be released after the next grace period.
+ */
+void TizenRcu_Retire(
+	/*! [in] The object, no longer reachable by new readers. */
+	void *ptr,
+	/*! [in] The function that releases it, usually free. */
+	tizen_rcu_release release);
+
+/*!
+ * \brief Waits for a grace period and releases every object retired before
+ * the call.
+ *
+ * \return The number of released objects.
+ */
+int TizenRcu_Reclaim(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Read-Copy-Update */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_RCU_H */
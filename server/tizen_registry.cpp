@@ -0,0 +1,657 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Device Registry
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_registry.h"
+#include "tizen_ctrl.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! Marks a deleted bucket, so that probe sequences stay unbroken. */
+static const char TizenHashTombstoneKey[] = "";
+#define TIZEN_HASH_TOMBSTONE	TizenHashTombstoneKey
+
+/*! Maximum load (live entries plus tombstones) before rehashing, in percent. */
+#define TIZEN_HASH_MAX_LOAD	70
+
+/*! Initial number of slots of the insertion order. */
+#define TIZEN_ORDER_MIN_CAPACITY	64
+
+struct tizen_registry GlobalDeviceRegistry;
+
+unsigned int TizenHash_String(const char *str)
+{
+	unsigned int hash = 2166136261u;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/********************************************************************************
+ * TizenHash_NewTable
+ *
+ * Description:
+ *       Allocates an empty version of the buckets, header and buckets in one
+ *       block so that it can be retired with a plain free.
+ *
+ * Parameters:
+ *   capacity -- The number of buckets, a power of two
+ *
+ ********************************************************************************/
+static struct tizen_hash_table *TizenHash_NewTable(unsigned int capacity)
+{
+	struct tizen_hash_table *t;
+
+	t = (struct tizen_hash_table *)calloc(1, sizeof(struct tizen_hash_table) +
+		capacity * sizeof(struct tizen_hash_entry));
+	if (!t)
+		return NULL;
+	t->capacity = capacity;
+	t->used = 0;
+	t->entries = (struct tizen_hash_entry *)(t + 1);
+
+	return t;
+}
+
+int TizenHash_Init(struct tizen_hash *table, unsigned int capacity,
+	int ownkeys)
+{
+	unsigned int cap = TIZEN_HASH_MIN_CAPACITY;
+
+	while (cap < capacity)
+		cap <<= 1;
+	table->count = 0;
+	table->ownkeys = ownkeys;
+	table->table = TizenHash_NewTable(cap);
+
+	return table->table ? 0 : -1;
+}
+
+void TizenHash_Destroy(struct tizen_hash *table)
+{
+	struct tizen_hash_table *t = table->table;
+	unsigned int i;
+
+	if (t && table->ownkeys) {
+		for (i = 0; i < t->capacity; i++) {
+			if (t->entries[i].key &&
+			    t->entries[i].key != TIZEN_HASH_TOMBSTONE)
+				free((char *)t->entries[i].key);
+		}
+	}
+	free(t);
+	table->table = NULL;
+	table->count = 0;
+}
+
+/********************************************************************************
+ * TizenHash_Rehash
+ *
+ * Description:
+ *       Copies every live entry into a new version of the buckets, dropping
+ *       the tombstones on the way, publishes it and retires the old one.
+ *
+ * Parameters:
+ *   table -- The hash table
+ *   capacity -- The new capacity, a power of two
+ *
+ ********************************************************************************/
+static int TizenHash_Rehash(struct tizen_hash *table, unsigned int capacity)
+{
+	struct tizen_hash_table *old = table->table;
+	struct tizen_hash_table *t;
+	unsigned int i, mask, pos;
+
+	t = TizenHash_NewTable(capacity);
+	if (!t)
+		return -1;
+	mask = capacity - 1;
+	for (i = 0; i < old->capacity; i++) {
+		if (!old->entries[i].key ||
+		    old->entries[i].key == TIZEN_HASH_TOMBSTONE)
+			continue;
+		pos = old->entries[i].hash & mask;
+		while (t->entries[pos].key)
+			pos = (pos + 1) & mask;
+		t->entries[pos] = old->entries[i];
+		t->used++;
+	}
+	TIZEN_RCU_ASSIGN(table->table, t);
+	TizenRcu_Retire(old, free);
+
+	return 0;
+}
+
+struct TizenDeviceNode *TizenHash_Find(const struct tizen_hash *table,
+	const char *key, unsigned int hash, int *service)
+{
+	const struct tizen_hash_table *t = TIZEN_RCU_DEREFERENCE(table->table);
+	const struct tizen_hash_entry *entry;
+	const char *entrykey;
+	unsigned int mask, pos;
+
+	if (!t)
+		return NULL;
+	mask = t->capacity - 1;
+	pos = hash & mask;
+	for (;;) {
+		entry = &t->entries[pos];
+		entrykey = __atomic_load_n(&entry->key, __ATOMIC_ACQUIRE);
+		if (!entrykey)
+			break;
+		if (entrykey != TIZEN_HASH_TOMBSTONE &&
+		    entry->hash == hash && strcmp(entrykey, key) == 0) {
+			if (service)
+				*service = entry->service;
+			return entry->node;
+		}
+		pos = (pos + 1) & mask;
+	}
+
+	return NULL;
+}
+
+int TizenHash_Insert(struct tizen_hash *table, const char *key,
+	unsigned int hash, struct TizenDeviceNode *node, int service)
+{
+	struct tizen_hash_table *t = table->table;
+	struct tizen_hash_entry *entry;
+	unsigned int mask, pos, cap;
+	char *copy = NULL;
+
+	if ((t->used + 1) * 100 > t->capacity * TIZEN_HASH_MAX_LOAD) {
+		/* Only grow if live entries are the problem, otherwise just
+		 * sweep the tombstones away. */
+		cap = t->capacity;
+		if ((table->count + 1) * 200 > cap * TIZEN_HASH_MAX_LOAD)
+			cap <<= 1;
+		if (TizenHash_Rehash(table, cap) != 0)
+			return -1;
+		t = table->table;
+	}
+	if (table->ownkeys) {
+		copy = strdup(key);
+		if (!copy)
+			return -1;
+		key = copy;
+	}
+	/* Tombstones are not reused: a reader may still be looking at the
+	 * node of the deleted entry. */
+	mask = t->capacity - 1;
+	pos = hash & mask;
+	while (t->entries[pos].key)
+		pos = (pos + 1) & mask;
+	entry = &t->entries[pos];
+	entry->hash = hash;
+	entry->service = service;
+	entry->node = node;
+	__atomic_store_n(&entry->key, key, __ATOMIC_RELEASE);
+	t->used++;
+	__atomic_store_n(&table->count, table->count + 1, __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+struct TizenDeviceNode *TizenHash_Remove(struct tizen_hash *table,
+	const char *key, unsigned int hash, struct TizenDeviceNode *node)
+{
+	struct tizen_hash_table *t = table->table;
+	struct tizen_hash_entry *entry;
+	const char *oldkey;
+	unsigned int mask, pos;
+
+	if (!t)
+		return NULL;
+	mask = t->capacity - 1;
+	pos = hash & mask;
+	while ((entry = &t->entries[pos])->key) {
+		if (entry->key != TIZEN_HASH_TOMBSTONE &&
+		    (!node || entry->node == node) &&
+		    entry->hash == hash && strcmp(entry->key, key) == 0) {
+			oldkey = entry->key;
+			/* entry->node is left alone for concurrent readers. */
+			__atomic_store_n(&entry->key,
+				(const char *)TIZEN_HASH_TOMBSTONE,
+				__ATOMIC_RELEASE);
+			__atomic_store_n(&table->count, table->count - 1,
+				__ATOMIC_RELAXED);
+			if (table->ownkeys)
+				TizenRcu_Retire((char *)oldkey, free);
+			return entry->node;
+		}
+		pos = (pos + 1) & mask;
+	}
+
+	return NULL;
+}
+
+/********************************************************************************
+ * TizenRegistry_NewOrder
+ *
+ * Description:
+ *       Allocates a new version of the insertion order holding the live
+ *       devices of old (if any), in the same relative order.
+ *
+ * Parameters:
+ *   old -- The current version, or NULL
+ *   cap -- The number of slots of the new version
+ *
+ ********************************************************************************/
+static struct tizen_order *TizenRegistry_NewOrder(struct tizen_order *old,
+	int cap)
+{
+	struct tizen_order *order;
+	int i;
+
+	order = (struct tizen_order *)calloc(1, sizeof(struct tizen_order) +
+		cap * sizeof(struct TizenDeviceNode *));
+	if (!order)
+		return NULL;
+	order->cap = cap;
+	order->slots = (struct TizenDeviceNode **)(order + 1);
+	for (i = 0; old && i < old->len; i++) {
+		if (!old->slots[i])
+			continue;
+		old->slots[i]->OrderIndex = order->len;
+		order->slots[order->len++] = old->slots[i];
+	}
+
+	return order;
+}
+
+int TizenRegistry_Init(void)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+
+	memset(reg, 0, sizeof(*reg));
+	reg->slot_free = -1;
+	if (TizenHash_Init(&reg->udn, TIZEN_HASH_MIN_CAPACITY, 0) != 0 ||
+	    TizenHash_Init(&reg->sid, TIZEN_HASH_MIN_CAPACITY, 1) != 0 ||
+	    TizenHash_Init(&reg->eventurl, TIZEN_HASH_MIN_CAPACITY, 0) != 0 ||
+	    TizenHash_Init(&reg->controlurl, TIZEN_HASH_MIN_CAPACITY, 0) != 0 ||
+	    !(reg->order = TizenRegistry_NewOrder(NULL,
+		TIZEN_ORDER_MIN_CAPACITY))) {
+		TizenRegistry_Destroy();
+		return -1;
+	}
+
+	return 0;
+}
+
+void TizenRegistry_Destroy(void)
+{
+	int i;
+
+	for (i = 0; i < TIZEN_SLOT_MAX_CHUNKS; i++)
+		free(GlobalDeviceRegistry.slots[i]);
+	TizenHash_Destroy(&GlobalDeviceRegistry.udn);
+	TizenHash_Destroy(&GlobalDeviceRegistry.sid);
+	TizenHash_Destroy(&GlobalDeviceRegistry.eventurl);
+	TizenHash_Destroy(&GlobalDeviceRegistry.controlurl);
+	free(GlobalDeviceRegistry.order);
+	memset(&GlobalDeviceRegistry, 0, sizeof(GlobalDeviceRegistry));
+}
+
+int TizenRegistry_Count(void)
+{
+	return (int)__atomic_load_n(&GlobalDeviceRegistry.udn.count,
+		__ATOMIC_RELAXED);
+}
+
+struct tizen_order *TizenRegistry_Order(void)
+{
+	return TIZEN_RCU_DEREFERENCE(GlobalDeviceRegistry.order);
+}
+
+struct TizenDeviceNode *TizenRegistry_Find(const char *UDN)
+{
+	return TizenHash_Find(&GlobalDeviceRegistry.udn, UDN,
+		TizenHash_String(UDN), NULL);
+}
+
+struct TizenDeviceNode *TizenRegistry_FindBySID(const char *SID, int *service)
+{
+	return TizenHash_Find(&GlobalDeviceRegistry.sid, SID,
+		TizenHash_String(SID), service);
+}
+
+struct TizenDeviceNode *TizenRegistry_FindByEventURL(const char *eventURL,
+	int *service)
+{
+	return TizenHash_Find(&GlobalDeviceRegistry.eventurl, eventURL,
+		TizenHash_String(eventURL), service);
+}
+
+struct TizenDeviceNode *TizenRegistry_FindByControlURL(const char *controlURL,
+	int *service)
+{
+	return TizenHash_Find(&GlobalDeviceRegistry.controlurl, controlURL,
+		TizenHash_String(controlURL), service);
+}
+
+/********************************************************************************
+ * TizenRegistry_Slot
+ *
+ * Description:
+ *       Returns the slot of the handle table with the given index.
+ *
+ ********************************************************************************/
+static struct tizen_slot *TizenRegistry_Slot(int index)
+{
+	struct tizen_slot *chunk;
+
+	chunk = TIZEN_RCU_DEREFERENCE(GlobalDeviceRegistry.slots[
+		index >> TIZEN_SLOT_CHUNK_SHIFT]);
+	if (!chunk)
+		return NULL;
+
+	return &chunk[index & (TIZEN_SLOT_CHUNK_SIZE - 1)];
+}
+
+/********************************************************************************
+ * TizenRegistry_AllocSlot
+ *
+ * Description:
+ *       Assigns a free slot of the handle table to node and sets
+ *       node->Handle.
+ *
+ ********************************************************************************/
+static int TizenRegistry_AllocSlot(struct TizenDeviceNode *node)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+	struct tizen_slot *slot, *chunk;
+	int index, chunkno, i;
+
+	if (reg->slot_free >= 0) {
+		index = reg->slot_free;
+		slot = TizenRegistry_Slot(index);
+		reg->slot_free = slot->nextfree;
+	} else {
+		index = reg->slot_count;
+		chunkno = index >> TIZEN_SLOT_CHUNK_SHIFT;
+		if (chunkno >= TIZEN_SLOT_MAX_CHUNKS)
+			return -1;
+		if (!reg->slots[chunkno]) {
+			chunk = (struct tizen_slot *)calloc(
+				TIZEN_SLOT_CHUNK_SIZE, sizeof(struct tizen_slot));
+			if (!chunk)
+				return -1;
+			for (i = 0; i < TIZEN_SLOT_CHUNK_SIZE; i++)
+				chunk[i].generation = 1;
+			TIZEN_RCU_ASSIGN(reg->slots[chunkno], chunk);
+		}
+		reg->slot_count++;
+		slot = TizenRegistry_Slot(index);
+	}
+	slot->nextfree = -1;
+	node->Handle = ((TizenDeviceHandle)slot->generation << 32) |
+		(TizenDeviceHandle)(unsigned int)index;
+	TIZEN_RCU_ASSIGN(slot->node, node);
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenRegistry_FreeSlot
+ *
+ * Description:
+ *       Releases the handle slot of node. Bumping the generation makes every
+ *       outstanding copy of the handle stale.
+ *
+ ********************************************************************************/
+static void TizenRegistry_FreeSlot(struct TizenDeviceNode *node)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+	int index = (int)(node->Handle & 0xffffffffu);
+	struct tizen_slot *slot = TizenRegistry_Slot(index);
+
+	if (!slot)
+		return;
+	TIZEN_RCU_ASSIGN(slot->node, (struct TizenDeviceNode *)NULL);
+	if (++slot->generation == 0)
+		slot->generation = 1;
+	slot->nextfree = reg->slot_free;
+	reg->slot_free = index;
+}
+
+struct TizenDeviceNode *TizenRegistry_FindByHandle(TizenDeviceHandle handle)
+{
+	unsigned int index = (unsigned int)(handle & 0xffffffffu);
+	struct tizen_slot *slot;
+	struct TizenDeviceNode *node;
+
+	if (handle == TIZEN_INVALID_HANDLE ||
+	    index >= (unsigned int)TIZEN_SLOT_MAX_CHUNKS * TIZEN_SLOT_CHUNK_SIZE)
+		return NULL;
+	slot = TizenRegistry_Slot((int)index);
+	if (!slot)
+		return NULL;
+	node = TIZEN_RCU_DEREFERENCE(slot->node);
+	/* The node carries its own handle, which also covers a slot that was
+	 * reused between the two loads. */
+	if (!node || node->Handle != handle)
+		return NULL;
+
+	return node;
+}
+
+/********************************************************************************
+ * TizenRegistry_IndexKey / TizenRegistry_UnindexKey
+ *
+ * Description:
+ *       Add or remove one service key of a device to or from a secondary
+ *       index. Empty keys (service not found, not subscribed) are skipped.
+ *
+ ********************************************************************************/
+static int TizenRegistry_IndexKey(struct tizen_hash *table, const char *key,
+	struct TizenDeviceNode *node, int service)
+{
+	if (!key || !key[0])
+		return 0;
+
+	return TizenHash_Insert(table, key, TizenHash_String(key), node,
+		service);
+}
+
+static void TizenRegistry_UnindexKey(struct tizen_hash *table, const char *key,
+	struct TizenDeviceNode *node)
+{
+	if (!key || !key[0])
+		return;
+	TizenHash_Remove(table, key, TizenHash_String(key), node);
+}
+
+static void TizenRegistry_UnindexServices(struct TizenDeviceNode *node)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+	struct tizen_service *svc;
+	int service;
+
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		svc = &node->device.TizenService[service];
+		TizenRegistry_UnindexKey(&reg->sid, svc->SID, node);
+		TizenRegistry_UnindexKey(&reg->eventurl, svc->EventURL, node);
+		TizenRegistry_UnindexKey(&reg->controlurl, svc->ControlURL, node);
+	}
+}
+
+static int TizenRegistry_IndexServices(struct TizenDeviceNode *node)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+	struct tizen_service *svc;
+	int service;
+
+	for (service = 0; service < TIZEN_SERVICE_SERVCOUNT; service++) {
+		svc = &node->device.TizenService[service];
+		if (TizenRegistry_IndexKey(&reg->sid, svc->SID,
+			node, service) != 0 ||
+		    TizenRegistry_IndexKey(&reg->eventurl, svc->EventURL,
+			node, service) != 0 ||
+		    TizenRegistry_IndexKey(&reg->controlurl, svc->ControlURL,
+			node, service) != 0) {
+			TizenRegistry_UnindexServices(node);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void TizenRegistry_SetSID(struct TizenDeviceNode *node, int service,
+	const char *SID)
+{
+	struct tizen_service *svc = &node->device.TizenService[service];
+
+	if (strcmp(svc->SID, SID) == 0)
+		return;
+	if (node->OrderIndex >= 0)
+		TizenRegistry_UnindexKey(&GlobalDeviceRegistry.sid, svc->SID,
+			node);
+	ithread_mutex_lock(&node->StateMutex);
+	strncpy(svc->SID, SID, sizeof(svc->SID) - 1);
+	svc->SID[sizeof(svc->SID) - 1] = '\0';
+	ithread_mutex_unlock(&node->StateMutex);
+	if (node->OrderIndex >= 0 &&
+	    TizenRegistry_IndexKey(&GlobalDeviceRegistry.sid, svc->SID,
+		node, service) != 0)
+		SampleUtil_Print("Error indexing SID %s\n", svc->SID);
+}
+
+int TizenRegistry_Add(struct TizenDeviceNode *node)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+	struct tizen_order *order = reg->order;
+	struct tizen_order *neworder;
+	int live, cap;
+
+	if (order->len == order->cap || order->holes > (int)reg->udn.count) {
+		/* Publish a compacted (and maybe larger) copy; readers still
+		 * walking the old one finish undisturbed. */
+		live = order->len - order->holes;
+		cap = order->cap;
+		if ((live + 1) * 2 > cap)
+			cap *= 2;
+		neworder = TizenRegistry_NewOrder(order, cap);
+		if (!neworder)
+			return -1;
+		TIZEN_RCU_ASSIGN(reg->order, neworder);
+		TizenRcu_Retire(order, free);
+		order = neworder;
+	}
+	node->UDNHash = TizenHash_String(node->device.UDN);
+	if (TizenRegistry_AllocSlot(node) != 0)
+		return -1;
+	if (TizenRegistry_IndexServices(node) != 0) {
+		TizenRegistry_FreeSlot(node);
+		node->Handle = TIZEN_INVALID_HANDLE;
+		return -1;
+	}
+	if (TizenHash_Insert(&reg->udn, node->device.UDN, node->UDNHash,
+	    node, -1) != 0) {
+		TizenRegistry_UnindexServices(node);
+		TizenRegistry_FreeSlot(node);
+		node->Handle = TIZEN_INVALID_HANDLE;
+		return -1;
+	}
+	node->OrderIndex = order->len;
+	TIZEN_RCU_ASSIGN(order->slots[order->len], node);
+	__atomic_store_n(&order->len, order->len + 1, __ATOMIC_RELEASE);
+
+	return 0;
+}
+
+void TizenRegistry_Remove(struct TizenDeviceNode *node)
+{
+	struct tizen_registry *reg = &GlobalDeviceRegistry;
+	struct tizen_order *order = reg->order;
+
+	if (!TizenHash_Remove(&reg->udn, node->device.UDN, node->UDNHash,
+	    node))
+		return;
+	TizenRegistry_UnindexServices(node);
+	TizenRegistry_FreeSlot(node);
+	/* Leave a hole rather than compacting here; the holes are squeezed
+	 * out later by TizenRegistry_Add. */
+	TIZEN_RCU_ASSIGN(order->slots[node->OrderIndex],
+		(struct TizenDeviceNode *)NULL);
+	__atomic_store_n(&order->holes, order->holes + 1, __ATOMIC_RELEASE);
+	node->OrderIndex = -1;
+}
+
+struct TizenDeviceNode *TizenRegistry_Nth(int devnum)
+{
+	struct tizen_order *order = TizenRegistry_Order();
+	struct TizenDeviceNode *node;
+	int i, len;
+
+	len = __atomic_load_n(&order->len, __ATOMIC_ACQUIRE);
+	if (devnum <= 0 || devnum > len)
+		return NULL;
+	if (!__atomic_load_n(&order->holes, __ATOMIC_ACQUIRE)) {
+		node = TIZEN_RCU_DEREFERENCE(order->slots[devnum - 1]);
+		if (node)
+			return node;
+	}
+	TIZEN_REGISTRY_FOREACH(order, i, node) {
+		if (--devnum == 0)
+			return node;
+	}
+
+	return NULL;
+}
+
+int TizenRegistry_TakeAll(struct TizenDeviceNode ***nodes)
+{
+	struct tizen_order *order = GlobalDeviceRegistry.order;
+	struct TizenDeviceNode *node;
+	int count = 0, i;
+
+	*nodes = NULL;
+	if (!TizenRegistry_Count())
+		return 0;
+	*nodes = (struct TizenDeviceNode **)malloc(
+		TizenRegistry_Count() * sizeof(struct TizenDeviceNode *));
+	if (!*nodes)
+		return 0;
+	TIZEN_REGISTRY_FOREACH(order, i, node) {
+		(*nodes)[count++] = node;
+		TizenRegistry_Remove(node);
+	}
+
+	return count;
+}
+
+/*! @} Device Registry */
+
+/*! @} UpnpSamples */
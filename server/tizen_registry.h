@@ -0,0 +1,384 @@
+#ifndef UPNP_TIZEN_REGISTRY_H
+#define UPNP_TIZEN_REGISTRY_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Device Registry
+ *
+ * The device registry replaces the old GlobalDeviceList linked list. Devices
+ * are found by UDN through an open-addressing hash table, and an
+ * insertion-ordered side vector keeps the "devnum" numbering used by the
+ * command line (ListDev, PrintDev, ...) stable.
+ *
+ * Secondary indexes map the SID, EventURL and ControlURL of every service to
+ * its (device, service) pair, so that GENA and SOAP callbacks do not have to
+ * scan the fleet.
+ *
+ * The registry is read-mostly. Writers (add, remove, SID change) hold
+ * DeviceListMutex. Readers only need an RCU read section (see tizen_rcu.h):
+ * buckets are filled once and then only tombstoned, and whole tables are
+ * republished when they grow, so a reader always sees a consistent version.
+ * Removed nodes stay valid until the end of the grace period.
+ *
+ * Every registered device also owns a slot in a chunked slot table. The slot
+ * index and the slot generation form a stable 64-bit TizenDeviceHandle that,
+ * unlike the devnum position, does not shift when other devices leave and is
+ * rejected once its device is gone.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_rcu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct TizenDeviceNode;
+
+/*! Stable device handle: slot generation in the high 32 bits, slot index in
+ * the low 32 bits. 0 is never a valid handle. */
+typedef unsigned long long TizenDeviceHandle;
+
+#define TIZEN_INVALID_HANDLE	((TizenDeviceHandle)0)
+
+/*! Slots per chunk of the slot table. Chunks never move once allocated. */
+#define TIZEN_SLOT_CHUNK_SHIFT	8
+#define TIZEN_SLOT_CHUNK_SIZE	(1 << TIZEN_SLOT_CHUNK_SHIFT)
+/*! Maximum number of chunks, i.e. TIZEN_SLOT_MAX_CHUNKS * TIZEN_SLOT_CHUNK_SIZE
+ * devices at most. */
+#define TIZEN_SLOT_MAX_CHUNKS	256
+
+/*! Initial number of buckets of a hash table, must be a power of two. */
+#define TIZEN_HASH_MIN_CAPACITY		64
+
+/*! One bucket of an open-addressing hash table. */
+struct tizen_hash_entry {
+	/*! Full hash of the key, kept to skip most string compares. */
+	unsigned int hash;
+	/*! The service of node the key belongs to, or -1 for device keys. */
+	int service;
+	/*! The device node the key belongs to. */
+	struct TizenDeviceNode *node;
+	/*! The key. NULL marks an empty bucket, TIZEN_HASH_TOMBSTONE a deleted
+	 * one. It is published last, so a reader that sees it also sees the
+	 * other fields. */
+	const char *key;
+};
+
+/*! One version of the buckets of a hash table. */
+struct tizen_hash_table {
+	/*! Number of buckets, always a power of two. */
+	unsigned int capacity;
+	/*! Live entries plus tombstones. Buckets are never reused within a
+	 * version, which is what makes lock-free lookups safe. */
+	unsigned int used;
+	struct tizen_hash_entry *entries;
+};
+
+/*! Open-addressing (linear probing) hash table keyed by a string. */
+struct tizen_hash {
+	/*! Current version of the buckets, RCU protected. */
+	struct tizen_hash_table *table;
+	/*! Live entries. */
+	unsigned int count;
+	/*! Non-zero if the table keeps its own copy of the keys, for keys that
+	 * change while the node is registered (SIDs). */
+	int ownkeys;
+};
+
+/*! Insertion order of the registered devices. */
+struct tizen_order {
+	/*! Used slots (live devices plus holes). */
+	int len;
+	/*! Allocated slots. */
+	int cap;
+	/*! Number of NULL slots. */
+	int holes;
+	/*! Device nodes in insertion order, NULL for removed devices. */
+	struct TizenDeviceNode **slots;
+};
+
+/*! One slot of the handle table. */
+struct tizen_slot {
+	/*! Bumped every time the slot is released. */
+	unsigned int generation;
+	/*! Next free slot index, or -1. Only meaningful while free. */
+	int nextfree;
+	/*! The device owning the slot, NULL while free. RCU protected. */
+	struct TizenDeviceNode *node;
+};
+
+/*! The global device registry. */
+struct tizen_registry {
+	/*! UDN -> device node. */
+	struct tizen_hash udn;
+	/*! Subscription ID -> (device node, service). */
+	struct tizen_hash sid;
+	/*! EventURL -> (device node, service). */
+	struct tizen_hash eventurl;
+	/*! ControlURL -> (device node, service). */
+	struct tizen_hash controlurl;
+	/*! Current insertion order, RCU protected. */
+	struct tizen_order *order;
+	/*! Chunks of the handle slot table. */
+	struct tizen_slot *slots[TIZEN_SLOT_MAX_CHUNKS];
+	/*! Number of slots handed out so far (free or not). */
+	int slot_count;
+	/*! Head of the free slot list, or -1. */
+	int slot_free;
+};
+
+extern struct tizen_registry GlobalDeviceRegistry;
+
+/*!
+ * \brief FNV-1a hash of a NUL terminated string.
+ */
+unsigned int TizenHash_String(
+	/*! [in] The string to hash. */
+	const char *str);
+
+/*!
+ * \brief Initializes an empty hash table.
+ *
+ * \return 0 on success, -1 if memory could not be allocated.
+ */
+int TizenHash_Init(
+	/*! [in] The hash table. */
+	struct tizen_hash *table,
+	/*! [in] Initial capacity, rounded up to a power of two. */
+	unsigned int capacity,
+	/*! [in] Non-zero to copy the keys on insertion. */
+	int ownkeys);
+
+/*!
+ * \brief Releases the buckets of a hash table immediately. The nodes are not
+ * touched. Only valid when no reader can see the table any more.
+ */
+void TizenHash_Destroy(
+	/*! [in] The hash table. */
+	struct tizen_hash *table);
+
+/*!
+ * \brief Looks up a key. Must be called inside a read section or with
+ * DeviceListMutex held.
+ *
+ * \return The device node stored under key, or NULL.
+ */
+struct TizenDeviceNode *TizenHash_Find(
+	/*! [in] The hash table. */
+	const struct tizen_hash *table,
+	/*! [in] The key to search for. */
+	const char *key,
+	/*! [in] TizenHash_String(key). */
+	unsigned int hash,
+	/*! [out] The service stored with the key, may be NULL. */
+	int *service);
+
+/*!
+ * \brief Inserts a key. Unless the table owns its keys, the key must stay
+ * valid until the node is reclaimed.
+ *
+ * \return 0 on success, -1 if the table could not grow.
+ */
+int TizenHash_Insert(
+	/*! [in] The hash table. */
+	struct tizen_hash *table,
+	/*! [in] The key, usually a field of node. */
+	const char *key,
+	/*! [in] TizenHash_String(key). */
+	unsigned int hash,
+	/*! [in] The device node to store. */
+	struct TizenDeviceNode *node,
+	/*! [in] The service to store, -1 for device keys. */
+	int service);
+
+/*!
+ * \brief Removes a key.
+ *
+ * \return The node that was stored under key, or NULL if it was not found.
+ */
+struct TizenDeviceNode *TizenHash_Remove(
+	/*! [in] The hash table. */
+	struct tizen_hash *table,
+	/*! [in] The key to remove. */
+	const char *key,
+	/*! [in] TizenHash_String(key). */
+	unsigned int hash,
+	/*! [in] Only remove the entry of this node, NULL for any. */
+	struct TizenDeviceNode *node);
+
+/*!
+ * \brief Initializes the global device registry.
+ *
+ * Note: the functions that modify the registry are NOT thread safe. They
+ * must be called from a function that has locked DeviceListMutex. The lookup
+ * functions may also be called inside an RCU read section.
+ *
+ * \return 0 on success, -1 on memory allocation failure.
+ */
+int TizenRegistry_Init(void);
+
+/*!
+ * \brief Releases the memory of the registry. The device nodes themselves
+ * must have been removed beforehand.
+ */
+void TizenRegistry_Destroy(void);
+
+/*!
+ * \brief Number of devices in the registry.
+ */
+int TizenRegistry_Count(void);
+
+/*!
+ * \brief Finds a device by UDN in O(1).
+ *
+ * \return The device node, or NULL if the UDN is unknown.
+ */
+struct TizenDeviceNode *TizenRegistry_Find(
+	/*! [in] The UDN to search for. */
+	const char *UDN);
+
+/*!
+ * \brief Finds the device and service a subscription ID belongs to.
+ *
+ * \return The device node, or NULL if the SID is unknown.
+ */
+struct TizenDeviceNode *TizenRegistry_FindBySID(
+	/*! [in] The subscription ID. */
+	const char *SID,
+	/*! [out] The service the SID belongs to. */
+	int *service);
+
+/*!
+ * \brief Finds the device and service an event subscription URL belongs to.
+ *
+ * \return The device node, or NULL if the URL is unknown.
+ */
+struct TizenDeviceNode *TizenRegistry_FindByEventURL(
+	/*! [in] The event subscription URL. */
+	const char *eventURL,
+	/*! [out] The service the URL belongs to. */
+	int *service);
+
+/*!
+ * \brief Finds the device and service a control URL belongs to.
+ *
+ * \return The device node, or NULL if the URL is unknown.
+ */
+struct TizenDeviceNode *TizenRegistry_FindByControlURL(
+	/*! [in] The control URL. */
+	const char *controlURL,
+	/*! [out] The service the URL belongs to. */
+	int *service);
+
+/*!
+ * \brief Validates a device handle in O(1).
+ *
+ * \return The device node, or NULL if the handle is stale or invalid.
+ */
+struct TizenDeviceNode *TizenRegistry_FindByHandle(
+	/*! [in] The device handle. */
+	TizenDeviceHandle handle);
+
+/*!
+ * \brief Changes the subscription ID of a service of a registered device and
+ * updates the SID index accordingly. An empty SID is not indexed.
+ */
+void TizenRegistry_SetSID(
+	/*! [in] The device node. */
+	struct TizenDeviceNode *node,
+	/*! [in] The service of the device. */
+	int service,
+	/*! [in] The new subscription ID. */
+	const char *SID);
+
+/*!
+ * \brief Appends a device to the registry, indexes its services and assigns
+ * its handle (node->Handle). The UDN of the device must not be registered
+ * yet. On failure node->Handle is left at TIZEN_INVALID_HANDLE.
+ *
+ * \return 0 on success, -1 on memory allocation failure.
+ */
+int TizenRegistry_Add(
+	/*! [in] The device node, with its UDN filled in. */
+	struct TizenDeviceNode *node);
+
+/*!
+ * \brief Unlinks a device from the registry in O(1). The node is not freed;
+ * it must be retired with TizenRcu_Retire().
+ *
+ * It is safe to remove the current node inside TIZEN_REGISTRY_FOREACH.
+ */
+void TizenRegistry_Remove(
+	/*! [in] The device node to unlink. */
+	struct TizenDeviceNode *node);
+
+/*!
+ * \brief Returns the device at position devnum, in insertion order,
+ * starting with 1.
+ *
+ * \return The device node, or NULL if devnum is out of range.
+ */
+struct TizenDeviceNode *TizenRegistry_Nth(
+	/*! [in] The number of the device. */
+	int devnum);
+
+/*!
+ * \brief Unlinks every device from the registry and returns them in
+ * insertion order. The caller owns the returned array and must free it.
+ *
+ * \return The number of devices stored in *nodes.
+ */
+int TizenRegistry_TakeAll(
+	/*! [out] Array of the unlinked device nodes, or NULL if empty. */
+	struct TizenDeviceNode ***nodes);
+
+/*!
+ * \brief Returns the current insertion order, for TIZEN_REGISTRY_FOREACH.
+ */
+struct tizen_order *TizenRegistry_Order(void);
+
+/*!
+ * \brief Iterates over the registered devices in insertion order.
+ *
+ * order is a struct tizen_order pointer returned by TizenRegistry_Order()
+ * inside the same read section, i is an int cursor, node receives every
+ * live device node.
+ */
+#define TIZEN_REGISTRY_FOREACH(order, i, node) \
+	for ((i) = 0; (i) < __atomic_load_n(&(order)->len, __ATOMIC_ACQUIRE); (i)++) \
+		if (((node) = TIZEN_RCU_DEREFERENCE((order)->slots[(i)])) != NULL)
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Device Registry */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_REGISTRY_H */
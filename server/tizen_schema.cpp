@@ -0,0 +1,535 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Service Schemas
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_schema.h"
+#include "tizen_strings.h"
+
+#include "ithread.h"
+#include "ixml.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*! Largest perfect hash table tried before giving up. */
+#define TIZEN_SCHEMA_HASH_MAX	4096
+
+/*! Serializes the publication of schemas. */
+static ithread_mutex_t TizenSchemaMutex = PTHREAD_MUTEX_INITIALIZER;
+/*! Loaded schemas, never unlinked before TizenSchema_Finish(). */
+static struct tizen_schema *TizenSchemaList = NULL;
+
+/********************************************************************************
+ * TizenSchema_Hash
+ *
+ * Description:
+ *       Seeded FNV-1a over a name.
+ *
+ ********************************************************************************/
+static unsigned int TizenSchema_Hash(const char *name, unsigned int seed)
+{
+	unsigned int hash = 2166136261u ^ seed;
+
+	while (*name) {
+		hash ^= (unsigned char)*name++;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/********************************************************************************
+ * TizenSchema_BuildHash
+ *
+ * Description:
+ *       Find a table size and a seed for which TizenSchema_Hash maps every
+ *       name to a slot of its own. Starts with a load factor of one half,
+ *       where a few seeds usually do.
+ *
+ * Returns:
+ *   0 on success, -1 if the names are not distinct or memory ran out.
+ *
+ ********************************************************************************/
+static int TizenSchema_BuildHash(struct tizen_schema_hash *hash,
+	const char **names, int count)
+{
+	unsigned int size, seed, slot = 0;
+	int i;
+
+	for (size = 8; size < 2 * (unsigned int)count; size <<= 1)
+		;
+	for (; size <= TIZEN_SCHEMA_HASH_MAX; size <<= 1) {
+		free(hash->slot);
+		hash->slot = (short *)malloc(size * sizeof(short));
+		if (!hash->slot)
+			return -1;
+		hash->mask = size - 1;
+		for (seed = 0; seed < 64; seed++) {
+			memset(hash->slot, -1, size * sizeof(short));
+			for (i = 0; i < count; i++) {
+				slot = TizenSchema_Hash(names[i], seed) &
+					hash->mask;
+				if (hash->slot[slot] >= 0)
+					break;
+				hash->slot[slot] = (short)i;
+			}
+			if (i == count) {
+				hash->seed = seed;
+				return 0;
+			}
+			/* Two equal names collide under every seed */
+			if (strcmp(names[hash->slot[slot]], names[i]) == 0)
+				return -1;
+		}
+	}
+
+	return -1;
+}
+
+/********************************************************************************
+ * TizenSchema_Is
+ *
+ * Description:
+ *       Tells whether a node is an element with the given local name.
+ *
+ ********************************************************************************/
+static int TizenSchema_Is(IXML_Node *node, const char *name)
+{
+	const char *nodename;
+	const char *colon;
+
+	if (ixmlNode_getNodeType(node) != eELEMENT_NODE)
+		return 0;
+	nodename = ixmlNode_getNodeName(node);
+	colon = strchr(nodename, ':');
+
+	return strcmp(colon ? colon + 1 : nodename, name) == 0;
+}
+
+/********************************************************************************
+ * TizenSchema_Child
+ *
+ * Description:
+ *       Returns the first child element of a node with the given local name,
+ *       or NULL.
+ *
+ ********************************************************************************/
+static IXML_Node *TizenSchema_Child(IXML_Node *parent, const char *name)
+{
+	IXML_Node *node;
+
+	for (node = parent ? ixmlNode_getFirstChild(parent) : NULL; node;
+	     node = ixmlNode_getNextSibling(node))
+		if (TizenSchema_Is(node, name))
+			return node;
+
+	return NULL;
+}
+
+/********************************************************************************
+ * TizenSchema_Count
+ *
+ * Description:
+ *       Counts the child elements of a node with the given local name.
+ *
+ ********************************************************************************/
+static int TizenSchema_Count(IXML_Node *parent, const char *name)
+{
+	IXML_Node *node;
+	int count = 0;
+
+	for (node = parent ? ixmlNode_getFirstChild(parent) : NULL; node;
+	     node = ixmlNode_getNextSibling(node))
+		if (TizenSchema_Is(node, name))
+			count++;
+
+	return count;
+}
+
+/********************************************************************************
+ * TizenSchema_Text
+ *
+ * Description:
+ *       Returns the text of the named child element of a node, "" if there
+ *       is none. The string belongs to the document.
+ *
+ ********************************************************************************/
+static const char *TizenSchema_Text(IXML_Node *parent, const char *name)
+{
+	IXML_Node *node;
+	IXML_Node *text;
+	const char *value;
+
+	node = TizenSchema_Child(parent, name);
+	text = node ? ixmlNode_getFirstChild(node) : NULL;
+	if (!text || ixmlNode_getNodeType(text) != eTEXT_NODE)
+		return "";
+	value = ixmlNode_getNodeValue(text);
+
+	return value ? value : "";
+}
+
+/********************************************************************************
+ * TizenSchema_Type
+ *
+ * Description:
+ *       Folds a UPnP dataType into one of TIZEN_TYPE_*.
+ *
+ ********************************************************************************/
+static int TizenSchema_Type(const char *dataType)
+{
+	static const char *ints[] = { "i1", "i2", "i4", "int", NULL };
+	static const char *uints[] = { "ui1", "ui2", "ui4", NULL };
+	static const char *floats[] = { "r4", "r8", "number", "fixed.14.4",
+		"float", NULL };
+	int i;
+
+	if (strcasecmp(dataType, "boolean") == 0)
+		return TIZEN_TYPE_BOOLEAN;
+	for (i = 0; ints[i]; i++)
+		if (strcasecmp(dataType, ints[i]) == 0)
+			return TIZEN_TYPE_INT;
+	for (i = 0; uints[i]; i++)
+		if (strcasecmp(dataType, uints[i]) == 0)
+			return TIZEN_TYPE_UINT;
+	for (i = 0; floats[i]; i++)
+		if (strcasecmp(dataType, floats[i]) == 0)
+			return TIZEN_TYPE_FLOAT;
+
+	return TIZEN_TYPE_STRING;
+}
+
+/********************************************************************************
+ * TizenSchema_Free
+ *
+ * Description:
+ *       Releases a schema and the names it interned.
+ *
+ ********************************************************************************/
+static void TizenSchema_Free(struct tizen_schema *schema)
+{
+	int i, j;
+
+	if (!schema)
+		return;
+	for (i = 0; schema->Vars && i < schema->VarCount; i++) {
+		TizenIntern_Put(schema->Vars[i].Name);
+		TizenIntern_Put(schema->Vars[i].Default);
+	}
+	for (i = 0; schema->Actions && i < schema->ActionCount; i++) {
+		for (j = 0; schema->Actions[i].Args &&
+		     j < schema->Actions[i].ArgCount; j++)
+			TizenIntern_Put(schema->Actions[i].Args[j].Name);
+		TizenIntern_Put(schema->Actions[i].Name);
+		free(schema->Actions[i].Args);
+	}
+	TizenIntern_Put(schema->ServiceType);
+	free(schema->Vars);
+	free(schema->Actions);
+	free(schema->varhash.slot);
+	free(schema->actionhash.slot);
+	free(schema);
+}
+
+/********************************************************************************
+ * TizenSchema_ParseVars
+ *
+ * Description:
+ *       Reads the serviceStateTable of an SCPD.
+ *
+ * Returns:
+ *   0 on success, -1 on error.
+ *
+ ********************************************************************************/
+static int TizenSchema_ParseVars(struct tizen_schema *schema,
+	IXML_Node *table)
+{
+	struct tizen_schema_var *var;
+	IXML_Node *node;
+	IXML_Node *range;
+	const char *sendEvents;
+
+	schema->VarCount = TizenSchema_Count(table, "stateVariable");
+	schema->Vars = (struct tizen_schema_var *)calloc(
+		schema->VarCount + 1, sizeof(*schema->Vars));
+	if (!schema->Vars)
+		return -1;
+	var = schema->Vars;
+	for (node = table ? ixmlNode_getFirstChild(table) : NULL; node;
+	     node = ixmlNode_getNextSibling(node)) {
+		if (!TizenSchema_Is(node, "stateVariable"))
+			continue;
+		var->Name = TizenIntern_Get(TizenSchema_Text(node, "name"));
+		var->Default = TizenIntern_Get(
+			TizenSchema_Text(node, "defaultValue"));
+		if (!var->Name || !var->Default || !*var->Name)
+			return -1;
+		var->Type = TizenSchema_Type(TizenSchema_Text(node,
+			"dataType"));
+		/* sendEvents defaults to yes */
+		sendEvents = ixmlElement_getAttribute((IXML_Element *)node,
+			"sendEvents");
+		var->Evented = !sendEvents || strcasecmp(sendEvents, "no") != 0;
+		range = TizenSchema_Child(node, "allowedValueRange");
+		if (range) {
+			var->HasRange = 1;
+			var->Minimum = strtol(TizenSchema_Text(range, "minimum"),
+					      NULL, 10);
+			var->Maximum = strtol(TizenSchema_Text(range, "maximum"),
+					      NULL, 10);
+		}
+		var++;
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenSchema_ParseAction
+ *
+ * Description:
+ *       Reads one action of an SCPD. The state table must have been read.
+ *
+ * Returns:
+ *   0 on success, -1 on error.
+ *
+ ********************************************************************************/
+static int TizenSchema_ParseAction(struct tizen_schema *schema,
+	struct tizen_schema_action *action, IXML_Node *node)
+{
+	struct tizen_schema_arg *arg;
+	IXML_Node *list;
+	IXML_Node *child;
+	int out, pass;
+
+	action->Name = TizenIntern_Get(TizenSchema_Text(node, "name"));
+	if (!action->Name || !*action->Name)
+		return -1;
+	list = TizenSchema_Child(node, "argumentList");
+	action->ArgCount = TizenSchema_Count(list, "argument");
+	action->Args = (struct tizen_schema_arg *)calloc(
+		action->ArgCount + 1, sizeof(*action->Args));
+	if (!action->Args)
+		return -1;
+	arg = action->Args;
+	/* In arguments first, then out arguments, each in SCPD order */
+	for (pass = 0; pass < 2; pass++) {
+		for (child = list ? ixmlNode_getFirstChild(list) : NULL; child;
+		     child = ixmlNode_getNextSibling(child)) {
+			if (!TizenSchema_Is(child, "argument"))
+				continue;
+			out = strcasecmp(TizenSchema_Text(child, "direction"),
+					 "out") == 0;
+			if (out != pass)
+				continue;
+			arg->Name = TizenIntern_Get(TizenSchema_Text(child,
+				"name"));
+			if (!arg->Name)
+				return -1;
+			arg->Var = TizenSchema_VarIndex(schema,
+				TizenSchema_Text(child, "relatedStateVariable"));
+			arg->Out = out;
+			if (!out)
+				action->InCount++;
+			arg++;
+		}
+	}
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenSchema_Parse
+ *
+ * Description:
+ *       Builds the schema of an SCPD document.
+ *
+ * Returns:
+ *   The schema, or NULL on error.
+ *
+ ********************************************************************************/
+static struct tizen_schema *TizenSchema_Parse(const char *serviceType,
+	IXML_Document *doc)
+{
+	struct tizen_schema *schema;
+	IXML_Node *root;
+	IXML_Node *list;
+	IXML_Node *node;
+	const char **names = NULL;
+	int i;
+
+	schema = (struct tizen_schema *)calloc(1, sizeof(*schema));
+	if (!schema)
+		return NULL;
+	schema->ServiceType = TizenIntern_Get(serviceType);
+	root = TizenSchema_Child((IXML_Node *)doc, "scpd");
+	if (!schema->ServiceType || !root ||
+	    TizenSchema_ParseVars(schema,
+		TizenSchema_Child(root, "serviceStateTable")) != 0)
+		goto error;
+	names = (const char **)malloc((schema->VarCount + 1) * sizeof(*names));
+	if (!names)
+		goto error;
+	for (i = 0; i < schema->VarCount; i++)
+		names[i] = schema->Vars[i].Name;
+	if (TizenSchema_BuildHash(&schema->varhash, names,
+				  schema->VarCount) != 0)
+		goto error;
+
+	list = TizenSchema_Child(root, "actionList");
+	schema->ActionCount = TizenSchema_Count(list, "action");
+	schema->Actions = (struct tizen_schema_action *)calloc(
+		schema->ActionCount + 1, sizeof(*schema->Actions));
+	if (!schema->Actions)
+		goto error;
+	i = 0;
+	for (node = list ? ixmlNode_getFirstChild(list) : NULL; node;
+	     node = ixmlNode_getNextSibling(node)) {
+		if (!TizenSchema_Is(node, "action"))
+			continue;
+		if (TizenSchema_ParseAction(schema, &schema->Actions[i++],
+					    node) != 0)
+			goto error;
+	}
+	free(names);
+	names = (const char **)malloc((schema->ActionCount + 1) *
+				      sizeof(*names));
+	if (!names)
+		goto error;
+	for (i = 0; i < schema->ActionCount; i++)
+		names[i] = schema->Actions[i].Name;
+	if (TizenSchema_BuildHash(&schema->actionhash, names,
+				  schema->ActionCount) != 0)
+		goto error;
+	free(names);
+
+	return schema;
+
+error:
+	free(names);
+	TizenSchema_Free(schema);
+
+	return NULL;
+}
+
+const struct tizen_schema *TizenSchema_Find(const char *serviceType)
+{
+	struct tizen_schema *schema;
+
+	if (!serviceType)
+		return NULL;
+	for (schema = __atomic_load_n(&TizenSchemaList, __ATOMIC_ACQUIRE);
+	     schema; schema = schema->next)
+		if (strcmp(schema->ServiceType, serviceType) == 0)
+			return schema;
+
+	return NULL;
+}
+
+const struct tizen_schema *TizenSchema_Load(const char *serviceType,
+	const char *buf, int maxvars)
+{
+	const struct tizen_schema *found;
+	struct tizen_schema *schema;
+	IXML_Document *doc = NULL;
+
+	/* Parsed once per service type, so the DOM is fine here */
+	if (ixmlParseBufferEx(buf, &doc) != IXML_SUCCESS)
+		return NULL;
+	schema = TizenSchema_Parse(serviceType, doc);
+	ixmlDocument_free(doc);
+	if (!schema)
+		return NULL;
+	if (maxvars > 0 && schema->VarCount > maxvars) {
+		TizenSchema_Free(schema);
+		return NULL;
+	}
+
+	ithread_mutex_lock(&TizenSchemaMutex);
+	found = TizenSchema_Find(serviceType);
+	if (!found) {
+		schema->next = TizenSchemaList;
+		__atomic_store_n(&TizenSchemaList, schema, __ATOMIC_RELEASE);
+		found = schema;
+		schema = NULL;
+	}
+	ithread_mutex_unlock(&TizenSchemaMutex);
+	TizenSchema_Free(schema);
+
+	return found;
+}
+
+int TizenSchema_VarIndex(const struct tizen_schema *schema, const char *name)
+{
+	int var;
+
+	if (!schema || !schema->varhash.slot || !name)
+		return -1;
+	var = schema->varhash.slot[TizenSchema_Hash(name,
+		schema->varhash.seed) & schema->varhash.mask];
+	if (var < 0 || strcmp(schema->Vars[var].Name, name) != 0)
+		return -1;
+
+	return var;
+}
+
+int TizenSchema_ActionIndex(const struct tizen_schema *schema,
+	const char *name)
+{
+	int action;
+
+	if (!schema || !schema->actionhash.slot || !name)
+		return -1;
+	action = schema->actionhash.slot[TizenSchema_Hash(name,
+		schema->actionhash.seed) & schema->actionhash.mask];
+	if (action < 0 || strcmp(schema->Actions[action].Name, name) != 0)
+		return -1;
+
+	return action;
+}
+
+void TizenSchema_Finish(void)
+{
+	struct tizen_schema *schema;
+	struct tizen_schema *next;
+
+	ithread_mutex_lock(&TizenSchemaMutex);
+	schema = TizenSchemaList;
+	TizenSchemaList = NULL;
+	ithread_mutex_unlock(&TizenSchemaMutex);
+	for (; schema; schema = next) {
+		next = schema->next;
+		TizenSchema_Free(schema);
+	}
+}
+
+/*! @} Service Schemas */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,172 @@
+#ifndef UPNP_TIZEN_SCHEMA_H
+#define UPNP_TIZEN_SCHEMA_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Service Schemas
+ *
+ * The actions, arguments and state variables of a service type, as read
+ * from its SCPD. A schema is parsed once per service type and shared by
+ * every device that implements it. Variables and actions get dense
+ * indexes, so state tables are plain arrays and names are resolved through
+ * a perfect hash.
+ *
+ * Schemas are immutable once loaded and stay valid until
+ * TizenSchema_Finish(). All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Data types of state variables, folded from the UPnP dataType. */
+#define TIZEN_TYPE_STRING	0
+#define TIZEN_TYPE_BOOLEAN	1
+#define TIZEN_TYPE_INT		2
+#define TIZEN_TYPE_UINT		3
+#define TIZEN_TYPE_FLOAT	4
+
+/*! Names to dense indexes, see TizenSchema_VarIndex(). */
+struct tizen_schema_hash {
+	unsigned int seed;
+	unsigned int mask;
+	short *slot;
+};
+
+/*! A state variable. */
+struct tizen_schema_var {
+	/*! Interned name. */
+	const char *Name;
+	/*! One of TIZEN_TYPE_*. */
+	int Type;
+	/*! Non-zero if the variable is evented. */
+	int Evented;
+	/*! Interned defaultValue, "" if absent. */
+	const char *Default;
+	/*! allowedValueRange, valid if HasRange. */
+	int HasRange;
+	long Minimum;
+	long Maximum;
+};
+
+/*! An argument of an action. */
+struct tizen_schema_arg {
+	/*! Interned name. */
+	const char *Name;
+	/*! Index of the related state variable, -1 if unknown. */
+	int Var;
+	/*! Non-zero for out arguments. */
+	int Out;
+};
+
+/*! An action. In arguments come first, in SCPD order. */
+struct tizen_schema_action {
+	/*! Interned name. */
+	const char *Name;
+	int InCount;
+	int ArgCount;
+	struct tizen_schema_arg *Args;
+};
+
+/*! The schema of a service type. */
+struct tizen_schema {
+	/*! Interned service type. */
+	const char *ServiceType;
+	int VarCount;
+	struct tizen_schema_var *Vars;
+	int ActionCount;
+	struct tizen_schema_action *Actions;
+
+	/* Private */
+	struct tizen_schema_hash varhash;
+	struct tizen_schema_hash actionhash;
+	struct tizen_schema *next;
+};
+
+/*!
+ * \brief Returns the schema of a service type.
+ *
+ * \return The schema, or NULL if it has not been loaded.
+ */
+const struct tizen_schema *TizenSchema_Find(
+	/*! [in] The service type, may be NULL. */
+	const char *serviceType);
+
+/*!
+ * \brief Parses the SCPD of a service type and publishes its schema. If
+ * another thread loaded the same type first, its schema is kept.
+ *
+ * \return The schema of the type, or NULL if the SCPD could not be parsed
+ * or declares more than maxvars state variables.
+ */
+const struct tizen_schema *TizenSchema_Load(
+	/*! [in] The service type. */
+	const char *serviceType,
+	/*! [in] The SCPD document. */
+	const char *buf,
+	/*! [in] Most state variables the caller can track, 0 for no limit. */
+	int maxvars);
+
+/*!
+ * \brief Maps a state variable name to its index. O(1).
+ *
+ * \return The index in schema->Vars, or -1 if there is no such variable.
+ */
+int TizenSchema_VarIndex(
+	/*! [in] The schema. */
+	const struct tizen_schema *schema,
+	/*! [in] The variable name. */
+	const char *name);
+
+/*!
+ * \brief Maps an action name to its index. O(1).
+ *
+ * \return The index in schema->Actions, or -1 if there is no such action.
+ */
+int TizenSchema_ActionIndex(
+	/*! [in] The schema. */
+	const struct tizen_schema *schema,
+	/*! [in] The action name. */
+	const char *name);
+
+/*!
+ * \brief Releases every schema. Nothing may use them any more.
+ */
+void TizenSchema_Finish(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Service Schemas */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_SCHEMA_H */
@@ -0,0 +1,671 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name SOAP Client
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_soap.h"
+#include "tizen_breaker.h"
+#include "tizen_http.h"
+#include "tizen_pool.h"
+#include "tizen_timer.h"
+#include "tizen_xml.h"
+
+#include "ithread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*! Upper bound on the number of sender threads. */
+#define TIZEN_SOAP_MAX_WORKERS	32
+
+/*! Request blocks allocated at once. */
+#define TIZEN_SOAP_POOL_SLAB	16
+
+/*! The templates of the actions of one schema. */
+struct tizen_soap_set {
+	const struct tizen_schema *schema;
+	int count;
+	struct tizen_soap_template *templates;
+	struct tizen_soap_set *next;
+};
+
+/*! One queued action. The control URL and the request follow the
+ * structure in the same block. */
+struct tizen_soap_job {
+	struct tizen_soap_job *next;
+	const struct tizen_soap_template *tmpl;
+	tizen_soap_callback callback;
+	void *cookie;
+	/*! Non-zero if the block comes from TizenSoapPool. */
+	int pooled;
+	char *url;
+	char *body;
+	size_t length;
+};
+
+/*! Prepared schemas, published with an atomic store, never unlinked
+ * before TizenSoap_Finish(). */
+static struct tizen_soap_set *TizenSoapSets = NULL;
+/*! Serializes TizenSoap_Prepare(). */
+static ithread_mutex_t TizenSoapSetMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*! The QueryStateVariable request, built by TizenSoap_Start(). Protected
+ * by TizenSoapSetMutex. */
+static struct tizen_soap_template TizenSoapQuery;
+
+/*! Protects everything below. */
+static ithread_mutex_t TizenSoapMutex = PTHREAD_MUTEX_INITIALIZER;
+static ithread_cond_t TizenSoapCond = PTHREAD_COND_INITIALIZER;
+static struct tizen_soap_job *TizenSoapHead = NULL;
+static struct tizen_soap_job *TizenSoapTail = NULL;
+static ithread_t TizenSoapThreads[TIZEN_SOAP_MAX_WORKERS];
+static int TizenSoapWorkers = 0;
+static int TizenSoapTimeout = 0;
+static int TizenSoapRun = 0;
+static struct tizen_soap_stats TizenSoapStats;
+
+/*! Request blocks, TIZEN_SOAP_BLOCK_SIZE bytes each. Thread safe. */
+static struct tizen_pool TizenSoapPool;
+
+/********************************************************************************
+ * TizenSoap_Append
+ *
+ * Description:
+ *       Appends a string at *len, or only counts its length when buf is
+ *       NULL. Templates are built in two passes: size, then copy.
+ *
+ ********************************************************************************/
+static void TizenSoap_Append(char *buf, size_t *len, const char *str)
+{
+	size_t n = strlen(str);
+
+	if (buf)
+		memcpy(buf + *len, str, n);
+	*len += n;
+}
+
+/********************************************************************************
+ * TizenSoap_Build
+ *
+ * Description:
+ *       Serializes the envelope (or, when slot is NULL, the header lines)
+ *       of an action, recording the offset of every argument in slot.
+ *
+ * Returns:
+ *   The length of the text.
+ *
+ ********************************************************************************/
+static size_t TizenSoap_Build(const char *serviceType, const char *name,
+	const char **args, int count, char *buf, size_t *slot)
+{
+	size_t len = 0;
+	int arg;
+
+	if (!slot) {
+		TizenSoap_Append(buf, &len, "SOAPACTION: \"");
+		TizenSoap_Append(buf, &len, serviceType);
+		TizenSoap_Append(buf, &len, "#");
+		TizenSoap_Append(buf, &len, name);
+		TizenSoap_Append(buf, &len, "\"\r\n"
+			"Content-Type: text/xml; charset=\"utf-8\"\r\n");
+		return len;
+	}
+	TizenSoap_Append(buf, &len, "<?xml version=\"1.0\"?>\r\n"
+		"<s:Envelope "
+		"xmlns:s=\"http://schemas.xmlsoap.org/soap/envelope/\" "
+		"s:encodingStyle=\"http://schemas.xmlsoap.org/soap/encoding/\">"
+		"\r\n<s:Body><u:");
+	TizenSoap_Append(buf, &len, name);
+	TizenSoap_Append(buf, &len, " xmlns:u=\"");
+	TizenSoap_Append(buf, &len, serviceType);
+	TizenSoap_Append(buf, &len, "\">");
+	for (arg = 0; arg < count; arg++) {
+		TizenSoap_Append(buf, &len, "<");
+		TizenSoap_Append(buf, &len, args[arg]);
+		TizenSoap_Append(buf, &len, ">");
+		slot[arg] = len;
+		TizenSoap_Append(buf, &len, "</");
+		TizenSoap_Append(buf, &len, args[arg]);
+		TizenSoap_Append(buf, &len, ">");
+	}
+	TizenSoap_Append(buf, &len, "</u:");
+	TizenSoap_Append(buf, &len, name);
+	TizenSoap_Append(buf, &len, "></s:Body></s:Envelope>\r\n");
+
+	return len;
+}
+
+/********************************************************************************
+ * TizenSoap_Compile
+ *
+ * Description:
+ *       Precompiles the template of an action.
+ *
+ * Returns:
+ *   0 on success, -1 on error.
+ *
+ ********************************************************************************/
+static int TizenSoap_Compile(const char *serviceType, const char *name,
+	const char **args, int count, struct tizen_soap_template *tmpl)
+{
+	size_t len;
+
+	tmpl->SlotCount = count;
+	tmpl->Slot = (size_t *)calloc(count + 1, sizeof(size_t));
+	if (!tmpl->Slot)
+		return -1;
+	len = TizenSoap_Build(serviceType, name, args, count, NULL,
+			      tmpl->Slot);
+	tmpl->Envelope = (char *)malloc(len + 1);
+	tmpl->Headers = (char *)malloc(TizenSoap_Build(serviceType, name,
+		args, count, NULL, NULL) + 1);
+	if (!tmpl->Envelope || !tmpl->Headers)
+		return -1;
+	tmpl->Length = TizenSoap_Build(serviceType, name, args, count,
+		tmpl->Envelope, tmpl->Slot);
+	tmpl->Envelope[tmpl->Length] = '\0';
+	tmpl->Headers[TizenSoap_Build(serviceType, name, args, count,
+		tmpl->Headers, NULL)] = '\0';
+
+	return 0;
+}
+
+/********************************************************************************
+ * TizenSoap_CompileAction
+ *
+ * Description:
+ *       Precompiles the template of an action of a schema, with a slot for
+ *       every in argument.
+ *
+ ********************************************************************************/
+static int TizenSoap_CompileAction(const struct tizen_schema *schema,
+	const struct tizen_schema_action *action,
+	struct tizen_soap_template *tmpl)
+{
+	const char **args;
+	int arg, ret;
+
+	args = (const char **)calloc(action->InCount + 1, sizeof(*args));
+	if (!args)
+		return -1;
+	for (arg = 0; arg < action->InCount; arg++)
+		args[arg] = action->Args[arg].Name;
+	ret = TizenSoap_Compile(schema->ServiceType, action->Name, args,
+				action->InCount, tmpl);
+	free(args);
+
+	return ret;
+}
+
+static void TizenSoap_FreeTemplate(struct tizen_soap_template *tmpl)
+{
+	free(tmpl->Envelope);
+	free(tmpl->Slot);
+	free(tmpl->Headers);
+	memset(tmpl, 0, sizeof(*tmpl));
+}
+
+static void TizenSoap_FreeSet(struct tizen_soap_set *set)
+{
+	int i;
+
+	for (i = 0; i < set->count; i++)
+		TizenSoap_FreeTemplate(&set->templates[i]);
+	free(set->templates);
+	free(set);
+}
+
+int TizenSoap_Prepare(const struct tizen_schema *schema)
+{
+	struct tizen_soap_set *set;
+	int i, ret = 0;
+
+	ithread_mutex_lock(&TizenSoapSetMutex);
+	for (set = TizenSoapSets; set; set = set->next)
+		if (set->schema == schema)
+			goto __finish_prepare;
+	ret = -1;
+	set = (struct tizen_soap_set *)calloc(1, sizeof(*set));
+	if (!set)
+		goto __finish_prepare;
+	set->schema = schema;
+	set->templates = (struct tizen_soap_template *)calloc(
+		schema->ActionCount + 1, sizeof(*set->templates));
+	if (!set->templates) {
+		free(set);
+		goto __finish_prepare;
+	}
+	for (i = 0; i < schema->ActionCount; i++) {
+		set->count++;
+		if (TizenSoap_CompileAction(schema, &schema->Actions[i],
+					    &set->templates[i]) != 0) {
+			TizenSoap_FreeSet(set);
+			goto __finish_prepare;
+		}
+	}
+	set->next = TizenSoapSets;
+	__atomic_store_n(&TizenSoapSets, set, __ATOMIC_RELEASE);
+	ret = 0;
+
+__finish_prepare :
+	ithread_mutex_unlock(&TizenSoapSetMutex);
+
+	return ret;
+}
+
+const struct tizen_soap_template *TizenSoap_Find(
+	const struct tizen_schema *schema, int action)
+{
+	struct tizen_soap_set *set;
+
+	for (set = __atomic_load_n(&TizenSoapSets, __ATOMIC_ACQUIRE); set;
+	     set = set->next)
+		if (set->schema == schema)
+			return action >= 0 && action < set->count ?
+				&set->templates[action] : NULL;
+
+	return NULL;
+}
+
+size_t TizenSoap_Fill(const struct tizen_soap_template *tmpl,
+	const char **values, char *buf, size_t size)
+{
+	const char *entity, *p;
+	size_t len = 0, from = 0, n;
+	int slot;
+
+	/* Sized and written in one pass: the copies stop once the buffer is
+	 * known to be too small */
+	for (slot = 0; slot <= tmpl->SlotCount; slot++) {
+		n = (slot < tmpl->SlotCount ? tmpl->Slot[slot] : tmpl->Length) -
+			from;
+		if (len + n < size)
+			memcpy(buf + len, tmpl->Envelope + from, n);
+		len += n;
+		from += n;
+		if (slot == tmpl->SlotCount)
+			break;
+		for (p = values[slot] ? values[slot] : ""; *p; p++) {
+			switch (*p) {
+			case '&': entity = "&amp;"; break;
+			case '<': entity = "&lt;"; break;
+			case '>': entity = "&gt;"; break;
+			default: entity = NULL; break;
+			}
+			n = entity ? strlen(entity) : 1;
+			if (len + n < size)
+				memcpy(buf + len, entity ? entity : p, n);
+			len += n;
+		}
+	}
+	if (len < size)
+		buf[len] = '\0';
+
+	return len;
+}
+
+/********************************************************************************
+ * TizenSoap_ErrorCode
+ *
+ * Description:
+ *       Maps a response to the code given to the callback. A fault carries
+ *       its UPnP error code in an errorCode element.
+ *
+ ********************************************************************************/
+static int TizenSoap_ErrorCode(const struct tizen_http_response *resp)
+{
+	const char *code;
+	long errcode;
+
+	if (resp->status / 100 == 2)
+		return 0;
+	if (resp->status != 500 || !resp->body)
+		return TIZEN_SOAP_TRANSPORT_ERROR;
+	code = strstr(resp->body, "errorCode>");
+	if (!code)
+		return TIZEN_SOAP_TRANSPORT_ERROR;
+	errcode = strtol(code + strlen("errorCode>"), NULL, 10);
+
+	return errcode > 0 ? (int)errcode : TIZEN_SOAP_TRANSPORT_ERROR;
+}
+
+/*!
+ * \brief Completes a job and gives its block back. Called without
+ * TizenSoapMutex.
+ */
+static void TizenSoap_Complete(struct tizen_soap_job *job, int errcode,
+	char *response)
+{
+	if (job->callback)
+		job->callback(errcode, job->url, job->tmpl, response,
+			      job->cookie);
+	if (job->pooled)
+		TizenPool_Free(&TizenSoapPool, job);
+	else
+		free(job);
+}
+
+/*!
+ * \brief Sender thread: POSTs the queued requests, in order.
+ */
+static void *TizenSoap_Loop(void *args)
+{
+	struct tizen_http_response resp;
+	struct tizen_soap_job *job;
+	unsigned int start;
+	int errcode;
+	int rejected;
+	int timeout;
+	int ret;
+
+	ithread_mutex_lock(&TizenSoapMutex);
+	for (;;) {
+		while (!TizenSoapHead && TizenSoapRun)
+			ithread_cond_wait(&TizenSoapCond, &TizenSoapMutex);
+		if (!TizenSoapRun)
+			break;
+		job = TizenSoapHead;
+		TizenSoapHead = job->next;
+		if (!TizenSoapHead)
+			TizenSoapTail = NULL;
+		TizenSoapStats.pending--;
+		ithread_mutex_unlock(&TizenSoapMutex);
+
+		/* A host that stopped answering fails at once instead of
+		 * holding this thread for a timeout */
+		rejected = !TizenBreaker_Allow(job->url, TizenSoapTimeout,
+					       &timeout);
+		memset(&resp, 0, sizeof(resp));
+		if (rejected) {
+			errcode = TIZEN_SOAP_TRANSPORT_ERROR;
+		} else {
+			/* Kept-alive: a stream of actions to a device does not
+			 * pay for a connection each */
+			start = TizenTimer_NowMs();
+			ret = TizenHttp_PooledRequest("POST", job->url,
+				job->tmpl->Headers, job->body, job->length,
+				&resp, timeout);
+			TizenBreaker_Report(job->url, 0 == ret,
+					    TizenTimer_NowMs() - start);
+			if (ret != 0)
+				errcode = TIZEN_SOAP_TRANSPORT_ERROR;
+			else
+				errcode = TizenSoap_ErrorCode(&resp);
+		}
+		TizenSoap_Complete(job, errcode, resp.body);
+		TizenHttp_Free(&resp);
+
+		ithread_mutex_lock(&TizenSoapMutex);
+		if (rejected)
+			TizenSoapStats.rejected++;
+		if (0 == errcode)
+			TizenSoapStats.succeeded++;
+		else if (errcode > 0)
+			TizenSoapStats.faults++;
+		else
+			TizenSoapStats.failed++;
+	}
+	ithread_mutex_unlock(&TizenSoapMutex);
+
+	return NULL;
+	args = args;
+}
+
+int TizenSoap_Start(int workers, int timeout)
+{
+	const char *varname = "u:varName";
+	int i;
+
+	if (workers < 1)
+		workers = 1;
+	if (workers > TIZEN_SOAP_MAX_WORKERS)
+		workers = TIZEN_SOAP_MAX_WORKERS;
+	ithread_mutex_lock(&TizenSoapSetMutex);
+	if (!TizenSoapQuery.Envelope && TizenSoap_Compile(
+	    TIZEN_SOAP_CONTROL_NS, "QueryStateVariable", &varname, 1,
+	    &TizenSoapQuery) != 0)
+		TizenSoap_FreeTemplate(&TizenSoapQuery);
+	ithread_mutex_unlock(&TizenSoapSetMutex);
+	TizenPool_Init(&TizenSoapPool, TIZEN_SOAP_BLOCK_SIZE,
+		       TIZEN_SOAP_POOL_SLAB);
+	ithread_mutex_lock(&TizenSoapMutex);
+	memset(&TizenSoapStats, 0, sizeof(TizenSoapStats));
+	TizenSoapTimeout = timeout > 0 ? timeout : 1;
+	TizenSoapWorkers = 0;
+	TizenSoapRun = 1;
+	for (i = 0; i < workers; i++) {
+		if (ithread_create(&TizenSoapThreads[i], NULL,
+				   TizenSoap_Loop, NULL) != 0)
+			break;
+		TizenSoapWorkers++;
+	}
+	if (!TizenSoapWorkers)
+		TizenSoapRun = 0;
+	ithread_mutex_unlock(&TizenSoapMutex);
+
+	return TizenSoapWorkers ? 0 : -1;
+}
+
+void TizenSoap_Stop(void)
+{
+	struct tizen_soap_job *job;
+	int workers, i;
+
+	ithread_mutex_lock(&TizenSoapMutex);
+	TizenSoapRun = 0;
+	job = TizenSoapHead;
+	TizenSoapHead = NULL;
+	TizenSoapTail = NULL;
+	TizenSoapStats.pending = 0;
+	workers = TizenSoapWorkers;
+	TizenSoapWorkers = 0;
+	ithread_cond_broadcast(&TizenSoapCond);
+	ithread_mutex_unlock(&TizenSoapMutex);
+
+	for (i = 0; i < workers; i++)
+		ithread_join(TizenSoapThreads[i], NULL);
+	while (job) {
+		struct tizen_soap_job *next = job->next;
+
+		TizenSoap_Complete(job, TIZEN_SOAP_TRANSPORT_ERROR, NULL);
+		job = next;
+	}
+	TizenHttp_PoolExpire(1);
+	TizenPool_Destroy(&TizenSoapPool);
+}
+
+/********************************************************************************
+ * TizenSoap_Queue
+ *
+ * Description:
+ *       Completes a job whose request is written, and hands it to the
+ *       sender threads. Called with TizenSoapMutex held.
+ *
+ ********************************************************************************/
+static void TizenSoap_Queue(struct tizen_soap_job *job, int pooled,
+	const char *url, size_t urllen, const struct tizen_soap_template *tmpl,
+	tizen_soap_callback callback, void *cookie)
+{
+	job->next = NULL;
+	job->tmpl = tmpl;
+	job->callback = callback;
+	job->cookie = cookie;
+	job->pooled = pooled;
+	job->url = (char *)(job + 1);
+	memcpy(job->url, url, urllen);
+	job->body = job->url + urllen;
+	job->length = strlen(job->body);
+	if (TizenSoapTail)
+		TizenSoapTail->next = job;
+	else
+		TizenSoapHead = job;
+	TizenSoapTail = job;
+	TizenSoapStats.sent++;
+	TizenSoapStats.pending++;
+	if (!pooled)
+		TizenSoapStats.oversized++;
+	ithread_cond_signal(&TizenSoapCond);
+}
+
+int TizenSoap_Send(const char *url, const struct tizen_soap_template *tmpl,
+	const char **values, tizen_soap_callback callback, void *cookie)
+{
+	struct tizen_soap_job *job = NULL;
+	size_t urllen, head, size;
+	int pooled = 1;
+
+	if (!url || !tmpl)
+		return -1;
+	urllen = strlen(url) + 1;
+	head = sizeof(*job) + urllen;
+
+	/* The pool only exists while the sender threads run */
+	ithread_mutex_lock(&TizenSoapMutex);
+	if (!TizenSoapRun)
+		goto __finish_send;
+	job = (struct tizen_soap_job *)TizenPool_Alloc(&TizenSoapPool);
+	size = TIZEN_SOAP_BLOCK_SIZE;
+	if (job && (head >= size || TizenSoap_Fill(tmpl, values,
+	    (char *)job + head, size - head) >= size - head)) {
+		/* Too long for a block: one allocation of the exact size */
+		TizenPool_Free(&TizenSoapPool, job);
+		size = head + TizenSoap_Fill(tmpl, values, NULL, 0) + 1;
+		job = (struct tizen_soap_job *)malloc(size);
+		pooled = 0;
+		if (job)
+			TizenSoap_Fill(tmpl, values, (char *)job + head,
+				       size - head);
+	}
+	if (job)
+		TizenSoap_Queue(job, pooled, url, urllen, tmpl, callback,
+				cookie);
+
+__finish_send :
+	ithread_mutex_unlock(&TizenSoapMutex);
+
+	return job ? 0 : -1;
+}
+
+int TizenSoap_SendBody(const char *url,
+	const struct tizen_soap_template *tmpl, const char *body,
+	size_t length, tizen_soap_callback callback, void *cookie)
+{
+	struct tizen_soap_job *job = NULL;
+	size_t urllen, head;
+	int pooled = 1;
+
+	if (!url || !tmpl || !body)
+		return -1;
+	urllen = strlen(url) + 1;
+	head = sizeof(*job) + urllen;
+
+	ithread_mutex_lock(&TizenSoapMutex);
+	if (!TizenSoapRun)
+		goto __finish_send_body;
+	if (head + length < TIZEN_SOAP_BLOCK_SIZE) {
+		job = (struct tizen_soap_job *)TizenPool_Alloc(&TizenSoapPool);
+	} else {
+		job = (struct tizen_soap_job *)malloc(head + length + 1);
+		pooled = 0;
+	}
+	if (job) {
+		memcpy((char *)job + head, body, length);
+		((char *)job + head)[length] = '\0';
+		TizenSoap_Queue(job, pooled, url, urllen, tmpl, callback,
+				cookie);
+	}
+
+__finish_send_body :
+	ithread_mutex_unlock(&TizenSoapMutex);
+
+	return job ? 0 : -1;
+}
+
+const struct tizen_soap_template *TizenSoap_QueryTemplate(void)
+{
+	const struct tizen_soap_template *tmpl;
+
+	ithread_mutex_lock(&TizenSoapSetMutex);
+	tmpl = TizenSoapQuery.Envelope ? &TizenSoapQuery : NULL;
+	ithread_mutex_unlock(&TizenSoapSetMutex);
+
+	return tmpl;
+}
+
+char *TizenSoap_QueryValue(char *response)
+{
+	char *value, *end;
+
+	value = response ? strstr(response, "QueryStateVariableResponse") :
+		NULL;
+	/* <return>, possibly prefixed */
+	while (value && (value = strstr(value, "return")) != NULL) {
+		end = value + strlen("return");
+		if ((value[-1] == '<' || value[-1] == ':') &&
+		    (*end == '>' || strncmp(end, "/>", 2) == 0))
+			break;
+		value = end;
+	}
+	if (!value)
+		return NULL;
+	value += strlen("return");
+	if (*value == '/')
+		return (char *)"";
+	value++;
+	end = strstr(value, "</");
+	if (!end)
+		return NULL;
+	TizenXml_Decode(value, (size_t)(end - value));
+
+	return value;
+}
+
+void TizenSoap_GetStats(struct tizen_soap_stats *stats)
+{
+	ithread_mutex_lock(&TizenSoapMutex);
+	*stats = TizenSoapStats;
+	ithread_mutex_unlock(&TizenSoapMutex);
+}
+
+void TizenSoap_Finish(void)
+{
+	struct tizen_soap_set *set;
+
+	ithread_mutex_lock(&TizenSoapSetMutex);
+	while (TizenSoapSets) {
+		set = TizenSoapSets;
+		TizenSoapSets = set->next;
+		TizenSoap_FreeSet(set);
+	}
+	TizenSoap_FreeTemplate(&TizenSoapQuery);
+	ithread_mutex_unlock(&TizenSoapSetMutex);
+}
+
+/*! @} SOAP Client */
+
+/*! @} UpnpSamples */
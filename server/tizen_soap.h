@@ -0,0 +1,251 @@
+#ifndef UPNP_TIZEN_SOAP_H
+#define UPNP_TIZEN_SOAP_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name SOAP Client
+ *
+ * Sends control requests without building a DOM.
+ *
+ * The envelope of every action of a service type is serialized once, when
+ * its schema is prepared, with an empty slot for each in argument. Sending
+ * an action only copies the envelope into a request block taken from a
+ * pool, escaping the argument values into their slots, and queues the block
+ * for a sender thread that POSTs it with the HTTP client (see tizen_http.h).
+ * The response is not parsed into a DOM either: only the UPnP error code of
+ * a fault is extracted. Requests go over kept-alive connections, see
+ * TizenHttp_PooledRequest(), and through the circuit breaker of their host
+ * (see tizen_breaker.h), which also sets their timeout.
+ *
+ * State variable queries (QueryStateVariable) are sent the same way, from
+ * TizenSoap_QueryTemplate().
+ *
+ * All functions are thread safe.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_schema.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Size of a pooled request block. Requests that do not fit are allocated
+ * on their own. */
+#define TIZEN_SOAP_BLOCK_SIZE	1024
+
+/*! Namespace of QueryStateVariable. */
+#define TIZEN_SOAP_CONTROL_NS	"urn:schemas-upnp-org:control-1-0"
+
+/*! The request could not be sent or got no valid response. */
+#define TIZEN_SOAP_TRANSPORT_ERROR	(-1)
+
+/*! The precompiled envelope of an action. */
+struct tizen_soap_template {
+	/*! The envelope, the in arguments empty. */
+	char *Envelope;
+	size_t Length;
+	/*! Number of in arguments. */
+	int SlotCount;
+	/*! Offset in Envelope of the value of every in argument. */
+	size_t *Slot;
+	/*! The SOAPACTION and Content-Type header lines. */
+	char *Headers;
+};
+
+/*!
+ * \brief Called on a sender thread when an action completes.
+ */
+typedef void (*tizen_soap_callback)(
+	/*! [in] 0 on success, the UPnP error code of a SOAP fault, or
+	 * TIZEN_SOAP_TRANSPORT_ERROR. */
+	int errcode,
+	/*! [in] The control URL. */
+	const char *url,
+	/*! [in] The template of the action. */
+	const struct tizen_soap_template *tmpl,
+	/*! [in] The body of the response, NULL if there is none. May be
+	 * modified. */
+	char *response,
+	/*! [in] The cookie given to TizenSoap_Send(). */
+	void *cookie);
+
+/*! Client statistics, see TizenSoap_GetStats(). */
+struct tizen_soap_stats {
+	/*! Requests queued. */
+	unsigned int sent;
+	/*! Requests that did not fit in a pooled block. */
+	unsigned int oversized;
+	/*! Requests answered with success. */
+	unsigned int succeeded;
+	/*! Requests answered with a SOAP fault. */
+	unsigned int faults;
+	/*! Requests that failed on the network or got a bad response. */
+	unsigned int failed;
+	/*! Of those, requests failed at once since their device is not
+	 * answering, see tizen_breaker.h. */
+	unsigned int rejected;
+	/*! Requests waiting for a sender thread right now. */
+	unsigned int pending;
+};
+
+/*!
+ * \brief Starts the sender threads.
+ *
+ * \return 0 on success, -1 on error.
+ */
+int TizenSoap_Start(
+	/*! [in] Number of sender threads. */
+	int workers,
+	/*! [in] Timeout of a request, in seconds. */
+	int timeout);
+
+/*!
+ * \brief Completes the queued requests with TIZEN_SOAP_TRANSPORT_ERROR, waits
+ * for the running ones, stops the sender threads and closes the idle
+ * kept-alive connections. Later requests are refused.
+ */
+void TizenSoap_Stop(void);
+
+/*!
+ * \brief Precompiles the envelope of every action of a schema. Does nothing
+ * if it was already done.
+ *
+ * \return 0 on success, -1 on error.
+ */
+int TizenSoap_Prepare(
+	/*! [in] The schema. */
+	const struct tizen_schema *schema);
+
+/*!
+ * \brief Returns the envelope of an action. Lock free.
+ *
+ * \return The template, or NULL if the schema was not prepared.
+ */
+const struct tizen_soap_template *TizenSoap_Find(
+	/*! [in] The schema. */
+	const struct tizen_schema *schema,
+	/*! [in] The index of the action in schema->Actions. */
+	int action);
+
+/*!
+ * \brief Returns the QueryStateVariable envelope, whose one argument is the
+ * name of the variable. Built by TizenSoap_Start().
+ *
+ * \return The template, or NULL if it could not be built.
+ */
+const struct tizen_soap_template *TizenSoap_QueryTemplate(void);
+
+/*!
+ * \brief Extracts the value from the response to a QueryStateVariable.
+ *
+ * \return The value, decoded and NUL terminated in place, or NULL if the
+ * response holds none.
+ */
+char *TizenSoap_QueryValue(
+	/*! [in,out] The response given to the callback. */
+	char *response);
+
+/*!
+ * \brief Writes the envelope of an action with escaped argument values.
+ *
+ * \return The length of the request, which was written to buf only if it
+ * is smaller than size.
+ */
+size_t TizenSoap_Fill(
+	/*! [in] The template. */
+	const struct tizen_soap_template *tmpl,
+	/*! [in] The value of every in argument, in SCPD order. */
+	const char **values,
+	/*! [out] The buffer, NUL terminated. */
+	char *buf,
+	/*! [in] The size of the buffer. */
+	size_t size);
+
+/*!
+ * \brief Queues an action for a sender thread.
+ *
+ * \return 0 if the action was queued, -1 otherwise. The callback is only
+ * called in the former case.
+ */
+int TizenSoap_Send(
+	/*! [in] The control URL of the service. */
+	const char *url,
+	/*! [in] The template of the action. */
+	const struct tizen_soap_template *tmpl,
+	/*! [in] The value of every in argument, in SCPD order. */
+	const char **values,
+	/*! [in] The completion callback, may be NULL. */
+	tizen_soap_callback callback,
+	/*! [in] Passed to the callback. */
+	void *cookie);
+
+/*!
+ * \brief Queues an action whose request was already written by
+ * TizenSoap_Fill(), to send the same request to several devices.
+ *
+ * \return 0 if the action was queued, -1 otherwise. The callback is only
+ * called in the former case.
+ */
+int TizenSoap_SendBody(
+	/*! [in] The control URL of the service. */
+	const char *url,
+	/*! [in] The template the request was written from. */
+	const struct tizen_soap_template *tmpl,
+	/*! [in] The request. */
+	const char *body,
+	/*! [in] The length of the request. */
+	size_t length,
+	/*! [in] The completion callback, may be NULL. */
+	tizen_soap_callback callback,
+	/*! [in] Passed to the callback. */
+	void *cookie);
+
+/*!
+ * \brief Returns a snapshot of the client statistics.
+ */
+void TizenSoap_GetStats(
+	/*! [out] The statistics. */
+	struct tizen_soap_stats *stats);
+
+/*!
+ * \brief Releases every template. Must be called after TizenSoap_Stop()
+ * and before TizenSchema_Finish().
+ */
+void TizenSoap_Finish(void);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} SOAP Client */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_SOAP_H */
@@ -0,0 +1,270 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name SOAP Client Benchmark
+ *
+ * Builds and serializes the same SetVolume request over and over, once as a
+ * DOM the way libupnp sends an action (UpnpMakeAction, UpnpAddToAction,
+ * ixmlPrintNode) and once from the precompiled envelope (a pooled request
+ * block and TizenSoap_Fill()), and prints the heap allocations and the time
+ * per request of both. Nothing is sent.
+ *
+ * Usage: tizen_soap_bench [SCPD file] [iterations]
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "sample_util.h"
+#include "tizen_pool.h"
+#include "tizen_schema.h"
+#include "tizen_soap.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*! The SCPD read when none is given. */
+#define TIZEN_BENCH_SCPD	"../web/tvcontrolSCPD.xml"
+
+/*! Requests built per path when no count is given. */
+#define TIZEN_BENCH_ITERATIONS	200000
+
+/*! The action, its in argument and the value sent. The value has a
+ * character to escape, as a text argument may. */
+#define TIZEN_BENCH_ACTION	"SetVolume"
+#define TIZEN_BENCH_ARG		"Volume"
+#define TIZEN_BENCH_VALUE	"7<"
+
+/*! Heap allocations counted while TizenBenchCounting is set. The benchmark
+ * is single threaded. */
+static int TizenBenchCounting = 0;
+static unsigned long TizenBenchAllocs = 0;
+
+extern "C" {
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+/* Interpose the allocator of the whole process, libupnp and ixml included */
+void *malloc(size_t size)
+{
+	if (TizenBenchCounting)
+		TizenBenchAllocs++;
+
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+	if (TizenBenchCounting)
+		TizenBenchAllocs++;
+
+	return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+	if (TizenBenchCounting)
+		TizenBenchAllocs++;
+
+	return __libc_realloc(ptr, size);
+}
+}
+
+static double TizenBench_Now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return now.tv_sec + now.tv_nsec / 1e9;
+}
+
+/********************************************************************************
+ * TizenBench_ReadFile
+ *
+ * Description:
+ *       Reads a whole file.
+ *
+ * Returns:
+ *   The NUL terminated content, to be freed by the caller, or NULL.
+ *
+ ********************************************************************************/
+static char *TizenBench_ReadFile(const char *path)
+{
+	FILE *fp;
+	char *buf = NULL;
+	long len;
+
+	fp = fopen(path, "r");
+	if (!fp)
+		return NULL;
+	if (fseek(fp, 0, SEEK_END) == 0 && (len = ftell(fp)) >= 0 &&
+	    fseek(fp, 0, SEEK_SET) == 0) {
+		buf = (char *)malloc(len + 1);
+		if (buf && fread(buf, 1, len, fp) != (size_t)len) {
+			free(buf);
+			buf = NULL;
+		}
+		if (buf)
+			buf[len] = '\0';
+	}
+	fclose(fp);
+
+	return buf;
+}
+
+/********************************************************************************
+ * TizenBench_Dom
+ *
+ * Description:
+ *       Builds, serializes and frees the request as a DOM.
+ *
+ * Returns:
+ *   The length of the serialized action, 0 on error.
+ *
+ ********************************************************************************/
+static size_t TizenBench_Dom(void)
+{
+	IXML_Document *action;
+	DOMString body;
+	size_t len = 0;
+
+	action = UpnpMakeAction(TIZEN_BENCH_ACTION, TizenServiceType[0], 0,
+				NULL);
+	if (UpnpAddToAction(&action, TIZEN_BENCH_ACTION, TizenServiceType[0],
+	    TIZEN_BENCH_ARG, TIZEN_BENCH_VALUE) == UPNP_E_SUCCESS) {
+		body = ixmlPrintNode((IXML_Node *)action);
+		if (body)
+			len = strlen(body);
+		ixmlFreeDOMString(body);
+	}
+	ixmlDocument_free(action);
+
+	return len;
+}
+
+/********************************************************************************
+ * TizenBench_Template
+ *
+ * Description:
+ *       Writes the request into a pooled block, as TizenSoap_Send() does.
+ *
+ * Returns:
+ *   The length of the envelope, 0 on error.
+ *
+ ********************************************************************************/
+static size_t TizenBench_Template(struct tizen_pool *pool,
+	const struct tizen_soap_template *tmpl)
+{
+	const char *values[] = { TIZEN_BENCH_VALUE };
+	char *block;
+	size_t len;
+
+	block = (char *)TizenPool_Alloc(pool);
+	if (!block)
+		return 0;
+	len = TizenSoap_Fill(tmpl, values, block, TIZEN_SOAP_BLOCK_SIZE);
+	TizenPool_Free(pool, block);
+
+	return len < TIZEN_SOAP_BLOCK_SIZE ? len : 0;
+}
+
+static void TizenBench_Report(const char *name, unsigned long allocs,
+	double elapsed, int iterations)
+{
+	printf("%-9s: %.1f allocations, %.0f ns per request\n", name,
+	       (double)allocs / iterations, elapsed * 1e9 / iterations);
+}
+
+int main(int argc, char **argv)
+{
+	const struct tizen_schema *schema;
+	const struct tizen_soap_template *tmpl;
+	struct tizen_pool pool;
+	const char *path = argc > 1 ? argv[1] : TIZEN_BENCH_SCPD;
+	int iterations = argc > 2 ? atoi(argv[2]) : TIZEN_BENCH_ITERATIONS;
+	char *scpd;
+	size_t len = 0;
+	double start;
+	int i;
+
+	if (iterations <= 0)
+		iterations = TIZEN_BENCH_ITERATIONS;
+	scpd = TizenBench_ReadFile(path);
+	if (!scpd) {
+		fprintf(stderr, "Cannot read %s\n", path);
+		return EXIT_FAILURE;
+	}
+	schema = TizenSchema_Load(TizenServiceType[0], scpd, 0);
+	free(scpd);
+	if (!schema || TizenSoap_Prepare(schema) != 0 ||
+	    !(tmpl = TizenSoap_Find(schema,
+		TizenSchema_ActionIndex(schema, TIZEN_BENCH_ACTION)))) {
+		fprintf(stderr, "No %s action in %s\n", TIZEN_BENCH_ACTION, path);
+		return EXIT_FAILURE;
+	}
+	TizenPool_Init(&pool, TIZEN_SOAP_BLOCK_SIZE, 16);
+
+	printf("%s request, %d iterations\n", TIZEN_BENCH_ACTION, iterations);
+
+	/* Warm up both paths: the pool gets its slab, libupnp its state */
+	if (!TizenBench_Dom() || !TizenBench_Template(&pool, tmpl)) {
+		fprintf(stderr, "Cannot build the request\n");
+		return EXIT_FAILURE;
+	}
+
+	TizenBenchAllocs = 0;
+	TizenBenchCounting = 1;
+	start = TizenBench_Now();
+	for (i = 0; i < iterations; i++)
+		len += TizenBench_Dom();
+	TizenBenchCounting = 0;
+	TizenBench_Report("DOM", TizenBenchAllocs,
+			  TizenBench_Now() - start, iterations);
+
+	TizenBenchAllocs = 0;
+	TizenBenchCounting = 1;
+	start = TizenBench_Now();
+	for (i = 0; i < iterations; i++)
+		len += TizenBench_Template(&pool, tmpl);
+	TizenBenchCounting = 0;
+	TizenBench_Report("template", TizenBenchAllocs,
+			  TizenBench_Now() - start, iterations);
+
+	/* Keeps the loops from being optimized away */
+	if (!len)
+		return EXIT_FAILURE;
+	TizenPool_Destroy(&pool);
+	TizenSoap_Finish();
+	TizenSchema_Finish();
+
+	return EXIT_SUCCESS;
+}
+
+/*! @} SOAP Client Benchmark */
+
+/*! @} UpnpSamples */
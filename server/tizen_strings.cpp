@@ -0,0 +1,193 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name String Storage
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_strings.h"
+#include "tizen_registry.h"
+#include "tizen_pool.h"
+
+#include "ithread.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*! Buckets of the intern table, a power of two. Only a handful of distinct
+ * service types and IDs exist on a network. */
+#define TIZEN_INTERN_BUCKETS	64
+
+/*! One interned string. */
+struct tizen_intern_entry {
+	struct tizen_intern_entry *next;
+	unsigned int hash;
+	unsigned int refs;
+	char str[1];
+};
+
+static struct tizen_intern_entry *TizenInternTable[TIZEN_INTERN_BUCKETS];
+static ithread_mutex_t TizenInternMutex;
+
+/*! Arena block size classes. A typical device needs a few hundred bytes;
+ * larger blocks come straight from malloc. */
+static const unsigned int TizenArenaClass[] = { 256, 512, 1024 };
+#define TIZEN_ARENA_CLASSES \
+	(int)(sizeof(TizenArenaClass) / sizeof(TizenArenaClass[0]))
+#define TIZEN_ARENA_SLAB	16
+
+static struct tizen_pool TizenArenaPool[TIZEN_ARENA_CLASSES];
+
+void TizenStrings_Init(void)
+{
+	int i;
+
+	ithread_mutex_init(&TizenInternMutex, 0);
+	memset(TizenInternTable, 0, sizeof(TizenInternTable));
+	for (i = 0; i < TIZEN_ARENA_CLASSES; i++)
+		TizenPool_Init(&TizenArenaPool[i], TizenArenaClass[i],
+			TIZEN_ARENA_SLAB);
+}
+
+const char *TizenIntern_Get(const char *str)
+{
+	struct tizen_intern_entry *entry;
+	unsigned int hash;
+	size_t len;
+
+	if (!str || !str[0])
+		return "";
+	hash = TizenHash_String(str);
+	ithread_mutex_lock(&TizenInternMutex);
+	for (entry = TizenInternTable[hash & (TIZEN_INTERN_BUCKETS - 1)];
+	     entry; entry = entry->next) {
+		if (entry->hash == hash && strcmp(entry->str, str) == 0)
+			break;
+	}
+	if (!entry) {
+		len = strlen(str);
+		entry = (struct tizen_intern_entry *)malloc(
+			sizeof(struct tizen_intern_entry) + len);
+		if (entry) {
+			memcpy(entry->str, str, len + 1);
+			entry->hash = hash;
+			entry->refs = 0;
+			entry->next =
+			    TizenInternTable[hash & (TIZEN_INTERN_BUCKETS - 1)];
+			TizenInternTable[hash & (TIZEN_INTERN_BUCKETS - 1)] = entry;
+		}
+	}
+	if (entry)
+		entry->refs++;
+	ithread_mutex_unlock(&TizenInternMutex);
+
+	return entry ? entry->str : NULL;
+}
+
+void TizenIntern_Put(const char *str)
+{
+	struct tizen_intern_entry *entry, **prev;
+
+	if (!str || !str[0])
+		return;
+	entry = (struct tizen_intern_entry *)
+		(str - offsetof(struct tizen_intern_entry, str));
+	ithread_mutex_lock(&TizenInternMutex);
+	if (--entry->refs == 0) {
+		prev = &TizenInternTable[entry->hash & (TIZEN_INTERN_BUCKETS - 1)];
+		while (*prev != entry)
+			prev = &(*prev)->next;
+		*prev = entry->next;
+		free(entry);
+	}
+	ithread_mutex_unlock(&TizenInternMutex);
+}
+
+int TizenArena_Init(struct tizen_arena *arena, unsigned int size)
+{
+	int i;
+
+	arena->used = 0;
+	for (i = 0; i < TIZEN_ARENA_CLASSES; i++) {
+		if (size <= TizenArenaClass[i]) {
+			arena->buf = (char *)TizenPool_Alloc(&TizenArenaPool[i]);
+			arena->size = TizenArenaClass[i];
+			return arena->buf ? 0 : -1;
+		}
+	}
+	arena->buf = (char *)malloc(size);
+	arena->size = size;
+
+	return arena->buf ? 0 : -1;
+}
+
+void TizenArena_Release(struct tizen_arena *arena)
+{
+	int i;
+
+	if (!arena->buf)
+		return;
+	for (i = 0; i < TIZEN_ARENA_CLASSES; i++) {
+		if (arena->size == TizenArenaClass[i]) {
+			TizenPool_Free(&TizenArenaPool[i], arena->buf);
+			break;
+		}
+	}
+	if (i == TIZEN_ARENA_CLASSES)
+		free(arena->buf);
+	arena->buf = NULL;
+	arena->size = 0;
+	arena->used = 0;
+}
+
+const char *TizenArena_Add(struct tizen_arena *arena, const char *str)
+{
+	unsigned int len = str ? (unsigned int)strlen(str) : 0;
+	char *p;
+
+	if (len > TIZEN_ARENA_MAX_STRING ||
+	    arena->used + TIZEN_ARENA_SIZE(len) > arena->size)
+		return NULL;
+	p = arena->buf + arena->used;
+	p[0] = (char)(len >> 8);
+	p[1] = (char)(len & 0xff);
+	memcpy(p + 2, str ? str : "", len);
+	p[2 + len] = '\0';
+	arena->used += TIZEN_ARENA_SIZE(len);
+
+	return p + 2;
+}
+
+unsigned int TizenArena_Length(const char *str)
+{
+	return ((unsigned int)(unsigned char)str[-2] << 8) |
+		(unsigned char)str[-1];
+}
+
+/*! @} String Storage */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,135 @@
+#ifndef UPNP_TIZEN_STRINGS_H
+#define UPNP_TIZEN_STRINGS_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name String Storage
+ *
+ * Storage for the strings of a device record.
+ *
+ * Strings that are the same for the whole fleet (service types and IDs) are
+ * interned: every device points to one reference counted copy.
+ *
+ * Strings that are specific to a device (UDN, URLs, friendly name) are packed
+ * into a per-device arena. Each string is preceded by its length on two bytes
+ * and followed by a NUL, so that it can be used as a plain C string. The
+ * arena block comes from a small set of size-class pools.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Largest string an arena accepts. */
+#define TIZEN_ARENA_MAX_STRING	0xffff
+
+/*! Bytes of arena needed to store a string of length len. */
+#define TIZEN_ARENA_SIZE(len)	((len) + 3)
+
+/*! A per-device string arena. */
+struct tizen_arena {
+	/*! The block, NULL if empty. */
+	char *buf;
+	/*! Size of the block. */
+	unsigned int size;
+	/*! Bytes used so far. */
+	unsigned int used;
+};
+
+/*!
+ * \brief Initializes the intern table and the arena pools. Must be called
+ * before anything else.
+ */
+void TizenStrings_Init(void);
+
+/*!
+ * \brief Returns the shared copy of a string, creating it if needed, and
+ * takes a reference on it.
+ *
+ * \return The interned string, or NULL if memory could not be allocated.
+ * The empty string (and NULL) map to a static "" that is not counted.
+ */
+const char *TizenIntern_Get(
+	/*! [in] The string to intern, may be NULL. */
+	const char *str);
+
+/*!
+ * \brief Drops a reference taken by TizenIntern_Get(). The copy is freed
+ * with its last reference.
+ */
+void TizenIntern_Put(
+	/*! [in] A string returned by TizenIntern_Get(), may be NULL. */
+	const char *str);
+
+/*!
+ * \brief Allocates the block of an arena.
+ *
+ * \return 0 on success, -1 if memory could not be allocated.
+ */
+int TizenArena_Init(
+	/*! [in] The arena. */
+	struct tizen_arena *arena,
+	/*! [in] Total size needed, the sum of TIZEN_ARENA_SIZE() of every
+	 * string that will be added. */
+	unsigned int size);
+
+/*!
+ * \brief Releases the block of an arena.
+ */
+void TizenArena_Release(
+	/*! [in] The arena. */
+	struct tizen_arena *arena);
+
+/*!
+ * \brief Copies a string into an arena.
+ *
+ * \return The copy, or NULL if the arena is full or the string too long.
+ */
+const char *TizenArena_Add(
+	/*! [in] The arena. */
+	struct tizen_arena *arena,
+	/*! [in] The string, NULL is stored as "". */
+	const char *str);
+
+/*!
+ * \brief Returns the length of a string stored by TizenArena_Add(), without
+ * scanning it.
+ */
+unsigned int TizenArena_Length(
+	/*! [in] A string returned by TizenArena_Add(). */
+	const char *str);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} String Storage */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_STRINGS_H */
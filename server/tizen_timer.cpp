@@ -0,0 +1,180 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Timer Wheel
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_timer.h"
+
+#include <string.h>
+#include <time.h>
+
+#define TIZEN_WHEEL_L0_MASK	(TIZEN_WHEEL_L0_SLOTS - 1)
+#define TIZEN_WHEEL_L1_MASK	(TIZEN_WHEEL_L1_SLOTS - 1)
+/*! Ticks covered by both levels. */
+#define TIZEN_WHEEL_SPAN	(TIZEN_WHEEL_L0_SLOTS * TIZEN_WHEEL_L1_SLOTS)
+
+unsigned int TizenTimer_Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned int)ts.tv_sec;
+}
+
+unsigned int TizenTimer_NowMs(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned int)ts.tv_sec * 1000u +
+		(unsigned int)(ts.tv_nsec / 1000000);
+}
+
+void TizenWheel_Init(struct tizen_wheel *wheel, unsigned int now)
+{
+	memset(wheel, 0, sizeof(*wheel));
+	wheel->now = now;
+}
+
+static void TizenWheel_Link(struct tizen_timer **head,
+	struct tizen_timer *timer)
+{
+	timer->next = *head;
+	if (timer->next)
+		timer->next->pprev = &timer->next;
+	*head = timer;
+	timer->pprev = head;
+}
+
+/********************************************************************************
+ * TizenWheel_Place
+ *
+ * Description:
+ *       Links a timer into the slot matching its distance from base.
+ *
+ * Parameters:
+ *   wheel -- The wheel
+ *   timer -- The timer, not linked, with timer->expires >= base
+ *   base -- The tick the distance is measured from
+ *
+ ********************************************************************************/
+static void TizenWheel_Place(struct tizen_wheel *wheel,
+	struct tizen_timer *timer, unsigned int base)
+{
+	unsigned int delta = timer->expires - base;
+
+	if (delta < TIZEN_WHEEL_L0_SLOTS)
+		TizenWheel_Link(&wheel->level0[timer->expires & TIZEN_WHEEL_L0_MASK],
+			timer);
+	else if (delta < TIZEN_WHEEL_SPAN)
+		TizenWheel_Link(&wheel->level1[(timer->expires >>
+			TIZEN_WHEEL_L0_BITS) & TIZEN_WHEEL_L1_MASK], timer);
+	else
+		TizenWheel_Link(&wheel->overflow, timer);
+}
+
+void TizenWheel_Cancel(struct tizen_timer *timer)
+{
+	if (!timer->pprev)
+		return;
+	*timer->pprev = timer->next;
+	if (timer->next)
+		timer->next->pprev = timer->pprev;
+	timer->next = NULL;
+	timer->pprev = NULL;
+}
+
+int TizenWheel_Pending(const struct tizen_timer *timer)
+{
+	return timer->pprev != NULL;
+}
+
+void TizenWheel_Arm(struct tizen_wheel *wheel, struct tizen_timer *timer,
+	unsigned int expires)
+{
+	TizenWheel_Cancel(timer);
+	if ((int)(expires - wheel->now) <= 0)
+		expires = wheel->now + 1;
+	timer->expires = expires;
+	TizenWheel_Place(wheel, timer, wheel->now);
+}
+
+/********************************************************************************
+ * TizenWheel_Cascade
+ *
+ * Description:
+ *       Re-places every timer of a list relative to base.
+ *
+ ********************************************************************************/
+static void TizenWheel_Cascade(struct tizen_wheel *wheel,
+	struct tizen_timer **head, unsigned int base)
+{
+	struct tizen_timer *timer = *head, *next;
+
+	*head = NULL;
+	for (; timer; timer = next) {
+		next = timer->next;
+		timer->pprev = NULL;
+		TizenWheel_Place(wheel, timer, base);
+	}
+}
+
+struct tizen_timer *TizenWheel_Advance(struct tizen_wheel *wheel,
+	unsigned int now)
+{
+	struct tizen_timer *due = NULL, *timer, *next;
+	unsigned int tick;
+
+	while ((int)(now - wheel->now) > 0) {
+		tick = wheel->now + 1;
+		if ((tick & TIZEN_WHEEL_L0_MASK) == 0) {
+			if ((tick & (TIZEN_WHEEL_SPAN - 1)) == 0)
+				TizenWheel_Cascade(wheel, &wheel->overflow, tick);
+			TizenWheel_Cascade(wheel, &wheel->level1[
+				(tick >> TIZEN_WHEEL_L0_BITS) & TIZEN_WHEEL_L1_MASK],
+				tick);
+		}
+		wheel->now = tick;
+		timer = wheel->level0[tick & TIZEN_WHEEL_L0_MASK];
+		wheel->level0[tick & TIZEN_WHEEL_L0_MASK] = NULL;
+		for (; timer; timer = next) {
+			next = timer->next;
+			timer->pprev = NULL;
+			timer->next = due;
+			due = timer;
+		}
+	}
+
+	return due;
+}
+
+/*! @} Timer Wheel */
+
+/*! @} UpnpSamples */
@@ -0,0 +1,142 @@
+#ifndef UPNP_TIZEN_TIMER_H
+#define UPNP_TIZEN_TIMER_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name Timer Wheel
+ *
+ * A two level hashed timing wheel with a one second tick, driven by
+ * CLOCK_MONOTONIC. Timers due within TIZEN_WHEEL_L0_SLOTS seconds sit in
+ * the first level, timers due within TIZEN_WHEEL_L0_SLOTS *
+ * TIZEN_WHEEL_L1_SLOTS seconds in the second one and are cascaded down when
+ * their slot comes up, later ones wait in an overflow list.
+ *
+ * Arming, re-arming and cancelling a timer are O(1). Advancing the wheel
+ * only touches the timers that are due (plus one cascade per
+ * TIZEN_WHEEL_L0_SLOTS ticks).
+ *
+ * The wheel does no locking of its own.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Slots of the first level, one per tick. Must be a power of two. */
+#define TIZEN_WHEEL_L0_BITS	8
+#define TIZEN_WHEEL_L0_SLOTS	(1u << TIZEN_WHEEL_L0_BITS)
+/*! Slots of the second level, one per TIZEN_WHEEL_L0_SLOTS ticks. */
+#define TIZEN_WHEEL_L1_BITS	6
+#define TIZEN_WHEEL_L1_SLOTS	(1u << TIZEN_WHEEL_L1_BITS)
+
+/*! A timer, usually embedded in the object it times. */
+struct tizen_timer {
+	struct tizen_timer *next;
+	/*! Link pointing at this timer, NULL while the timer is not armed. */
+	struct tizen_timer **pprev;
+	/*! Tick at which the timer fires. */
+	unsigned int expires;
+};
+
+/*! A timing wheel. */
+struct tizen_wheel {
+	/*! Last tick processed. */
+	unsigned int now;
+	struct tizen_timer *level0[TIZEN_WHEEL_L0_SLOTS];
+	struct tizen_timer *level1[TIZEN_WHEEL_L1_SLOTS];
+	struct tizen_timer *overflow;
+};
+
+/*!
+ * \brief Returns the current tick: whole seconds of CLOCK_MONOTONIC.
+ */
+unsigned int TizenTimer_Now(void);
+
+/*!
+ * \brief Returns CLOCK_MONOTONIC in milliseconds. Wraps around after 49
+ * days, so only differences are meaningful.
+ */
+unsigned int TizenTimer_NowMs(void);
+
+/*!
+ * \brief Initializes an empty wheel.
+ */
+void TizenWheel_Init(
+	/*! [in] The wheel. */
+	struct tizen_wheel *wheel,
+	/*! [in] The current tick. */
+	unsigned int now);
+
+/*!
+ * \brief Arms a timer, or moves it if it is already armed.
+ */
+void TizenWheel_Arm(
+	/*! [in] The wheel. */
+	struct tizen_wheel *wheel,
+	/*! [in] The timer. */
+	struct tizen_timer *timer,
+	/*! [in] Tick at which to fire. Ticks already past fire on the next
+	 * TizenWheel_Advance(). */
+	unsigned int expires);
+
+/*!
+ * \brief Disarms a timer. Does nothing if the timer is not armed.
+ */
+void TizenWheel_Cancel(
+	/*! [in] The timer. */
+	struct tizen_timer *timer);
+
+/*!
+ * \brief Tells whether a timer is armed.
+ */
+int TizenWheel_Pending(
+	/*! [in] The timer. */
+	const struct tizen_timer *timer);
+
+/*!
+ * \brief Advances the wheel up to a tick and detaches the timers that fell
+ * due on the way.
+ *
+ * \return The due timers, linked through their next field. They are no
+ * longer armed and may be re-armed right away.
+ */
+struct tizen_timer *TizenWheel_Advance(
+	/*! [in] The wheel. */
+	struct tizen_wheel *wheel,
+	/*! [in] The current tick. */
+	unsigned int now);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} Timer Wheel */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_TIMER_H */
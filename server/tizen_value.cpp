@@ -0,0 +1,169 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name State Values
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_value.h"
+#include "tizen_pool.h"
+#include "tizen_schema.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*! Spill blocks come in slabs of this many. */
+#define TIZEN_VALUE_SPILL_SLAB	32
+
+static struct tizen_pool TizenValuePool;
+
+void TizenValue_Init(void)
+{
+	TizenPool_Init(&TizenValuePool, TIZEN_VALUE_SPILL,
+		       TIZEN_VALUE_SPILL_SLAB);
+}
+
+int TizenValue_Parse(int type, const char *text, long long *num)
+{
+	unsigned long long unum;
+	char *end;
+
+	errno = 0;
+	switch (type) {
+	case TIZEN_TYPE_BOOLEAN:
+		if (strcmp(text, "1") == 0 || strcasecmp(text, "true") == 0 ||
+		    strcasecmp(text, "yes") == 0)
+			*num = 1;
+		else if (strcmp(text, "0") == 0 ||
+			 strcasecmp(text, "false") == 0 ||
+			 strcasecmp(text, "no") == 0)
+			*num = 0;
+		else
+			return -1;
+		return 0;
+	case TIZEN_TYPE_INT:
+		*num = strtoll(text, &end, 10);
+		if (end == text || *end || errno ||
+		    *num < INT_MIN || *num > INT_MAX)
+			return -1;
+		return 0;
+	case TIZEN_TYPE_UINT:
+		if (strchr(text, '-'))
+			return -1;
+		unum = strtoull(text, &end, 10);
+		if (end == text || *end || errno || unum > UINT_MAX)
+			return -1;
+		*num = (long long)unum;
+		return 0;
+	default:
+		return -1;
+	}
+}
+
+int TizenValue_Set(struct tizen_value *value, int type, const char *text)
+{
+	unsigned int len;
+	long long num;
+	char *buf;
+	int spill;
+	int ret = 0;
+
+	if (!text)
+		text = "";
+	len = strlen(text);
+	if (len > TIZEN_VALUE_MAX) {
+		len = TIZEN_VALUE_MAX;
+		ret = -1;
+	}
+	if (len < TIZEN_VALUE_INLINE)
+		spill = 0;
+	else if (len < TIZEN_VALUE_SPILL)
+		spill = 1;
+	else
+		spill = 2;
+
+	/* A block of the right class is reused as is */
+	if (value->Spilled == 1 && spill == 1) {
+		buf = value->Text.Spill;
+	} else {
+		TizenValue_Clear(value);
+		if (spill == 1)
+			buf = (char *)TizenPool_Alloc(&TizenValuePool);
+		else if (spill == 2)
+			buf = (char *)malloc(len + 1);
+		else
+			buf = value->Text.Inline;
+		if (!buf) {
+			/* Keep what fits inline */
+			spill = 0;
+			buf = value->Text.Inline;
+			len = TIZEN_VALUE_INLINE - 1;
+			ret = -1;
+		}
+		if (spill)
+			value->Text.Spill = buf;
+		value->Spilled = (unsigned char)spill;
+	}
+	memcpy(buf, text, len);
+	buf[len] = '\0';
+	value->Length = (unsigned short)len;
+
+	value->Num.Int = 0;
+	value->Type = TIZEN_TYPE_STRING;
+	if (type == TIZEN_TYPE_FLOAT) {
+		value->Type = TIZEN_TYPE_FLOAT;
+	} else if (type != TIZEN_TYPE_STRING &&
+		   TizenValue_Parse(type, buf, &num) == 0) {
+		value->Type = (unsigned char)type;
+		if (type == TIZEN_TYPE_UINT)
+			value->Num.UInt = (unsigned int)num;
+		else
+			value->Num.Int = (int)num;
+	}
+
+	return ret;
+}
+
+const char *TizenValue_Text(const struct tizen_value *value)
+{
+	return value->Spilled ? value->Text.Spill : value->Text.Inline;
+}
+
+void TizenValue_Clear(struct tizen_value *value)
+{
+	if (value->Spilled == 1)
+		TizenPool_Free(&TizenValuePool, value->Text.Spill);
+	else if (value->Spilled == 2)
+		free(value->Text.Spill);
+	memset(value, 0, sizeof(*value));
+}
+
+/*! @} State Values */
+
+/*! @} UpnpSamples */
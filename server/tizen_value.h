@@ -0,0 +1,132 @@
+#ifndef UPNP_TIZEN_VALUE_H
+#define UPNP_TIZEN_VALUE_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name State Values
+ *
+ * Typed storage for state variables. Numeric and boolean values are parsed
+ * once, when they are set, so readers and range checks use the number
+ * directly. The text is kept as well: short texts live inside the value,
+ * longer ones spill to a pool of blocks (or the heap past the block size).
+ *
+ * A value is not locked: callers serialize access to it (StateMutex for
+ * the state tables of a device node). A zero-filled value is an empty
+ * string.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Text bytes stored inside a value, NUL included. */
+#define TIZEN_VALUE_INLINE	8
+
+/*! Size of a spill block, NUL included. Longer texts go to the heap. */
+#define TIZEN_VALUE_SPILL	128
+
+/*! Longest text a value keeps; longer texts are truncated. */
+#define TIZEN_VALUE_MAX		0xfffe
+
+/*! A state variable value, 16 bytes. */
+struct tizen_value {
+	/*! TIZEN_TYPE_* the text was parsed as, TIZEN_TYPE_STRING if it is
+	 * not a valid number of the type of the variable. */
+	unsigned char Type;
+	/*! Where the text lives: 0 inline, 1 spill block, 2 heap. */
+	unsigned char Spilled;
+	/*! Length of the text. */
+	unsigned short Length;
+	/*! Parsed value: Int for TIZEN_TYPE_INT and TIZEN_TYPE_BOOLEAN (0 or
+	 * 1), UInt for TIZEN_TYPE_UINT. Zero for other types. */
+	union {
+		int Int;
+		unsigned int UInt;
+	} Num;
+	union {
+		char Inline[TIZEN_VALUE_INLINE];
+		char *Spill;
+	} Text;
+};
+
+/*!
+ * \brief Initializes the spill pool. Must be called before anything else.
+ */
+void TizenValue_Init(void);
+
+/*!
+ * \brief Stores a value, parsing it according to its type.
+ *
+ * \return 0 on success, -1 if the text was truncated (too long, or no
+ * memory for a spill).
+ */
+int TizenValue_Set(
+	/*! [in,out] The value. */
+	struct tizen_value *value,
+	/*! [in] One of TIZEN_TYPE_*. */
+	int type,
+	/*! [in] The text, NULL is stored as "". */
+	const char *text);
+
+/*!
+ * \brief Returns the text of a value. Valid until the value changes.
+ */
+const char *TizenValue_Text(
+	/*! [in] The value. */
+	const struct tizen_value *value);
+
+/*!
+ * \brief Parses a text as a number of the given type, as TizenValue_Set()
+ * does.
+ *
+ * \return 0 on success, -1 if the text is not a number of that type.
+ */
+int TizenValue_Parse(
+	/*! [in] One of TIZEN_TYPE_INT, TIZEN_TYPE_UINT, TIZEN_TYPE_BOOLEAN. */
+	int type,
+	/*! [in] The text. */
+	const char *text,
+	/*! [out] The number. */
+	long long *num);
+
+/*!
+ * \brief Releases the spill of a value and resets it to "".
+ */
+void TizenValue_Clear(
+	/*! [in,out] The value. */
+	struct tizen_value *value);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} State Values */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_VALUE_H */
@@ -0,0 +1,365 @@
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name XML Tokenizer
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "tizen_xml.h"
+
+#include <string.h>
+
+void TizenXml_Init(struct tizen_xml *xml, char *buf, size_t len)
+{
+	memset(xml, 0, sizeof(*xml));
+	xml->pos = buf;
+	xml->end = buf + len;
+}
+
+/********************************************************************************
+ * TizenXml_Find
+ *
+ * Description:
+ *       Bounded strstr.
+ *
+ ********************************************************************************/
+static char *TizenXml_Find(char *pos, char *end, const char *str)
+{
+	size_t len = strlen(str);
+
+	for (; pos + len <= end; pos++)
+		if (*pos == *str && memcmp(pos, str, len) == 0)
+			return pos;
+
+	return NULL;
+}
+
+static int TizenXml_IsSpace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/********************************************************************************
+ * TizenXml_Reference
+ *
+ * Description:
+ *       Parses the character reference at p ('&').
+ *
+ * Returns:
+ *   The length of the reference, 0 if it is not one we support. The code
+ *   point is returned in *cp.
+ *
+ ********************************************************************************/
+static size_t TizenXml_Reference(const char *p, const char *end,
+	unsigned long *cp)
+{
+	static const struct {
+		const char *name;
+		char c;
+	} entities[] = {
+		{ "&lt;", '<' }, { "&gt;", '>' }, { "&amp;", '&' },
+		{ "&quot;", '"' }, { "&apos;", '\'' }
+	};
+	const char *q;
+	size_t i, len;
+	int base = 10;
+
+	for (i = 0; i < sizeof(entities) / sizeof(entities[0]); i++) {
+		len = strlen(entities[i].name);
+		if ((size_t)(end - p) >= len &&
+		    memcmp(p, entities[i].name, len) == 0) {
+			*cp = (unsigned char)entities[i].c;
+			return len;
+		}
+	}
+	if (end - p < 4 || p[1] != '#')
+		return 0;
+	q = p + 2;
+	if (*q == 'x') {
+		base = 16;
+		q++;
+	}
+	*cp = 0;
+	for (len = 0; q < end && *q != ';' && len < 8; q++, len++) {
+		if (*q >= '0' && *q <= '9')
+			*cp = *cp * base + (unsigned long)(*q - '0');
+		else if (base == 16 && ((*q | 0x20) >= 'a' && (*q | 0x20) <= 'f'))
+			*cp = *cp * 16 + (unsigned long)((*q | 0x20) - 'a' + 10);
+		else
+			return 0;
+	}
+	if (q >= end || *q != ';' || len == 0 || *cp == 0 || *cp > 0x10ffff)
+		return 0;
+
+	return (size_t)(q + 1 - p);
+}
+
+size_t TizenXml_Decode(char *text, size_t len)
+{
+	char *in = text, *out = text, *end = text + len;
+	unsigned long cp;
+	size_t used;
+
+	while (in < end) {
+		if (*in != '&' ||
+		    !(used = TizenXml_Reference(in, end, &cp))) {
+			*out++ = *in++;
+			continue;
+		}
+		in += used;
+		/* UTF-8, never longer than the reference itself */
+		if (cp < 0x80) {
+			*out++ = (char)cp;
+		} else if (cp < 0x800) {
+			*out++ = (char)(0xc0 | (cp >> 6));
+			*out++ = (char)(0x80 | (cp & 0x3f));
+		} else if (cp < 0x10000) {
+			*out++ = (char)(0xe0 | (cp >> 12));
+			*out++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+			*out++ = (char)(0x80 | (cp & 0x3f));
+		} else {
+			*out++ = (char)(0xf0 | (cp >> 18));
+			*out++ = (char)(0x80 | ((cp >> 12) & 0x3f));
+			*out++ = (char)(0x80 | ((cp >> 6) & 0x3f));
+			*out++ = (char)(0x80 | (cp & 0x3f));
+		}
+	}
+	*out = '\0';
+
+	return (size_t)(out - text);
+}
+
+int TizenXml_Next(struct tizen_xml *xml, struct tizen_xml_token *tok)
+{
+	unsigned long cp;
+	char *p, *name;
+	char quote;
+	int endtag;
+
+	memset(tok, 0, sizeof(*tok));
+	if (xml->selfclosed) {
+		xml->selfclosed = 0;
+		xml->depth--;
+		tok->name = xml->stack[xml->depth];
+		tok->namelen = xml->stacklen[xml->depth];
+		return TIZEN_XML_END;
+	}
+	for (;;) {
+		if (xml->pos >= xml->end)
+			return xml->depth ? TIZEN_XML_ERROR : TIZEN_XML_EOF;
+		p = xml->pos;
+		if (*p != '<') {
+			/* Text, up to the next tag */
+			while (xml->pos < xml->end && *xml->pos != '<') {
+				if (*xml->pos == '&' &&
+				    !TizenXml_Reference(xml->pos, xml->end, &cp))
+					return TIZEN_XML_ERROR;
+				xml->pos++;
+			}
+			if (!xml->depth) {
+				/* Only blanks may surround the root element */
+				for (; p < xml->pos; p++)
+					if (!TizenXml_IsSpace(*p))
+						return TIZEN_XML_ERROR;
+				continue;
+			}
+			tok->text = p;
+			tok->textlen = (size_t)(xml->pos - p);
+			return TIZEN_XML_TEXT;
+		}
+		if (xml->end - p >= 2 && p[1] == '?') {
+			p = TizenXml_Find(p + 2, xml->end, "?>");
+			if (!p)
+				return TIZEN_XML_ERROR;
+			xml->pos = p + 2;
+			continue;
+		}
+		if (xml->end - p >= 4 && memcmp(p, "<!--", 4) == 0) {
+			p = TizenXml_Find(p + 4, xml->end, "-->");
+			if (!p)
+				return TIZEN_XML_ERROR;
+			xml->pos = p + 3;
+			continue;
+		}
+		if (xml->end - p >= 2 && p[1] == '!')
+			/* DOCTYPE, CDATA */
+			return TIZEN_XML_ERROR;
+		break;
+	}
+
+	/* A tag */
+	endtag = xml->end - p >= 2 && p[1] == '/';
+	name = p + 1 + endtag;
+	for (p = name; p < xml->end && !TizenXml_IsSpace(*p) && *p != '/' &&
+	     *p != '>'; p++)
+		;
+	if (p == name || p >= xml->end)
+		return TIZEN_XML_ERROR;
+	tok->name = name;
+	tok->namelen = (size_t)(p - name);
+	if (endtag) {
+		while (p < xml->end && TizenXml_IsSpace(*p))
+			p++;
+		if (p >= xml->end || *p != '>' || !xml->depth ||
+		    xml->stacklen[xml->depth - 1] != tok->namelen ||
+		    memcmp(xml->stack[xml->depth - 1], name, tok->namelen) != 0)
+			return TIZEN_XML_ERROR;
+		xml->pos = p + 1;
+		xml->depth--;
+		return TIZEN_XML_END;
+	}
+	/* Skip the attributes */
+	for (quote = 0; p < xml->end; p++) {
+		if (quote) {
+			if (*p == quote)
+				quote = 0;
+		} else if (*p == '"' || *p == '\'') {
+			quote = *p;
+		} else if (*p == '>' || *p == '<') {
+			break;
+		}
+	}
+	if (p >= xml->end || *p != '>' || xml->depth >= TIZEN_XML_MAX_DEPTH)
+		return TIZEN_XML_ERROR;
+	xml->stack[xml->depth] = name;
+	xml->stacklen[xml->depth] = tok->namelen;
+	xml->depth++;
+	xml->selfclosed = p[-1] == '/';
+	xml->pos = p + 1;
+
+	return TIZEN_XML_START;
+}
+
+/*! A value of the description, decoded once the whole document is known
+ * to be well formed. */
+struct tizen_xml_value {
+	const char **field;
+	char *text;
+	size_t len;
+};
+
+static int TizenXml_Is(const struct tizen_xml_token *tok, const char *name)
+{
+	return tok->namelen == strlen(name) &&
+		memcmp(tok->name, name, tok->namelen) == 0;
+}
+
+int TizenXml_ParseDescription(char *buf, size_t len,
+	struct SampleUtil_Description *desc)
+{
+	struct tizen_xml_value values[6 + 5 * SAMPLE_UTIL_MAX_SERVICES];
+	struct SampleUtil_Service *service = NULL;
+	struct tizen_xml_token tok;
+	struct tizen_xml xml;
+	const char **field = NULL;
+	int nvalues = 0;
+	int fieldDepth = 0, serviceDepth = 0, serviceListDepth = 0;
+	int serviceListDone = 0;
+	int type, i;
+
+	memset(desc, 0, sizeof(*desc));
+	TizenXml_Init(&xml, buf, len);
+	while ((type = TizenXml_Next(&xml, &tok)) != TIZEN_XML_EOF) {
+		switch (type) {
+		case TIZEN_XML_START:
+			/* Only the text before the first child is the value */
+			field = NULL;
+			if (serviceListDepth && !serviceListDone &&
+			    TizenXml_Is(&tok, "service")) {
+				if (desc->serviceCount < SAMPLE_UTIL_MAX_SERVICES) {
+					service = &desc->service[desc->serviceCount++];
+					serviceDepth = xml.depth;
+				}
+			} else if (service && TizenXml_Is(&tok, "serviceType")) {
+				field = &service->serviceType;
+			} else if (service && TizenXml_Is(&tok, "serviceId")) {
+				field = &service->serviceId;
+			} else if (service && TizenXml_Is(&tok, "SCPDURL")) {
+				field = &service->SCPDURL;
+			} else if (service && TizenXml_Is(&tok, "controlURL")) {
+				field = &service->controlURL;
+			} else if (service && TizenXml_Is(&tok, "eventSubURL")) {
+				field = &service->eventSubURL;
+			} else if (TizenXml_Is(&tok, "serviceList")) {
+				if (!serviceListDepth)
+					serviceListDepth = xml.depth;
+			} else if (TizenXml_Is(&tok, "URLBase")) {
+				field = &desc->URLBase;
+			} else if (TizenXml_Is(&tok, "deviceType")) {
+				field = &desc->deviceType;
+			} else if (TizenXml_Is(&tok, "friendlyName")) {
+				field = &desc->friendlyName;
+			} else if (TizenXml_Is(&tok, "modelName")) {
+				field = &desc->modelName;
+			} else if (TizenXml_Is(&tok, "UDN")) {
+				field = &desc->UDN;
+			} else if (TizenXml_Is(&tok, "presentationURL")) {
+				field = &desc->presentationURL;
+			}
+			/* The first element wins; "" until its text shows up */
+			if (field && *field)
+				field = NULL;
+			if (field) {
+				*field = "";
+				fieldDepth = xml.depth;
+			}
+			break;
+		case TIZEN_XML_TEXT:
+			if (field && xml.depth == fieldDepth) {
+				values[nvalues].field = field;
+				values[nvalues].text = tok.text;
+				values[nvalues].len = tok.textlen;
+				nvalues++;
+				field = NULL;
+			}
+			break;
+		case TIZEN_XML_END:
+			/* xml.depth is the depth of the parent now */
+			if (xml.depth < fieldDepth)
+				field = NULL;
+			if (service && xml.depth < serviceDepth)
+				service = NULL;
+			if (serviceListDepth && xml.depth < serviceListDepth)
+				serviceListDone = 1;
+			break;
+		default:
+			memset(desc, 0, sizeof(*desc));
+			return -1;
+		}
+	}
+
+	/* Well formed: the values can be decoded in place */
+	for (i = 0; i < nvalues; i++) {
+		TizenXml_Decode(values[i].text, values[i].len);
+		*values[i].field = values[i].text;
+	}
+
+	return 0;
+}
+
+/*! @} XML Tokenizer */
+
+/*! @} UpnpSamples */
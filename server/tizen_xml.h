@@ -0,0 +1,148 @@
+#ifndef UPNP_TIZEN_XML_H
+#define UPNP_TIZEN_XML_H
+
+/*******************************************************************************
+ *
+ * Copyright (c) 2014 - ESLAB All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ ******************************************************************************/
+
+/*!
+ * \addtogroup UpnpSamples
+ *
+ * @{
+ *
+ * \name XML Tokenizer
+ *
+ * A streaming, non-allocating XML tokenizer for the small, regular
+ * documents UPnP devices serve. It reports start tags, end tags and text in
+ * document order, pointing into the caller's buffer, so a reader can pick
+ * the few values it needs without building a DOM.
+ *
+ * Only what UPnP documents use is supported: elements, attributes (skipped),
+ * the XML declaration, processing instructions, comments, and the
+ * predefined and numeric character references. Anything else (DOCTYPE,
+ * CDATA, other entities, mismatched tags, nesting deeper than
+ * TIZEN_XML_MAX_DEPTH) is reported as TIZEN_XML_ERROR so that the caller can
+ * fall back to ixml.
+ *
+ * @{
+ *
+ * \file
+ */
+
+#include "sample_util.h"
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! Deepest element nesting accepted. */
+#define TIZEN_XML_MAX_DEPTH	32
+
+/*! Token types returned by TizenXml_Next(). */
+#define TIZEN_XML_ERROR		(-1)
+#define TIZEN_XML_EOF		0
+#define TIZEN_XML_START		1
+#define TIZEN_XML_END		2
+#define TIZEN_XML_TEXT		3
+
+/*! A token. Nothing is NUL terminated. */
+struct tizen_xml_token {
+	/*! Tag name (with its prefix, if any) of START and END tokens. */
+	const char *name;
+	size_t namelen;
+	/*! Raw text of TEXT tokens, character references not decoded. */
+	char *text;
+	size_t textlen;
+};
+
+/*! Tokenizer state. */
+struct tizen_xml {
+	char *pos;
+	char *end;
+	/*! Set after a self-closing tag, whose END is still to be reported. */
+	int selfclosed;
+	/*! Names of the open elements. */
+	int depth;
+	const char *stack[TIZEN_XML_MAX_DEPTH];
+	size_t stacklen[TIZEN_XML_MAX_DEPTH];
+};
+
+/*!
+ * \brief Starts tokenizing a buffer. The buffer is not modified.
+ */
+void TizenXml_Init(
+	/*! [out] The tokenizer. */
+	struct tizen_xml *xml,
+	/*! [in] The document. */
+	char *buf,
+	/*! [in] Its length. */
+	size_t len);
+
+/*!
+ * \brief Reads the next token.
+ *
+ * \return TIZEN_XML_START, TIZEN_XML_END, TIZEN_XML_TEXT, TIZEN_XML_EOF once
+ * the document is complete, or TIZEN_XML_ERROR.
+ */
+int TizenXml_Next(
+	/*! [in] The tokenizer. */
+	struct tizen_xml *xml,
+	/*! [out] The token. */
+	struct tizen_xml_token *tok);
+
+/*!
+ * \brief Decodes the character references of a text in place and NUL
+ * terminates it. text[len] is overwritten, so this may only be done once
+ * tokenizing is over.
+ *
+ * \return The decoded length.
+ */
+size_t TizenXml_Decode(
+	/*! [in,out] The raw text of a TEXT token. */
+	char *text,
+	/*! [in] Its length. */
+	size_t len);
+
+/*!
+ * \brief Extracts the same fields as SampleUtil_ParseDescription() straight
+ * from the text of a description document.
+ *
+ * On success the buffer is modified (the values are decoded and terminated
+ * in place) and the strings of desc point into it. On failure the buffer is
+ * left intact for another parser.
+ *
+ * \return 0 on success, -1 if the document needs a full XML parser.
+ */
+int TizenXml_ParseDescription(
+	/*! [in,out] The document. */
+	char *buf,
+	/*! [in] Its length. */
+	size_t len,
+	/*! [out] The extracted fields. */
+	struct SampleUtil_Description *desc);
+
+#ifdef __cplusplus
+};
+#endif
+
+/*! @} XML Tokenizer */
+
+/*! @} UpnpSamples */
+
+#endif /* UPNP_TIZEN_XML_H */